@@ -18,6 +18,13 @@
 // 0 = as fast as LoRa duty cycle permits (TX_COMPLETE-gated)
 #define PHANTOM_INTERVAL_MS 15000
 
+// ── Samples per sensor block ────────────────────────────────────────────────────────────────────
+// Values generated per sensor and cycle (1-31), spread over the interval, oldest first.
+// More than 1 exercises multi-sample blocks (e.g. with -D GORILLA_BLOCKS=1).
+#ifndef PHANTOM_SAMPLES_PER_BLOCK
+#define PHANTOM_SAMPLES_PER_BLOCK 1
+#endif
+
 // ── Data generation mode ────────────────────────────────────────────────────────────────────────
 enum PhantomMode : uint8_t {
     PHANTOM_FIXED = 0,   // static value, uses fixedRaw
@@ -24,6 +24,7 @@
 #include "loraconfig.h"
 #include "SensorRegistry.h"
 #include "PhantomConfig.h"
+#include "GorillaCodec.h"
 #include "Log.h"
 
 // =================================================================================================
@@ -32,12 +33,18 @@
 
 #define MAX_SENSOR_PAYLOAD 128
 
+// Codificación XOR (GorillaCodec.h), igual que en el maestro real
+#ifndef GORILLA_BLOCKS
+#define GORILLA_BLOCKS 0
+#endif
+
 struct SensorDataPayload {
     uint8_t slaveId;
     uint8_t sensorId;
     uint8_t data[MAX_SENSOR_PAYLOAD];
     size_t  dataSize;
     uint8_t regsPerChannel;
+    uint8_t lenFlags;
 };
 
 // =================================================================================================
@@ -92,13 +99,15 @@ static void generatePhantomData(const PhantomSensorDef& sensor, uint32_t t_ms,
         }
     }
 
-    // Pack big-endian
+    // Pack big-endian; 1-reg values padded to a 32-bit block like the real master does per request
     if (sensor.numRegs == 2) {
         bytes.push_back((uint8_t)((raw >> 24) & 0xFF));
         bytes.push_back((uint8_t)((raw >> 16) & 0xFF));
         bytes.push_back((uint8_t)((raw >> 8)  & 0xFF));
         bytes.push_back((uint8_t)(raw & 0xFF));
     } else {
+        bytes.push_back(0x00);
+        bytes.push_back(0x00);
         bytes.push_back((uint8_t)((raw >> 8) & 0xFF));
         bytes.push_back((uint8_t)(raw & 0xFF));
     }
@@ -142,19 +151,22 @@ std::vector<uint8_t> construirPayloadUnificado(
     payload.push_back(activate_byte);
 
     // 4. Len Bytes (one per active bit, in LSB→MSB order)
+    auto lenByte = [](const SensorDataPayload* s) {
+        return (uint8_t)((s->regsPerChannel & 0x1F) | s->lenFlags);
+    };
     if (activate_byte & (1 << 0)) {
-        payload.push_back(activeSensors.at(SENSOR_ID_BATERIA)->regsPerChannel & 0x1F);
+        payload.push_back(lenByte(activeSensors.at(SENSOR_ID_BATERIA)));
     }
     if (activate_byte & (1 << 1)) {
-        payload.push_back(activeSensors.at(SENSOR_ID_VOLTAJE)->regsPerChannel & 0x1F);
+        payload.push_back(lenByte(activeSensors.at(SENSOR_ID_VOLTAJE)));
     }
     if (activate_byte & (1 << 2)) {
-        payload.push_back(activeSensors.at(SENSOR_ID_CORRIENTE)->regsPerChannel & 0x1F);
+        payload.push_back(lenByte(activeSensors.at(SENSOR_ID_CORRIENTE)));
     }
     for (int i = 0; i < MAX_SENSORES_EXTERNOS; ++i) {
         if (activate_byte & (1 << (i + 3))) {
             uint8_t sid = SENSOR_ID_EXT_START + i;
-            payload.push_back(activeSensors.at(sid)->regsPerChannel & 0x1F);
+            payload.push_back(lenByte(activeSensors.at(sid)));
         }
     }
 
@@ -200,8 +212,12 @@ void phantomTask(void *pvParameters) {
         for (size_t i = 0; i < kPhantomSensorCount; ++i) {
             const auto& sensor = kPhantomSensors[i];
 
+            // PHANTOM_SAMPLES_PER_BLOCK muestras repartidas en el intervalo, la más antigua primero
             std::vector<uint8_t> bytes;
-            generatePhantomData(sensor, t_ms, bytes);
+            const uint32_t step = PHANTOM_INTERVAL_MS / PHANTOM_SAMPLES_PER_BLOCK;
+            for (uint32_t k = PHANTOM_SAMPLES_PER_BLOCK; k-- > 0;) {
+                generatePhantomData(sensor, t_ms - k * step, bytes);
+            }
 
             auto& group = groups[sensor.sensorType];
             group.insert(group.end(), bytes.begin(), bytes.end());
@@ -226,8 +242,19 @@ void phantomTask(void *pvParameters) {
                 SensorDataPayload p{};
                 p.slaveId        = 0;  // phantom has no physical slave
                 p.sensorId       = sensorType;
-                p.dataSize       = std::min(data.size(), (size_t)MAX_SENSOR_PAYLOAD);
                 p.regsPerChannel = regsPerChannel[sensorType];
+#if GORILLA_BLOCKS
+                std::vector<uint8_t> coded;
+                if (gorilla_encode_block(data.data(), data.size() / 4, coded) &&
+                    coded.size() <= MAX_SENSOR_PAYLOAD) {
+                    p.lenFlags = LEN_FLAG_GORILLA;
+                    p.dataSize = coded.size();
+                    memcpy(p.data, coded.data(), p.dataSize);
+                    payloads.push_back(p);
+                    continue;
+                }
+#endif
+                p.dataSize       = std::min(data.size(), (size_t)MAX_SENSOR_PAYLOAD);
                 memcpy(p.data, data.data(), p.dataSize);
 
                 payloads.push_back(p);
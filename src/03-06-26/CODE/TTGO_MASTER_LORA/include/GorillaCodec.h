@@ -0,0 +1,157 @@
+#ifndef GORILLA_CODEC_H
+#define GORILLA_CODEC_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// =================================================================================================
+// XOR compression of 32-bit blocks (Gorilla TSDB style).
+// =================================================================================================
+// A data block of N big-endian 32-bit words (float32 or uint32, one word per sample) is
+// rewritten as a bit stream, MSB first, zero-padded to the byte:
+//   - first word: 32 bits as is
+//   - each following word, XOR with the previous one:
+//       '0'                               XOR == 0 (repeated value)
+//       '10' + meaningful bits            the meaningful bits fit the previous window
+//       '11' + lead(5) + len-1(5) + bits  new window: leading zeros and meaningful length
+// The block keeps its len byte (N) and is flagged with LEN_FLAG_GORILLA, so a decoder
+// knows how many words to rebuild. Counters and slowly varying floats share sign,
+// exponent and high mantissa bits between samples, so most words take 1-12 bits.
+//
+// IMPORTANT! Part of the LoRa wire format; tools/payload_decoder.py is the reference decoder.
+
+/**
+ * @def LEN_FLAG_GORILLA
+ * @brief Len byte bit 5: the data block is XOR-coded (bits 0-4 keep the word count).
+ */
+constexpr uint8_t LEN_FLAG_GORILLA = 0x20;
+
+// Escritor de bits MSB primero
+struct GorillaBitWriter {
+    std::vector<uint8_t>& out;
+    uint8_t acc  = 0;
+    int     used = 0;
+
+    explicit GorillaBitWriter(std::vector<uint8_t>& o) : out(o) {}
+
+    void put(uint32_t value, int nbits) {
+        while (nbits > 0) {
+            int take = 8 - used;
+            if (take > nbits) take = nbits;
+            uint8_t chunk = (uint8_t)((value >> (nbits - take)) & ((1u << take) - 1));
+            acc = (uint8_t)((acc << take) | chunk);
+            used  += take;
+            nbits -= take;
+            if (used == 8) {
+                out.push_back(acc);
+                acc  = 0;
+                used = 0;
+            }
+        }
+    }
+
+    void flush() {
+        if (used > 0) out.push_back((uint8_t)(acc << (8 - used)));
+        acc  = 0;
+        used = 0;
+    }
+};
+
+inline int gorillaLeadingZeros(uint32_t x) { return __builtin_clz(x); }
+inline int gorillaTrailingZeros(uint32_t x) { return __builtin_ctz(x); }
+
+// Emite un XOR distinto de cero: dentro de la ventana anterior o con ventana nueva
+inline void gorillaPutXor(GorillaBitWriter& bw, uint32_t x, int& winLead, int& winTrail) {
+    int lead  = gorillaLeadingZeros(x);
+    int trail = gorillaTrailingZeros(x);
+    if (winLead >= 0 && lead >= winLead && trail >= winTrail) {
+        bw.put(0x2, 2);
+        bw.put(x >> winTrail, 32 - winLead - winTrail);
+    } else {
+        int len = 32 - lead - trail;
+        bw.put(0x3, 2);
+        bw.put((uint32_t)lead, 5);
+        bw.put((uint32_t)(len - 1), 5);
+        bw.put(x >> trail, len);
+        winLead  = lead;
+        winTrail = trail;
+    }
+}
+
+inline uint32_t gorillaWord(const uint8_t* data, size_t i) {
+    const uint8_t* p = data + i * 4;
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+/**
+ * @brief XOR-codes a block of big-endian 32-bit words.
+ * @param data  Block bytes (words * 4).
+ * @param words Number of words (>= 2; a single word never gets smaller).
+ * @param out   Coded stream, appended.
+ * @return true if the coded stream is smaller than the raw block; otherwise @p out is
+ *         left as it was and the block must be sent raw.
+ */
+inline bool gorilla_encode_block(const uint8_t* data, size_t words, std::vector<uint8_t>& out) {
+    if (words < 2) return false;
+
+    const size_t start = out.size();
+    GorillaBitWriter bw(out);
+
+    uint32_t prev = gorillaWord(data, 0);
+    bw.put(prev, 32);
+
+    int winLead  = -1;   // Ventana anterior (-1 = ninguna todavía)
+    int winTrail = 0;
+    for (size_t i = 1; i < words; ++i) {
+        uint32_t cur = gorillaWord(data, i);
+        uint32_t x   = cur ^ prev;
+        prev = cur;
+        if (x == 0) {
+            bw.put(0, 1);
+        } else {
+            gorillaPutXor(bw, x, winLead, winTrail);
+        }
+    }
+    bw.flush();
+
+    if (out.size() - start >= words * 4) {
+        out.resize(start);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief XOR-codes a block against a reference block with the same number of words.
+ * @details Same stream as gorilla_encode_block(), except that every word (the first
+ * one included) is XOR-ed with the word at the same position of @p ref instead of the
+ * previous word. Used by the inter-frame deltas against the last keyframe.
+ * @return true if the coded stream is smaller than the raw block; otherwise @p out is
+ *         left as it was.
+ */
+inline bool gorilla_encode_delta(const uint8_t* data, const uint8_t* ref, size_t words,
+                                 std::vector<uint8_t>& out) {
+    const size_t start = out.size();
+    GorillaBitWriter bw(out);
+
+    int winLead  = -1;
+    int winTrail = 0;
+    for (size_t i = 0; i < words; ++i) {
+        uint32_t x = gorillaWord(data, i) ^ gorillaWord(ref, i);
+        if (x == 0) {
+            bw.put(0, 1);
+        } else {
+            gorillaPutXor(bw, x, winLead, winTrail);
+        }
+    }
+    bw.flush();
+
+    if (out.size() - start >= words * 4) {
+        out.resize(start);
+        return false;
+    }
+    return true;
+}
+
+#endif // GORILLA_CODEC_H
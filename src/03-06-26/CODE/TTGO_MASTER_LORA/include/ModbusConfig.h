@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <Arduino.h>
 #include "SensorRegistry.h"
+#include "QuantCodec.h"
 
 // =================================================================================================
 // RS485 Bus configuration (global, all slaves on the same bus share these parameters)
@@ -55,6 +56,8 @@ constexpr size_t kDeviceCfgCount = sizeof(kDeviceCfg) / sizeof(kDeviceCfg[0]);
 // - functionCode se resuelve desde kDeviceCfg o usa 0x03 por defecto
 // - channelIndex ordena dentro del mismo sensorType (0=L1, 1=L2, 2=L3...)
 // - sensorType debe coincidir con los IDs de SensorRegistry.h
+// - seqWindow=true: startAddr es la ventana por secuencia del esclavo (p.ej. 1000) y numRegs el
+//   número de canales; solo se leen las muestras nuevas desde el ciclo anterior. Se puede omitir.
 
 struct ModbusRequest {
     uint8_t  slaveID;
@@ -63,6 +66,7 @@ struct ModbusRequest {
     uint8_t  channelIndex;     // sub-índice dentro del tipo de sensor
     uint8_t  sensorType;       // SENSOR_ID_VOLTAJE, SENSOR_ID_CORRIENTE, etc.
     bool     swapWordOrder;    // intercambia palabra ALTA/BAJA (para 32-bit con LOW word primero)
+    bool     seqWindow;        // lectura incremental "desde la secuencia N" (esclavos ADS propios)
 };
 
 const ModbusRequest kRequests[] = {
@@ -76,6 +80,77 @@ const ModbusRequest kRequests[] = {
 
 constexpr size_t kRequestCount = sizeof(kRequests) / sizeof(kRequests[0]);
 
+// Cabecera de la ventana por secuencia: [seq hi][seq lo][profundidad H][canales C]
+constexpr uint16_t SEQ_WINDOW_HEADER = 4;
+
+// =================================================================================================
+// Word type per sensorType
+// =================================================================================================
+// Cómo interpretar las palabras de 32 bits de cada grupo (banda muerta y cuantización):
+// float32 IEEE 754 si isFloat; si no, entero de 32 bits con signo (uint16 y uint32
+// pequeños incluidos), en las unidades crudas del registro. Los sensorType sin entrada
+// son enteros. P.ej. un SDM630: {SENSOR_ID_VOLTAJE, true}.
+
+struct SensorWordType {
+    uint8_t sensorType;
+    bool    isFloat;           // true = float32, false = entero con signo
+};
+
+const SensorWordType kWordTypes[] = {
+    {SENSOR_ID_VOLTAJE,                  false},  // Trifásico: todo enteros
+    {SENSOR_ID_CORRIENTE,                false},
+    {(uint8_t)(SENSOR_ID_EXT_START + 3), false},
+    {SENSOR_ID_BATERIA,                  false},
+    {(uint8_t)(SENSOR_ID_EXT_START + 4), false},
+};
+
+constexpr size_t kWordTypeCount = sizeof(kWordTypes) / sizeof(kWordTypes[0]);
+
+// =================================================================================================
+// Report-by-exception — deadband + heartbeat per sensorType
+// =================================================================================================
+// Un grupo solo se envía si alguna palabra de 32 bits se movió más que
+// max(absDeadband, relPct % del último valor enviado) respecto al último grupo enviado, o si
+// pasaron heartbeatMs desde entonces (0 = sin heartbeat). Los grupos suprimidos no aparecen en
+// el Activate Byte. Los sensorType sin entrada se envían siempre.
+
+struct SensorDeadband {
+    uint8_t  sensorType;
+    float    absDeadband;      // unidades crudas
+    float    relPct;           // % del último valor enviado
+    uint32_t heartbeatMs;      // silencio máximo
+};
+
+const SensorDeadband kDeadbands[] = {
+    {SENSOR_ID_VOLTAJE,                  5,  0.5f, 300000},  // 0.5 V o 0.5 %
+    {SENSOR_ID_CORRIENTE,                10, 2.0f, 300000},  // 0.1 A o 2 %
+    {(uint8_t)(SENSOR_ID_EXT_START + 3), 50, 2.0f, 300000},  // 5 W o 2 %
+    {SENSOR_ID_BATERIA,                  0,  0.0f, 900000},  // Energía: cada cambio de 0.1 kWh
+};
+
+constexpr size_t kDeadbandCount = sizeof(kDeadbands) / sizeof(kDeadbands[0]);
+
+// =================================================================================================
+// Lossy codecs per sensorType (QuantCodec.h)
+// =================================================================================================
+// QUANT_FLOAT16: half float, 2 bytes por valor. QUANT_SCALED: int8/int16 con el paso decimal
+// más grueso que respeta maxError (unidades crudas), con offset si compensa. Si un bloque no
+// respeta el error o no ocupa menos, va sin cuantizar. Los sensorType sin entrada no se tocan.
+
+struct SensorCodec {
+    uint8_t    sensorType;
+    QuantCodec codec;
+    float      maxError;       // error absoluto máximo, unidades crudas
+};
+
+const SensorCodec kCodecs[] = {
+    {SENSOR_ID_VOLTAJE,                  QUANT_SCALED, 5},    // 0.5 V
+    {SENSOR_ID_CORRIENTE,                QUANT_SCALED, 5},    // 0.05 A
+    {(uint8_t)(SENSOR_ID_EXT_START + 3), QUANT_SCALED, 50},   // 5 W
+};
+
+constexpr size_t kCodecCount = sizeof(kCodecs) / sizeof(kCodecs[0]);
+
 // =================================================================================================
 // Timing
 // =================================================================================================
@@ -98,6 +173,27 @@ inline uint32_t lookupTimeout(uint8_t slaveID) {
     return kBusCfg.defaultTimeoutMs;
 }
 
+inline const SensorDeadband* lookupDeadband(uint8_t sensorType) {
+    for (size_t i = 0; i < kDeadbandCount; ++i) {
+        if (kDeadbands[i].sensorType == sensorType) return &kDeadbands[i];
+    }
+    return nullptr;
+}
+
+inline const SensorCodec* lookupCodec(uint8_t sensorType) {
+    for (size_t i = 0; i < kCodecCount; ++i) {
+        if (kCodecs[i].sensorType == sensorType) return &kCodecs[i];
+    }
+    return nullptr;
+}
+
+inline bool lookupIsFloat(uint8_t sensorType) {
+    for (size_t i = 0; i < kWordTypeCount; ++i) {
+        if (kWordTypes[i].sensorType == sensorType) return kWordTypes[i].isFloat;
+    }
+    return false;
+}
+
 inline bool lookupSwapWords(uint8_t slaveID) {
     for (size_t i = 0; i < kDeviceCfgCount; ++i) {
         if (kDeviceCfg[i].slaveID == slaveID) return kDeviceCfg[i].swapWords;
@@ -0,0 +1,176 @@
+#ifndef QUANT_CODEC_H
+#define QUANT_CODEC_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cmath>
+#include <vector>
+
+// Cuantización con pérdida acotada de un bloque de valores físicos.
+// Bloque codificado: [codec][offset zig-zag varint si QUANT_FLAG_OFFSET][códigos big-endian]
+//   codec bits 7-6: QUANT_KIND_FLOAT16 (IEEE 754 half), QUANT_KIND_INT8, QUANT_KIND_INT16
+//   codec bit 5:    QUANT_FLAG_OFFSET, se suma un offset (en pasos) a cada código
+//   codec bits 4-0: exponente decimal e + 16 del paso (valor = (offset + código) * 10^e)
+// El paso es la mayor potencia de 10 que no supera 2 * error máximo, así que el redondeo al
+// paso más cercano nunca se aleja más del error declarado. Con float16 se comprueba el error
+// valor a valor. El decodificador no necesita ninguna tabla: el bloque se describe solo.
+
+#define QUANT_KIND_FLOAT16 1
+#define QUANT_KIND_INT8    2
+#define QUANT_KIND_INT16   3
+#define QUANT_FLAG_OFFSET  0x20
+#define QUANT_EXP_BIAS     16
+
+// Codec pedido por la configuración del sensor
+enum QuantCodec : uint8_t {
+    QUANT_NONE    = 0,
+    QUANT_FLOAT16 = 1,   // 2 bytes por valor, ~3 cifras significativas
+    QUANT_SCALED  = 2,   // int8 o int16 (con offset si compensa) según el rango del bloque
+};
+
+// float -> IEEE 754 half, redondeo al par más cercano; desborde -> infinito
+inline uint16_t quantFloatToHalf(float f) {
+    uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+    uint16_t sign = (x >> 16) & 0x8000;
+    int32_t  exp  = (int32_t)((x >> 23) & 0xFF) - 127 + 15;
+    uint32_t man  = x & 0x7FFFFF;
+
+    if (((x >> 23) & 0xFF) == 0xFF) {                 // Inf / NaN
+        return sign | 0x7C00 | (man ? 0x200 : 0);
+    }
+    if (exp >= 31) return sign | 0x7C00;
+    if (exp <= 0) {                                    // Subnormal o cero
+        if (exp < -10) return sign;
+        man |= 0x800000;
+        int shift = 14 - exp;
+        uint32_t half = man >> shift;
+        uint32_t rest = man & ((1u << shift) - 1);
+        uint32_t mid  = 1u << (shift - 1);
+        if (rest > mid || (rest == mid && (half & 1))) half++;
+        return sign | (uint16_t)half;
+    }
+    uint32_t half = ((uint32_t)exp << 10) | (man >> 13);
+    uint32_t rest = man & 0x1FFF;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) half++;   // Puede subir al exponente siguiente
+    return sign | (uint16_t)half;
+}
+
+inline float quantHalfToFloat(uint16_t h) {
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exp  = (h >> 10) & 0x1F;
+    uint32_t man  = h & 0x3FF;
+    float f;
+    if (exp == 0) {
+        f = ldexpf((float)man, -24);
+        if (sign) f = -f;
+        return f;
+    }
+    uint32_t x = sign | (exp == 31 ? 0x7F800000 | (man << 13) : ((exp - 15 + 127) << 23) | (man << 13));
+    memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+inline size_t quantVarintSize(uint32_t v) {
+    size_t n = 1;
+    while (v >= 0x80) { v >>= 7; n++; }
+    return n;
+}
+
+/**
+ * @brief Cuantiza un bloque de valores físicos.
+ * @param values   Valores (p. ej. registro crudo / 10^scale).
+ * @param count    Número de valores.
+ * @param codec    QUANT_FLOAT16 o QUANT_SCALED.
+ * @param maxError Error absoluto máximo admitido (QUANT_SCALED: > 0; QUANT_FLOAT16: 0 = sin límite).
+ * @param rawBytes Tamaño del bloque sin codificar.
+ * @param out      Bloque codificado, añadido al final.
+ * @return true si el bloque respeta el error y ocupa menos que rawBytes; si no, @p out queda
+ *         como estaba y el bloque se envía sin codificar.
+ */
+inline bool quant_encode_block(const double* values, size_t count, QuantCodec codec, double maxError,
+                               size_t rawBytes, std::vector<uint8_t>& out) {
+    if (count == 0) return false;
+
+    if (codec == QUANT_FLOAT16) {
+        if (1 + count * 2 >= rawBytes) return false;
+        std::vector<uint8_t> coded;
+        coded.push_back(QUANT_KIND_FLOAT16 << 6);
+        for (size_t i = 0; i < count; ++i) {
+            uint16_t h = quantFloatToHalf((float)values[i]);
+            double back = quantHalfToFloat(h);
+            if (back != back || std::isinf(back) || (maxError > 0 && fabs(back - values[i]) > maxError)) {
+                return false;
+            }
+            coded.push_back(h >> 8);
+            coded.push_back(h & 0xFF);
+        }
+        out.insert(out.end(), coded.begin(), coded.end());
+        return true;
+    }
+
+    if (codec != QUANT_SCALED || !(maxError > 0)) return false;
+
+    int e = (int)floor(log10(2.0 * maxError));
+    if (e < -QUANT_EXP_BIAS) e = -QUANT_EXP_BIAS;
+    if (e > 31 - QUANT_EXP_BIAS) return false;
+    double step = pow(10.0, e);
+
+    std::vector<int64_t> q(count);
+    int64_t qmin = INT64_MAX, qmax = INT64_MIN;
+    for (size_t i = 0; i < count; ++i) {
+        if (values[i] != values[i] || fabs(values[i] / step) > 2e9) return false;
+        q[i] = llround(values[i] / step);
+        if (fabs(q[i] * step - values[i]) > maxError) return false;   // Seguridad ante redondeos
+        if (q[i] < qmin) qmin = q[i];
+        if (q[i] > qmax) qmax = q[i];
+    }
+
+    // Candidatos: int8/int16, sin offset o con el offset que centra el rango del bloque
+    int kind = 0;
+    bool useOffset = false;
+    int64_t offset = 0;
+    size_t best = rawBytes;
+    const int64_t lim[2][2] = {{-128, 127}, {-32768, 32767}};
+    for (int w = 0; w < 2; ++w) {
+        size_t width = w + 1;
+        if (qmin >= lim[w][0] && qmax <= lim[w][1] && 1 + count * width < best) {
+            best = 1 + count * width;
+            kind = w == 0 ? QUANT_KIND_INT8 : QUANT_KIND_INT16;
+            useOffset = false;
+        }
+        int64_t off = qmin - lim[w][0];
+        if (qmax - qmin <= lim[w][1] - lim[w][0]) {
+            uint32_t zz = (uint32_t)((off << 1) ^ (off >> 63));
+            if (off >= -0x3FFFFFFF && off <= 0x3FFFFFFF) {
+                size_t size = 1 + quantVarintSize(zz) + count * width;
+                if (size < best) {
+                    best = size;
+                    kind = w == 0 ? QUANT_KIND_INT8 : QUANT_KIND_INT16;
+                    useOffset = true;
+                    offset = off;
+                }
+            }
+        }
+    }
+    if (kind == 0) return false;
+
+    out.push_back((uint8_t)((kind << 6) | (useOffset ? QUANT_FLAG_OFFSET : 0) | (e + QUANT_EXP_BIAS)));
+    if (useOffset) {
+        uint32_t zz = (uint32_t)((offset << 1) ^ (offset >> 63));
+        while (zz >= 0x80) {
+            out.push_back((uint8_t)(zz | 0x80));
+            zz >>= 7;
+        }
+        out.push_back((uint8_t)zz);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        int64_t code = q[i] - offset;
+        if (kind == QUANT_KIND_INT16) out.push_back((uint8_t)((code >> 8) & 0xFF));
+        out.push_back((uint8_t)(code & 0xFF));
+    }
+    return true;
+}
+
+#endif // QUANT_CODEC_H
@@ -18,11 +18,13 @@
 #include <ctime>
 #include <cstring>
 #include <algorithm>
+#include <cmath>
 #include "ModbusClientRTU.h"
 #include "ModbusAPI.h"
 #include "ModbusConfig.h"
 #include "loraconfig.h"
 #include "SensorRegistry.h"
+#include "GorillaCodec.h"
 #include "Log.h"
 
 // =================================================================================================
@@ -31,19 +33,48 @@
 
 #define MAX_SENSOR_PAYLOAD 128
 
+// Codificación XOR (GorillaCodec.h) de los bloques con 2 o más palabras de 32 bits.
+// Cambia el formato en el aire: activar solo si el decodificador del backend la conoce.
+#ifndef GORILLA_BLOCKS
+#define GORILLA_BLOCKS 0
+#endif
+
 struct SensorDataPayload {
     uint8_t slaveId;
     uint8_t sensorId;
     uint8_t data[MAX_SENSOR_PAYLOAD];
     size_t  dataSize;
     uint8_t  regsPerChannel;   // registers per channel (for the len byte in the payload)
+    uint8_t  lenFlags;         // OR-ed into the len byte (LEN_FLAG_GORILLA)
 };
 
+// Tramas inter-delta: cada KEYFRAME_EVERY tramas una keyframe completa (formato unificado,
+// FPort 1, confirmada); las intermedias (FPort 2) llevan solo los bloques que cambiaron
+// respecto a la última keyframe que el servidor confirmó con ACK:
+//   [ID_MSG][KEY_ID][TIMESTAMP 4B][PRESENT][CARRIED][LEN...][DATA...]
+// PRESENT = sensores leídos en este ciclo; CARRIED = los que van en la trama. Un sensor
+// presente y no transportado vale lo mismo que en la keyframe KEY_ID. Un bloque con
+// LEN_FLAG_KEYDELTA es el XOR contra el bloque de la keyframe (gorilla_encode_delta);
+// sin él, va completo como en una keyframe. 0 = solo tramas completas sin confirmar.
+#ifndef KEYFRAME_EVERY
+#define KEYFRAME_EVERY 8
+#endif
+
+#define LORA_PORT_KEYFRAME 1
+#define LORA_PORT_DELTA    2
+
+constexpr uint8_t LEN_FLAG_KEYDELTA = 0x40;   // Len byte bit 6 (solo en tramas delta)
+constexpr uint8_t LEN_FLAG_QUANT    = 0x80;   // Len byte bit 7: bloque cuantizado (QuantCodec.h)
+
+typedef std::map<uint8_t, std::vector<uint8_t>> SensorGroups;   // sensorType -> bloques de 32 bits
+
 // =================================================================================================
 // Forward Declarations
 // =================================================================================================
 std::vector<uint8_t> construirPayloadUnificado(uint8_t id_mensaje,
     const std::vector<SensorDataPayload>& collectedPayloads);
+std::vector<uint8_t> construirPayloadDelta(uint8_t id_mensaje, uint8_t key_id,
+    const SensorGroups& keyGroups, const SensorGroups& groups);
 static void flushUartRx(HardwareSerial& s);
 
 // =================================================================================================
@@ -58,8 +89,24 @@ SemaphoreHandle_t semaforoEnvioCompleto;
 struct Fragmento {
     uint8_t data[LORA_PAYLOAD_MAX];
     size_t  len;
+    uint8_t port;
+    bool    confirmed;
+    int16_t keyId;      // msgId si es una keyframe, -1 si no
+};
+
+// Keyframes: la última confirmada es la referencia de las tramas delta
+struct KeyframeRef {
+    uint8_t      id;
+    SensorGroups groups;
 };
 
+static KeyframeRef keyRef;                   // Confirmada por el servidor
+static bool        keyRefValid = false;
+static KeyframeRef keyPending;               // Enviada, esperando ACK
+static bool        keyPendingValid = false;
+static volatile int16_t inflightKeyId = -1;  // Keyframe en el aire (tareaLoRa)
+static volatile int16_t keyAckedId    = -1;  // Keyframe confirmada (onEvent)
+
 // =================================================================================================
 // UART Helper
 // =================================================================================================
@@ -107,19 +154,22 @@ std::vector<uint8_t> construirPayloadUnificado(
 
     // 4. Len Bytes (one per active bit, in LSB→MSB order)
     // Uses sensor->regsPerChannel instead of the old getRegistersPerChannel()
+    auto lenByte = [](const SensorDataPayload* s) {
+        return (uint8_t)((s->regsPerChannel & 0x1F) | s->lenFlags);
+    };
     if (activate_byte & (1 << 0)) {
-        payload.push_back(activeSensors.at(SENSOR_ID_BATERIA)->regsPerChannel & 0x1F);
+        payload.push_back(lenByte(activeSensors.at(SENSOR_ID_BATERIA)));
     }
     if (activate_byte & (1 << 1)) {
-        payload.push_back(activeSensors.at(SENSOR_ID_VOLTAJE)->regsPerChannel & 0x1F);
+        payload.push_back(lenByte(activeSensors.at(SENSOR_ID_VOLTAJE)));
     }
     if (activate_byte & (1 << 2)) {
-        payload.push_back(activeSensors.at(SENSOR_ID_CORRIENTE)->regsPerChannel & 0x1F);
+        payload.push_back(lenByte(activeSensors.at(SENSOR_ID_CORRIENTE)));
     }
     for (int i = 0; i < MAX_SENSORES_EXTERNOS; ++i) {
         if (activate_byte & (1 << (i + 3))) {
             uint8_t sid = SENSOR_ID_EXT_START + i;
-            payload.push_back(activeSensors.at(sid)->regsPerChannel & 0x1F);
+            payload.push_back(lenByte(activeSensors.at(sid)));
         }
     }
 
@@ -147,18 +197,252 @@ std::vector<uint8_t> construirPayloadUnificado(
     return payload;
 }
 
+// Palabra de 32 bits big-endian como número (float32 o entero con signo)
+static double wordValue(const uint8_t* p, bool isFloat) {
+    uint32_t u = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+    if (isFloat) {
+        float f;
+        memcpy(&f, &u, sizeof(f));
+        return f;
+    }
+    return (int32_t)u;
+}
+
+/**
+ * @brief Bloque de un sensor tal como va en una keyframe: cuantizado si el sensorType tiene
+ *        codec (kCodecs), XOR-codificado si GORILLA_BLOCKS lo reduce, si no en crudo.
+ */
+static SensorDataPayload makeSensorPayload(uint8_t sensorType, const std::vector<uint8_t>& data) {
+    SensorDataPayload p{};
+    p.sensorId       = sensorType;
+    p.regsPerChannel = (uint8_t)(data.size() / 4);
+
+    const SensorCodec* codec = lookupCodec(sensorType);
+    if (codec != nullptr) {
+        bool isFloat = lookupIsFloat(sensorType);
+        std::vector<double> values;
+        for (size_t off = 0; off + 4 <= data.size(); off += 4) {
+            values.push_back(wordValue(&data[off], isFloat));
+        }
+        std::vector<uint8_t> coded;
+        if (quant_encode_block(values.data(), values.size(), codec->codec, codec->maxError,
+                               data.size(), coded) &&
+            coded.size() <= MAX_SENSOR_PAYLOAD) {
+            LOG_D("SensorType %u: cuantizado %u -> %u bytes", sensorType, data.size(), coded.size());
+            p.lenFlags = LEN_FLAG_QUANT;
+            p.dataSize = coded.size();
+            memcpy(p.data, coded.data(), p.dataSize);
+            return p;
+        }
+    }
+#if GORILLA_BLOCKS
+    std::vector<uint8_t> coded;
+    if (gorilla_encode_block(data.data(), data.size() / 4, coded) &&
+        coded.size() <= MAX_SENSOR_PAYLOAD) {
+        LOG_D("SensorType %u: XOR %u -> %u bytes", sensorType, data.size(), coded.size());
+        p.lenFlags = LEN_FLAG_GORILLA;
+        p.dataSize = coded.size();
+        memcpy(p.data, coded.data(), p.dataSize);
+        return p;
+    }
+#endif
+    p.dataSize = std::min(data.size(), (size_t)MAX_SENSOR_PAYLOAD);
+    memcpy(p.data, data.data(), p.dataSize);
+    return p;
+}
+
+// =================================================================================================
+// Delta Payload Builder — only blocks that changed since the keyframe KEY_ID
+// =================================================================================================
+
+std::vector<uint8_t> construirPayloadDelta(
+    uint8_t id_mensaje, uint8_t key_id,
+    const SensorGroups& keyGroups, const SensorGroups& groups)
+{
+    std::vector<uint8_t> payload;
+    payload.push_back(id_mensaje);
+    payload.push_back(key_id);
+
+    uint32_t ts_s = static_cast<uint32_t>(time(nullptr));
+    payload.push_back((ts_s >> 24) & 0xFF);
+    payload.push_back((ts_s >> 16) & 0xFF);
+    payload.push_back((ts_s >> 8)  & 0xFF);
+    payload.push_back(ts_s & 0xFF);
+
+    // El sensorType coincide con su bit del Activate Byte (SensorRegistry.h)
+    uint8_t present = 0;
+    uint8_t carried = 0;
+    std::vector<uint8_t> lens;
+    std::vector<uint8_t> blocks;
+    for (const auto& kv : groups) {
+        uint8_t sid = kv.first;
+        const auto& data = kv.second;
+        if (sid >= 8 || data.empty()) continue;
+        present |= (1 << sid);
+
+        auto ref = keyGroups.find(sid);
+        bool sameShape = ref != keyGroups.end() && ref->second.size() == data.size();
+        if (sameShape && ref->second == data) continue;   // Igual que en la keyframe
+
+        SensorDataPayload full = makeSensorPayload(sid, data);
+        std::vector<uint8_t> delta;
+        if (sameShape && gorilla_encode_delta(data.data(), ref->second.data(), data.size() / 4, delta) &&
+            delta.size() < full.dataSize) {
+            lens.push_back((uint8_t)((full.regsPerChannel & 0x1F) | LEN_FLAG_KEYDELTA));
+            blocks.insert(blocks.end(), delta.begin(), delta.end());
+        } else {
+            lens.push_back((uint8_t)((full.regsPerChannel & 0x1F) | full.lenFlags));
+            blocks.insert(blocks.end(), full.data, full.data + full.dataSize);
+        }
+        carried |= (1 << sid);
+    }
+
+    payload.push_back(present);
+    payload.push_back(carried);
+    payload.insert(payload.end(), lens.begin(), lens.end());
+    payload.insert(payload.end(), blocks.begin(), blocks.end());
+    return payload;
+}
+
+// =================================================================================================
+// Report-by-exception — deadband + heartbeat per sensorType (kDeadbands)
+// =================================================================================================
+
+struct DeadbandState {
+    std::vector<uint8_t> last;   // Último grupo enviado
+    uint32_t             sentMs;
+};
+static std::map<uint8_t, DeadbandState> deadbandState;
+
+/**
+ * @brief true si el grupo sale de la banda muerta o le toca el heartbeat.
+ */
+static bool deadbandPasses(uint8_t sensorType, const std::vector<uint8_t>& data, uint32_t nowMs) {
+    const SensorDeadband* db = lookupDeadband(sensorType);
+    if (db == nullptr) return true;
+    auto it = deadbandState.find(sensorType);
+    if (it == deadbandState.end() || it->second.last.size() != data.size()) return true;
+    if (db->heartbeatMs > 0 && nowMs - it->second.sentMs >= db->heartbeatMs) return true;
+
+    bool isFloat = lookupIsFloat(sensorType);
+    for (size_t off = 0; off + 4 <= data.size(); off += 4) {
+        double cur  = wordValue(&data[off], isFloat);
+        double ref  = wordValue(&it->second.last[off], isFloat);
+        double band = std::max((double)db->absDeadband, fabs(ref) * db->relPct / 100.0);
+        if (fabs(cur - ref) > band || cur != cur) return true;   // NaN: siempre se envía
+    }
+    return false;
+}
+
+// Los grupos enviados pasan a ser la referencia de la banda muerta
+static void deadbandCommit(const SensorGroups& sent, uint32_t nowMs) {
+    for (const auto& kv : sent) {
+        if (lookupDeadband(kv.first) == nullptr) continue;
+        DeadbandState& st = deadbandState[kv.first];
+        st.last   = kv.second;
+        st.sentMs = nowMs;
+    }
+}
+
+// =================================================================================================
+// Sequence-window reads — only samples not yet seen
+// =================================================================================================
+
+// Última secuencia reenviada por cada entrada de kRequests (0 = ninguna)
+static uint32_t seqLast[kRequestCount];
+static uint32_t seqMissed[kRequestCount];
+
+/**
+ * @brief Lee de la ventana por secuencia las muestras posteriores a seqLast[idx].
+ * @details Cabecera en req.startAddr y H ranuras de C registros detrás; la muestra
+ *          s vive en la ranura s % H. Se leen como mucho dos tramos (si el anillo da
+ *          la vuelta) y se emiten canal a canal, una muestra por bloque de 32 bits.
+ * @return false si alguna lectura falla.
+ */
+static bool readSeqWindow(size_t idx, uint8_t fnCode, uint32_t timeout, std::vector<uint8_t>& bytes) {
+    const auto& req = kRequests[idx];
+
+    ModbusApiResult hdr = modbus_api_read_registers(
+        req.slaveID, fnCode, req.startAddr, SEQ_WINDOW_HEADER, timeout);
+    if (hdr.error_code != ModbusApiError::SUCCESS || hdr.data_len < SEQ_WINDOW_HEADER * 2) {
+        return false;
+    }
+
+    uint32_t seq = ((uint32_t)hdr.data[0] << 24) | ((uint32_t)hdr.data[1] << 16) |
+                   ((uint32_t)hdr.data[2] << 8) | hdr.data[3];
+    uint16_t depth    = (hdr.data[4] << 8) | hdr.data[5];
+    uint16_t channels = (hdr.data[6] << 8) | hdr.data[7];
+    if (depth < 2 || channels == 0 || channels != req.numRegs) {
+        LOG_W("  -> Ventana inválida: Slave=%u, H=%u, C=%u", req.slaveID, depth, channels);
+        return false;
+    }
+
+    if (seq < seqLast[idx]) {
+        LOG_W("  -> Slave=%u reinició su secuencia (%u < %u)", req.slaveID, seq, seqLast[idx]);
+        seqLast[idx] = 0;
+    }
+
+    // Una ranura de margen (el esclavo puede publicar entre cabecera y datos),
+    // y lo que quepa en una respuesta y en el bloque del payload
+    uint32_t maxNew = depth - 1;
+    maxNew = std::min<uint32_t>(maxNew, (MODBUS_API_MAX_DATA_SIZE / 2) / channels);
+    maxNew = std::min<uint32_t>(maxNew, (MAX_SENSOR_PAYLOAD / 4) / channels);
+
+    uint32_t fresh = seq - seqLast[idx];
+    if (seqLast[idx] != 0 && fresh > maxNew) {
+        seqMissed[idx] += fresh - maxNew;
+        LOG_W("  -> HUECO Slave=%u: %u muestras perdidas (total %u)",
+              req.slaveID, fresh - maxNew, seqMissed[idx]);
+    }
+    if (fresh > maxNew) fresh = maxNew;
+    if (fresh == 0) return true;
+
+    uint32_t first = seq - fresh + 1;
+    uint16_t slot  = first % depth;
+    uint16_t n1    = std::min<uint32_t>(fresh, depth - slot);
+    uint16_t n2    = fresh - n1;
+
+    std::vector<uint8_t> raw;
+    raw.reserve(fresh * channels * 2);
+    ModbusApiResult part = modbus_api_read_registers(
+        req.slaveID, fnCode, req.startAddr + SEQ_WINDOW_HEADER + slot * channels, n1 * channels, timeout);
+    if (part.error_code != ModbusApiError::SUCCESS) return false;
+    raw.insert(raw.end(), part.data, part.data + part.data_len);
+    if (n2 > 0) {
+        part = modbus_api_read_registers(
+            req.slaveID, fnCode, req.startAddr + SEQ_WINDOW_HEADER, n2 * channels, timeout);
+        if (part.error_code != ModbusApiError::SUCCESS) return false;
+        raw.insert(raw.end(), part.data, part.data + part.data_len);
+    }
+    if (raw.size() < (size_t)fresh * channels * 2) return false;
+
+    // Ranuras (muestra-mayor) -> bloques de 32 bits canal a canal
+    for (uint16_t ch = 0; ch < channels; ++ch) {
+        for (uint32_t i = 0; i < fresh; ++i) {
+            size_t off = (i * channels + ch) * 2;
+            bytes.push_back(0x00);
+            bytes.push_back(0x00);
+            bytes.push_back(raw[off]);
+            bytes.push_back(raw[off + 1]);
+        }
+    }
+
+    seqLast[idx] = seq;
+    LOG_D("  -> Ventana: seq=%u, %u muestras nuevas x %u canales", seq, fresh, channels);
+    return true;
+}
+
 // =================================================================================================
 // Main Polling Task — reads all requests in batch, groups by sensorType, sends via LoRa
 // =================================================================================================
 
 void mainPollingTask(void *pvParameters) {
     uint8_t msgId = 0;
+    uint8_t framesSinceKey = 0;   // Tramas desde la última keyframe enviada
 
     while (true) {
         // Group accumulated data:  sensorType → concatenated bytes
-        std::map<uint8_t, std::vector<uint8_t>> groups;
-        // Registers per channel for each sensorType (for the len byte)
-        std::map<uint8_t, uint8_t> regsPerChannel;
+        SensorGroups groups;
         // SensorTypes that had at least one failure — excluded from payload
         std::set<uint8_t> failedTypes;
 
@@ -174,6 +458,19 @@ void mainPollingTask(void *pvParameters) {
                   req.slaveID, req.startAddr, req.numRegs, fnCode);
 
             flushUartRx(Serial2);
+            if (req.seqWindow) {
+                std::vector<uint8_t> bytes;
+                if (readSeqWindow(i, fnCode, timeout, bytes)) {
+                    auto& group = groups[req.sensorType];
+                    group.insert(group.end(), bytes.begin(), bytes.end());
+                    LOG_D("  -> OK: %u bytes", bytes.size());
+                } else {
+                    LOG_W("  -> Error ventana: Slave=%u, Addr=%u", req.slaveID, req.startAddr);
+                    failedTypes.insert(req.sensorType);
+                }
+                continue;
+            }
+
             ModbusApiResult result = modbus_api_read_registers(
                 req.slaveID, fnCode, req.startAddr, req.numRegs, timeout);
 
@@ -222,40 +519,77 @@ void mainPollingTask(void *pvParameters) {
             while (kv.second.size() % 4 != 0) {
                 kv.second.insert(kv.second.begin(), 0x00);
             }
-            regsPerChannel[kv.first] = (uint8_t)(kv.second.size() / 4);
         }
 
-        // Assemble payloads and send
-        if (!groups.empty()) {
-            std::vector<SensorDataPayload> payloads;
-            for (const auto& kv : groups) {
-                uint8_t sensorType = kv.first;
-                const auto& data   = kv.second;
-                if (data.empty()) continue;
-                if (failedTypes.count(sensorType)) {
-                    LOG_W("SensorType %u: descartado (fallo parcial en al menos un canal)", sensorType);
-                    continue;
-                }
-
-                SensorDataPayload p{};
-                p.sensorId       = sensorType;
-                p.dataSize       = std::min(data.size(), (size_t)MAX_SENSOR_PAYLOAD);
-                p.regsPerChannel = regsPerChannel[sensorType];
-                memcpy(p.data, data.data(), p.dataSize);
+        // Drop sensor types with a partial failure, and those still inside their deadband
+        uint32_t nowMs = millis();
+        SensorGroups valid;
+        for (const auto& kv : groups) {
+            if (kv.second.empty()) continue;
+            if (failedTypes.count(kv.first)) {
+                LOG_W("SensorType %u: descartado (fallo parcial en al menos un canal)", kv.first);
+                continue;
+            }
+            if (!deadbandPasses(kv.first, kv.second, nowMs)) {
+                LOG_D("SensorType %u: dentro de la banda muerta, no se envía", kv.first);
+                continue;
+            }
+            valid[kv.first] = kv.second;
+        }
 
-                payloads.push_back(p);
+        // Assemble payloads and send
+        if (!valid.empty()) {
+            // Keyframe confirmada desde el ciclo anterior: pasa a ser la referencia
+            if (keyPendingValid && keyAckedId == keyPending.id) {
+                keyRef = keyPending;
+                keyRefValid = true;
+                keyPendingValid = false;
+                keyAckedId = -1;
+                LOG_I("Keyframe %u confirmada: referencia de las tramas delta", keyRef.id);
             }
 
-            std::vector<uint8_t> unified = construirPayloadUnificado(msgId, payloads);
+            bool keyframe = KEYFRAME_EVERY == 0 || !keyRefValid || framesSinceKey + 1 >= KEYFRAME_EVERY;
 
             Fragmento frag;
+            std::vector<uint8_t> unified;
+            if (keyframe) {
+                std::vector<SensorDataPayload> payloads;
+                SensorGroups lossless;   // Solo lo que el servidor reconstruye exacto sirve de referencia
+                for (const auto& kv : valid) {
+                    payloads.push_back(makeSensorPayload(kv.first, kv.second));
+                    if (!(payloads.back().lenFlags & LEN_FLAG_QUANT)) lossless[kv.first] = kv.second;
+                }
+                unified = construirPayloadUnificado(msgId, payloads);
+
+                frag.port      = LORA_PORT_KEYFRAME;
+                frag.confirmed = KEYFRAME_EVERY > 0;
+                frag.keyId     = frag.confirmed ? msgId : -1;
+                if (frag.confirmed) {
+                    keyPending.id     = msgId;
+                    keyPending.groups = lossless;
+                    keyPendingValid   = true;
+                }
+                framesSinceKey = 0;
+                LOG_I("Keyframe %u: %u bytes (%zu grupos de sensores)",
+                      msgId, unified.size(), payloads.size());
+            } else {
+                unified = construirPayloadDelta(msgId, keyRef.id, keyRef.groups, valid);
+
+                frag.port      = LORA_PORT_DELTA;
+                frag.confirmed = false;
+                frag.keyId     = -1;
+                framesSinceKey++;
+                LOG_I("Delta %u sobre keyframe %u: %u bytes", msgId, keyRef.id, unified.size());
+            }
+
             frag.len = std::min(unified.size(), (size_t)LORA_PAYLOAD_MAX);
             memcpy(frag.data, unified.data(), frag.len);
 
-            LOG_I("Enviando %u bytes por LoRa (%zu grupos de sensores)",
-                  frag.len, payloads.size());
-
-            xQueueSend(queueFragmentos, &frag, pdMS_TO_TICKS(100));
+            if (xQueueSend(queueFragmentos, &frag, pdMS_TO_TICKS(100)) == pdTRUE) {
+                deadbandCommit(valid, nowMs);
+            }
+        } else {
+            LOG_I("Ningún grupo que enviar en este ciclo (banda muerta o fallos)");
         }
 
         ++msgId;
@@ -280,7 +614,9 @@ void onEvent(ev_t ev) {
         xSemaphoreGive(semaforoEnvioCompleto);
         if (LMIC.txrxFlags & TXRX_ACK) {
             LOG_I("LoRa: ACK recibido.");
+            if (inflightKeyId >= 0) keyAckedId = inflightKeyId;
         }
+        inflightKeyId = -1;
     }
 }
 
@@ -311,7 +647,8 @@ void tareaLoRa(void *pvParameters) {
                 }
                 Serial.println();
             }
-            LMIC_setTxData2(1, frag.data, frag.len, 0);
+            inflightKeyId = frag.keyId;
+            LMIC_setTxData2(frag.port, frag.data, frag.len, frag.confirmed ? 1 : 0);
         }
         vTaskDelay(pdMS_TO_TICKS(10));
     }
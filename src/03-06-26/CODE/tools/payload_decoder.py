@@ -0,0 +1,259 @@
+#!/usr/bin/env python3
+"""Reference decoder for the unified LoRa payload of the 03-06-26 master and phantom node.
+
+The header stays the classic [ID_MSG][TIMESTAMP 4B]: the compact v2 header of the
+30-01-25 master is not used here, because delta frames refer to their keyframe by ID_MSG.
+
+Keyframe (FPort 1, the classic unified payload):
+    [ID_MSG][TIMESTAMP 4B][ACTIVATE][LEN...][DATA...]
+Delta frame (FPort 2, KEYFRAME_EVERY > 0):
+    [ID_MSG][KEY_ID][TIMESTAMP 4B][PRESENT][CARRIED][LEN...][DATA...]
+    A sensor in PRESENT but not in CARRIED holds the same words as in keyframe KEY_ID.
+    LEN bit 6 (LEN_FLAG_KEYDELTA): the block is XOR-coded against the keyframe block,
+    word by word (same stream as below, with no raw first word).
+
+ACTIVATE bit i set = sensor ID i present; one LEN byte per set bit, LSB first.
+LEN bits 0-4 = number of 32-bit words in the block; bit 5 (LEN_FLAG_GORILLA) = the
+block is XOR-coded (include/GorillaCodec.h):
+    first word 32 bits, then per word XOR with the previous one:
+        '0'                               same value
+        '10' + meaningful bits            inside the previous window
+        '11' + lead(5) + len-1(5) + bits  new window
+    MSB first, zero-padded to the byte.
+LEN bit 7 (LEN_FLAG_QUANT): the block is quantized (include/QuantCodec.h):
+    [codec][offset zig-zag varint if bit 5][codes], codec bits 7-6 = 1 float16,
+    2 int8, 3 int16 (signed, big-endian), bits 4-0 = e + 16;
+    value = (offset + code) * 10^e, in raw register units. Quantized blocks are lossy,
+    so they never serve as keyframe reference.
+Plain blocks are LEN * 4 bytes. Words are printed as uint32 and as float32; which one
+applies depends on the sensor.
+
+Usage:
+    payload_decoder.py [--port N] 0a6650f1c20302... 2:0b0a6650f1e002...
+A "PORT:" prefix overrides --port for one payload. Payloads given on one command line
+are decoded in order; keyframes are kept so the delta frames that follow can be rebuilt.
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+LEN_FLAG_GORILLA = 0x20
+LEN_FLAG_KEYDELTA = 0x40
+LEN_FLAG_QUANT = 0x80
+QUANT_KIND_FLOAT16 = 1
+QUANT_KIND_INT8 = 2
+QUANT_KIND_INT16 = 3
+QUANT_FLAG_OFFSET = 0x20
+QUANT_EXP_BIAS = 16
+PORT_KEYFRAME = 1
+PORT_DELTA = 2
+
+
+class PayloadError(ValueError):
+    pass
+
+
+class BitReader:
+    def __init__(self, data):
+        self.data = data
+        self.bit = 0
+
+    def get(self, nbits):
+        value = 0
+        for _ in range(nbits):
+            byte = self.bit >> 3
+            if byte >= len(self.data):
+                raise PayloadError("XOR block truncated")
+            value = (value << 1) | ((self.data[byte] >> (7 - (self.bit & 7))) & 1)
+            self.bit += 1
+        return value
+
+    def bytes_used(self):
+        return (self.bit + 7) // 8
+
+
+def gorilla_decode(data, words, ref=None):
+    """Returns (words, bytes consumed) of an XOR-coded block.
+
+    Without ref every word is XOR-ed with the previous one (the first is raw);
+    with ref, with the word at the same position of the reference block.
+    """
+    r = BitReader(data)
+    out = []
+    if ref is None:
+        prev = r.get(32)
+        out.append(prev)
+        count = words - 1
+    else:
+        if len(ref) != words:
+            raise PayloadError("keyframe block has %d words, delta %d" % (len(ref), words))
+        count = words
+    lead, trail = None, 0
+    for i in range(count):
+        if ref is not None:
+            prev = ref[i]
+        if r.get(1) == 0:
+            out.append(prev)
+            continue
+        if r.get(1) == 0:
+            if lead is None:
+                raise PayloadError("XOR block reuses a window before defining one")
+        else:
+            lead = r.get(5)
+            trail = 32 - lead - (r.get(5) + 1)
+            if trail < 0:
+                raise PayloadError("XOR window out of range")
+        prev ^= r.get(32 - lead - trail) << trail
+        out.append(prev)
+    return out, r.bytes_used()
+
+
+def quant_decode(data, count):
+    """Returns (values, bytes consumed) of a quantized block."""
+    pos = 0
+
+    def take(n):
+        nonlocal pos
+        if pos + n > len(data):
+            raise PayloadError("quantized block truncated")
+        chunk = data[pos:pos + n]
+        pos += n
+        return chunk
+
+    codec = take(1)[0]
+    kind = codec >> 6
+    if kind == QUANT_KIND_FLOAT16:
+        return [struct.unpack(">e", take(2))[0] for _ in range(count)], pos
+    if kind not in (QUANT_KIND_INT8, QUANT_KIND_INT16):
+        raise PayloadError("unknown quantization codec 0x%02x" % codec)
+    offset = 0
+    if codec & QUANT_FLAG_OFFSET:
+        zz, shift = 0, 0
+        while True:
+            b = take(1)[0]
+            zz |= (b & 0x7F) << shift
+            shift += 7
+            if not b & 0x80:
+                break
+        offset = (zz >> 1) ^ -(zz & 1)
+    exp = (codec & 0x1F) - QUANT_EXP_BIAS
+    width = 1 if kind == QUANT_KIND_INT8 else 2
+    values = [round((offset + int.from_bytes(take(width), "big", signed=True)) * 10.0 ** exp, max(0, -exp))
+              for _ in range(count)]
+    return values, pos
+
+
+def as_float(word):
+    return struct.unpack(">f", struct.pack(">I", word))[0]
+
+
+def block_entry(sid, words, **extra):
+    entry = {"sensor": sid}
+    entry.update(extra)
+    entry["uint32"] = words
+    entry["float32"] = [as_float(w) for w in words]
+    return entry
+
+
+def decode(frame, port=PORT_KEYFRAME, keyframes=None):
+    """Decodes one payload; keyframes (id -> {sensor: words}) is read and updated."""
+    delta = port == PORT_DELTA
+    header = 8 if delta else 6
+    if len(frame) < header:
+        raise PayloadError("payload shorter than the header")
+    out = {"id": frame[0]}
+    if delta:
+        out["key_id"] = frame[1]
+        ts_at = 2
+    else:
+        ts_at = 1
+    out["timestamp"] = int.from_bytes(frame[ts_at:ts_at + 4], "big")
+
+    ref = None
+    if delta:
+        present, activate = frame[6], frame[7]
+        if keyframes is None or out["key_id"] not in keyframes:
+            raise PayloadError("keyframe %d not received" % out["key_id"])
+        ref = keyframes[out["key_id"]]
+    else:
+        activate = frame[5]
+        present = activate
+    ids = [i for i in range(8) if activate & (1 << i)]
+    pos = header + len(ids)
+    if pos > len(frame):
+        raise PayloadError("len bytes truncated")
+    lens = frame[header:pos]
+
+    state = {}   # Lossless blocks: keyframe reference
+    blocks = []
+    for sid, len_byte in zip(ids, lens):
+        count = len_byte & 0x1F
+        coded = bool(len_byte & LEN_FLAG_GORILLA)
+        keydelta = delta and bool(len_byte & LEN_FLAG_KEYDELTA)
+        if len_byte & LEN_FLAG_QUANT:
+            values, used = quant_decode(frame[pos:], count)
+            blocks.append({"sensor": sid, "quantized": True, "bytes": used, "values": values})
+            pos += used
+            continue
+        if keydelta:
+            if sid not in ref:
+                raise PayloadError("sensor %d not in keyframe %d" % (sid, out["key_id"]))
+            words, used = gorilla_decode(frame[pos:], count, ref[sid])
+        elif coded:
+            words, used = gorilla_decode(frame[pos:], count)
+        else:
+            used = count * 4
+            if pos + used > len(frame):
+                raise PayloadError("block of sensor %d truncated" % sid)
+            words = [int.from_bytes(frame[pos + i:pos + i + 4], "big") for i in range(0, used, 4)]
+        state[sid] = words
+        extra = {"xor": coded, "bytes": used}
+        if delta:
+            extra["keydelta"] = keydelta
+        blocks.append(block_entry(sid, words, **extra))
+        pos += used
+
+    if delta:
+        # Present but not carried: unchanged since the keyframe
+        for sid in range(8):
+            if present & (1 << sid) and not activate & (1 << sid):
+                if sid not in ref:
+                    raise PayloadError("sensor %d not in keyframe %d" % (sid, out["key_id"]))
+                state[sid] = ref[sid]
+                blocks.append(block_entry(sid, ref[sid], carried=False))
+        blocks.sort(key=lambda b: b["sensor"])
+    elif keyframes is not None:
+        keyframes[out["id"]] = state
+
+    out["blocks"] = blocks
+    if pos != len(frame):
+        out["trailing"] = frame[pos:].hex()
+    return out
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--port", type=int, default=PORT_KEYFRAME,
+                    help="FPort of the payloads: 1 keyframe (default), 2 delta")
+    ap.add_argument("payloads", nargs="+", help="payloads in hex, optionally PORT:HEX")
+    args = ap.parse_args()
+
+    keyframes = {}
+    status = 0
+    for text in args.payloads:
+        port = args.port
+        if ":" in text:
+            prefix, text = text.split(":", 1)
+            port = int(prefix)
+        try:
+            print(json.dumps(decode(bytes.fromhex(text), port, keyframes)))
+        except (PayloadError, ValueError) as e:
+            print(json.dumps({"error": str(e), "payload": text}))
+            status = 1
+    return status
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -20,5 +20,48 @@ void biquad_set_lowpass(Biquad* s, float fs_hz, float f0_hz, float Q);
 // Diseña como paso alto (HPF)
 void biquad_set_highpass(Biquad* s, float fs_hz, float f0_hz, float Q);
 
+// Carga una sección SOS [b0, b1, b2, a0, a1, a2] (normaliza por a0)
+void biquad_set_sos(Biquad* s, const float sos[6]);
+
 // Procesa una muestra
 float biquad_process(Biquad* s, float x);
+
+// Procesa un bloque de n muestras (in y out pueden ser el mismo buffer)
+void biquad_process_block(Biquad* s, const float* in, float* out, int n);
+
+// ---------------------------------------------------------------------------
+// Cascada de secciones (SOS) para filtros de orden > 2
+#define BIQUAD_MAX_SECCIONES 4
+
+typedef struct {
+    Biquad etapas[BIQUAD_MAX_SECCIONES];
+    int num_etapas;
+} BiquadCascade;
+
+void biquad_cascade_init(BiquadCascade* c, const float (*sos)[6], int num_secciones);
+void biquad_cascade_reset(BiquadCascade* c);
+void biquad_cascade_process_block(BiquadCascade* c, const float* in, float* out, int n);
+
+// ---------------------------------------------------------------------------
+// Variante en punto fijo: forma directa I, coeficientes Q2.29, acumulador de
+// 64 bits. Las muestras son enteros con signo (p. ej. ADC centrado << 4).
+typedef struct {
+    int32_t b0, b1, b2;
+    int32_t a1, a2;
+    int32_t x1, x2;
+    int32_t y1, y2;
+} BiquadQ29;
+
+typedef struct {
+    BiquadQ29 etapas[BIQUAD_MAX_SECCIONES];
+    int num_etapas;
+} BiquadCascadeQ29;
+
+// Carga [b0, b1, b2, a1, a2] en Q2.29
+void biquad_q29_set(BiquadQ29* s, const int32_t coef[5]);
+void biquad_q29_reset(BiquadQ29* s);
+void biquad_q29_process_block(BiquadQ29* s, const int32_t* in, int32_t* out, int n);
+
+void biquad_cascade_q29_init(BiquadCascadeQ29* c, const int32_t (*coef)[5], int num_secciones);
+void biquad_cascade_q29_reset(BiquadCascadeQ29* c);
+void biquad_cascade_q29_process_block(BiquadCascadeQ29* c, const int32_t* in, int32_t* out, int n);
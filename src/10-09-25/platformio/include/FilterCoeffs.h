@@ -0,0 +1,61 @@
+#pragma once
+
+// ARCHIVO GENERADO por scripts/gen_filter_coeffs.py - no editar a mano.
+// Diseños equivalentes a Filtros.ipynb para FS_HZ = 960.
+
+#include <stdint.h>
+
+#define FILTRO_COEF_FS_HZ 960
+
+// Pasabanda Butterworth orden 4, 55-65 Hz: SOS [b0, b1, b2, a0, a1, a2]
+#define BP_NUM_SECCIONES 4
+static const float BP_SOS[BP_NUM_SECCIONES][6] = {
+    {3.204403265e-02f, 0.000000000e+00f, -3.204403265e-02f, 1.000000000e+00f, -1.783296799e+00f, 9.395627170e-01f},
+    {3.204403265e-02f, 0.000000000e+00f, -3.204403265e-02f, 1.000000000e+00f, -1.805123721e+00f, 9.430311914e-01f},
+    {3.204403265e-02f, 0.000000000e+00f, -3.204403265e-02f, 1.000000000e+00f, -1.799745237e+00f, 9.734936556e-01f},
+    {3.204403265e-02f, 0.000000000e+00f, -3.204403265e-02f, 1.000000000e+00f, -1.848748991e+00f, 9.770632665e-01f},
+};
+
+// Mismo pasabanda en Q2.29: [b0, b1, b2, a1, a2]
+#define BP_SOS_Q 29
+static const int32_t BP_SOS_Q29[BP_NUM_SECCIONES][5] = {
+    {17203509, 0, -17203509, -957400179, 504423893},
+    {17203509, 0, -17203509, -969118418, 506286016},
+    {17203509, 0, -17203509, -966230867, 522640427},
+    {17203509, 0, -17203509, -992539557, 524556847},
+};
+
+// FIR paso bajo 67 taps, corte 100 Hz (Hamming)
+#define FIR_NUM_TAPS 67
+static const float FIR_TAPS_F32[FIR_NUM_TAPS] = {
+    2.946842653e-04f, 7.056261502e-04f, 8.971638433e-04f, 7.384621694e-04f,
+    1.614841986e-04f, -7.438307535e-04f, -1.663223441e-03f, -2.105447599e-03f,
+    -1.601737811e-03f, 1.934994849e-18f, 2.296675352e-03f, 4.323386186e-03f,
+    4.875841504e-03f, 3.093449628e-03f, -9.417103065e-04f, -5.921369278e-03f,
+    -9.598089660e-03f, -9.660539917e-03f, -4.906576325e-03f, 3.807898232e-03f,
+    1.338435879e-02f, 1.935224596e-02f, 1.764029868e-02f, 6.633113842e-03f,
+    -1.136203723e-02f, -3.001616215e-02f, -4.056188838e-02f, -3.470114254e-02f,
+    -7.868156940e-03f, 3.839722552e-02f, 9.599899313e-02f, 1.521352071e-01f,
+    1.929669023e-01f, 2.078977910e-01f, 1.929669023e-01f, 1.521352071e-01f,
+    9.599899313e-02f, 3.839722552e-02f, -7.868156940e-03f, -3.470114254e-02f,
+    -4.056188838e-02f, -3.001616215e-02f, -1.136203723e-02f, 6.633113842e-03f,
+    1.764029868e-02f, 1.935224596e-02f, 1.338435879e-02f, 3.807898232e-03f,
+    -4.906576325e-03f, -9.660539917e-03f, -9.598089660e-03f, -5.921369278e-03f,
+    -9.417103065e-04f, 3.093449628e-03f, 4.875841504e-03f, 4.323386186e-03f,
+    2.296675352e-03f, 1.934994849e-18f, -1.601737811e-03f, -2.105447599e-03f,
+    -1.663223441e-03f, -7.438307535e-04f, 1.614841986e-04f, 7.384621694e-04f,
+    8.971638433e-04f, 7.056261502e-04f, 2.946842653e-04f,
+};
+
+#define FIR_Q 15
+static const int16_t FIR_TAPS_Q15[FIR_NUM_TAPS] = {
+    10, 23, 29, 24, 5, -24, -55, -69,
+    -52, 0, 75, 142, 160, 101, -31, -194,
+    -315, -317, -161, 125, 439, 634, 578, 217,
+    -372, -984, -1329, -1137, -258, 1258, 3146, 4985,
+    6323, 6812, 6323, 4985, 3146, 1258, -258, -1137,
+    -1329, -984, -372, 217, 578, 634, 439, 125,
+    -161, -317, -315, -194, -31, 101, 160, 142,
+    75, 0, -52, -69, -55, -24, 5, 24,
+    29, 23, 10,
+};
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <stdint.h>
+
 // FIR de 67 taps para filtrar antes del cálculo RMS
+// (taps generados en FilterCoeffs.h por scripts/gen_filter_coeffs.py)
 #define SAMPLEFILTER_TAP_NUM 67
 
 typedef struct {
@@ -11,3 +14,15 @@ typedef struct {
 void SampleFilter_init(SampleFilter* f);
 void SampleFilter_put(SampleFilter* f, float input);
 float SampleFilter_get(SampleFilter* f);
+
+// Procesa un bloque de n muestras (in y out pueden ser el mismo buffer)
+void SampleFilter_process_block(SampleFilter* f, const float* in, float* out, int n);
+
+// Variante en punto fijo: taps Q15, muestras int16 centradas, acumulador int32
+typedef struct {
+  int16_t history[SAMPLEFILTER_TAP_NUM];
+  unsigned int last_index;
+} SampleFilterQ15;
+
+void SampleFilterQ15_init(SampleFilterQ15* f);
+void SampleFilterQ15_process_block(SampleFilterQ15* f, const int16_t* in, int16_t* out, int n);
@@ -0,0 +1,174 @@
+"""
+Generador de tablas de coeficientes para la cadena DSP (include/FilterCoeffs.h).
+
+Reproduce los diseños de Filtros.ipynb sin depender de scipy, para poder
+ejecutarse como script previo de PlatformIO (extra_scripts = pre:...):
+
+  - Pasabanda Butterworth orden 4 (55-65 Hz) en secciones de segundo orden.
+  - FIR paso bajo de 67 taps (ventana Hamming) para limitar armónicos/ruido.
+
+La frecuencia de muestreo se toma de -D FS_HZ en build_flags (960 por defecto).
+También puede ejecutarse a mano:
+
+    python scripts/gen_filter_coeffs.py --fs 9600
+"""
+
+import cmath
+import math
+import os
+import sys
+
+# Parámetros del diseño (los mismos del notebook)
+BP_ORDEN = 4
+BP_F_BAJA = 55.0
+BP_F_ALTA = 65.0
+FIR_TAPS = 67          # Debe coincidir con SAMPLEFILTER_TAP_NUM
+FIR_CORTE_HZ = 100.0
+
+Q_BIQUAD = 29          # Coeficientes biquad en Q2.29
+Q_FIR = 15             # Taps FIR en Q15
+
+SALIDA = os.path.join("include", "FilterCoeffs.h")
+
+
+def butter_bandpass_sos(orden, f1, f2, fs):
+    """Pasabanda Butterworth por transformación bilineal, devuelto como SOS
+    [b0, b1, b2, 1, a1, a2]. La ganancia se reparte por igual entre
+    secciones para acotar el rango de los coeficientes en punto fijo."""
+    fs2 = 2.0 * fs
+    w1 = fs2 * math.tan(math.pi * f1 / fs)
+    w2 = fs2 * math.tan(math.pi * f2 / fs)
+    bw = w2 - w1
+    w0 = math.sqrt(w1 * w2)
+
+    # Prototipo paso bajo analógico y transformación LP -> BP
+    polos_s = []
+    for k in range(orden):
+        p = cmath.exp(1j * math.pi * (2 * k + orden + 1) / (2 * orden))
+        a = p * bw / 2.0
+        r = cmath.sqrt(a * a - w0 * w0)
+        polos_s += [a + r, a - r]
+    k_s = bw ** orden
+
+    # Bilineal: ceros en s=0 -> z=1, ceros en infinito -> z=-1
+    polos_z = [(fs2 + p) / (fs2 - p) for p in polos_s]
+    den = 1.0 + 0j
+    for p in polos_s:
+        den *= (fs2 - p)
+    k_z = (k_s * fs2 ** orden / den).real
+
+    # Agrupar pares conjugados (parte imaginaria positiva)
+    sup = sorted([p for p in polos_z if p.imag > 0], key=lambda p: abs(p))
+    g = abs(k_z) ** (1.0 / orden)
+    signo = 1.0 if k_z >= 0 else -1.0
+    sos = []
+    for i, p in enumerate(sup):
+        gi = g * (signo if i == 0 else 1.0)
+        sos.append([gi, 0.0, -gi, 1.0, -2.0 * p.real, abs(p) ** 2])
+    return sos
+
+
+def fir_paso_bajo(taps, fc, fs):
+    """FIR de fase lineal por sinc enventanada (Hamming), ganancia DC = 1."""
+    m = (taps - 1) / 2.0
+    wc = fc / (fs / 2.0)
+    h = []
+    for n in range(taps):
+        x = n - m
+        s = wc if x == 0 else math.sin(math.pi * wc * x) / (math.pi * x)
+        w = 0.54 - 0.46 * math.cos(2.0 * math.pi * n / (taps - 1))
+        h.append(s * w)
+    total = sum(h)
+    return [v / total for v in h]
+
+
+def a_punto_fijo(v, q):
+    return int(round(v * (1 << q)))
+
+
+def generar(fs):
+    sos = butter_bandpass_sos(BP_ORDEN, BP_F_BAJA, BP_F_ALTA, fs)
+    fir = fir_paso_bajo(FIR_TAPS, FIR_CORTE_HZ, fs)
+    fir_q = [a_punto_fijo(v, Q_FIR) for v in fir]
+
+    # Acumulador int32 del FIR: sum|h| * 2^15 * 2^12 debe caber en 31 bits
+    assert sum(abs(v) for v in fir_q) * 4096 < (1 << 31), "FIR Q15 desborda int32"
+    for s in sos:
+        assert all(abs(c) < 4.0 for c in s), "Coeficiente fuera de rango Q2.29"
+
+    lineas = [
+        "#pragma once",
+        "",
+        "// ARCHIVO GENERADO por scripts/gen_filter_coeffs.py - no editar a mano.",
+        "// Diseños equivalentes a Filtros.ipynb para FS_HZ = %d." % fs,
+        "",
+        "#include <stdint.h>",
+        "",
+        "#define FILTRO_COEF_FS_HZ %d" % fs,
+        "",
+        "// Pasabanda Butterworth orden %d, %g-%g Hz: SOS [b0, b1, b2, a0, a1, a2]"
+        % (BP_ORDEN, BP_F_BAJA, BP_F_ALTA),
+        "#define BP_NUM_SECCIONES %d" % len(sos),
+        "static const float BP_SOS[BP_NUM_SECCIONES][6] = {",
+    ]
+    for s in sos:
+        lineas.append("    {" + ", ".join("%.9ef" % c for c in s) + "},")
+    lineas += [
+        "};",
+        "",
+        "// Mismo pasabanda en Q2.%d: [b0, b1, b2, a1, a2]" % Q_BIQUAD,
+        "#define BP_SOS_Q %d" % Q_BIQUAD,
+        "static const int32_t BP_SOS_Q29[BP_NUM_SECCIONES][5] = {",
+    ]
+    for s in sos:
+        q = [a_punto_fijo(c, Q_BIQUAD) for c in (s[0], s[1], s[2], s[4], s[5])]
+        lineas.append("    {" + ", ".join("%d" % c for c in q) + "},")
+    lineas += [
+        "};",
+        "",
+        "// FIR paso bajo %d taps, corte %g Hz (Hamming)" % (FIR_TAPS, FIR_CORTE_HZ),
+        "#define FIR_NUM_TAPS %d" % FIR_TAPS,
+        "static const float FIR_TAPS_F32[FIR_NUM_TAPS] = {",
+    ]
+    for i in range(0, FIR_TAPS, 4):
+        lineas.append("    " + ", ".join("%.9ef" % v for v in fir[i:i + 4]) + ",")
+    lineas += [
+        "};",
+        "",
+        "#define FIR_Q %d" % Q_FIR,
+        "static const int16_t FIR_TAPS_Q15[FIR_NUM_TAPS] = {",
+    ]
+    for i in range(0, FIR_TAPS, 8):
+        lineas.append("    " + ", ".join("%d" % v for v in fir_q[i:i + 8]) + ",")
+    lineas += ["};", ""]
+    return "\n".join(lineas)
+
+
+def escribir(directorio, fs):
+    ruta = os.path.join(directorio, SALIDA)
+    contenido = generar(fs)
+    if os.path.exists(ruta):
+        with open(ruta) as f:
+            if f.read() == contenido:
+                return
+    with open(ruta, "w") as f:
+        f.write(contenido)
+    print("[gen_filter_coeffs] %s generado para FS_HZ=%d" % (SALIDA, fs))
+
+
+def fs_desde_build_flags(env):
+    for d in env.ParseFlags(env.get("BUILD_FLAGS", [])).get("CPPDEFINES", []):
+        if isinstance(d, (list, tuple)) and d[0] == "FS_HZ":
+            return int(d[1])
+    return 960
+
+
+try:
+    Import("env")  # noqa: F821 (definido por SCons/PlatformIO)
+    escribir(env.subst("$PROJECT_DIR"), fs_desde_build_flags(env))  # noqa: F821
+except NameError:
+    if __name__ == "__main__":
+        fs = 960
+        if "--fs" in sys.argv:
+            fs = int(sys.argv[sys.argv.index("--fs") + 1])
+        escribir(os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."), fs)
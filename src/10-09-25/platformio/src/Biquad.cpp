@@ -0,0 +1,178 @@
+#include "Biquad.h"
+
+#include <math.h>
+
+// ===================== FLOAT (DF-II transpuesta) =====================
+
+void biquad_reset(Biquad* s)
+{
+    s->z1 = 0.0f;
+    s->z2 = 0.0f;
+}
+
+static void biquad_set_normalized(Biquad* s, float b0, float b1, float b2,
+                                  float a0, float a1, float a2)
+{
+    s->b0 = b0 / a0;
+    s->b1 = b1 / a0;
+    s->b2 = b2 / a0;
+    s->a1 = a1 / a0;
+    s->a2 = a2 / a0;
+    biquad_reset(s);
+}
+
+void biquad_set_lowpass(Biquad* s, float fs_hz, float f0_hz, float Q)
+{
+    float w0 = 2.0f * (float)M_PI * f0_hz / fs_hz;
+    float cw = cosf(w0);
+    float alpha = sinf(w0) / (2.0f * Q);
+    biquad_set_normalized(s, (1.0f - cw) * 0.5f, 1.0f - cw, (1.0f - cw) * 0.5f,
+                          1.0f + alpha, -2.0f * cw, 1.0f - alpha);
+}
+
+void biquad_set_highpass(Biquad* s, float fs_hz, float f0_hz, float Q)
+{
+    float w0 = 2.0f * (float)M_PI * f0_hz / fs_hz;
+    float cw = cosf(w0);
+    float alpha = sinf(w0) / (2.0f * Q);
+    biquad_set_normalized(s, (1.0f + cw) * 0.5f, -(1.0f + cw), (1.0f + cw) * 0.5f,
+                          1.0f + alpha, -2.0f * cw, 1.0f - alpha);
+}
+
+void biquad_set_sos(Biquad* s, const float sos[6])
+{
+    biquad_set_normalized(s, sos[0], sos[1], sos[2], sos[3], sos[4], sos[5]);
+}
+
+float biquad_process(Biquad* s, float x)
+{
+    float y = s->b0 * x + s->z1;
+    s->z1 = s->b1 * x - s->a1 * y + s->z2;
+    s->z2 = s->b2 * x - s->a2 * y;
+    return y;
+}
+
+void biquad_process_block(Biquad* s, const float* in, float* out, int n)
+{
+    // Coeficientes y estados en registros durante todo el bloque
+    const float b0 = s->b0, b1 = s->b1, b2 = s->b2;
+    const float a1 = s->a1, a2 = s->a2;
+    float z1 = s->z1, z2 = s->z2;
+
+    for (int i = 0; i < n; i++)
+    {
+        float x = in[i];
+        float y = b0 * x + z1;
+        z1 = b1 * x - a1 * y + z2;
+        z2 = b2 * x - a2 * y;
+        out[i] = y;
+    }
+
+    s->z1 = z1;
+    s->z2 = z2;
+}
+
+void biquad_cascade_init(BiquadCascade* c, const float (*sos)[6], int num_secciones)
+{
+    if (num_secciones > BIQUAD_MAX_SECCIONES)
+        num_secciones = BIQUAD_MAX_SECCIONES;
+    c->num_etapas = num_secciones;
+    for (int i = 0; i < num_secciones; i++)
+        biquad_set_sos(&c->etapas[i], sos[i]);
+}
+
+void biquad_cascade_reset(BiquadCascade* c)
+{
+    for (int i = 0; i < c->num_etapas; i++)
+        biquad_reset(&c->etapas[i]);
+}
+
+void biquad_cascade_process_block(BiquadCascade* c, const float* in, float* out, int n)
+{
+    // Cada etapa recorre el bloque completo: mejor localidad que muestra a muestra
+    const float* src = in;
+    for (int i = 0; i < c->num_etapas; i++)
+    {
+        biquad_process_block(&c->etapas[i], src, out, n);
+        src = out;
+    }
+    if (c->num_etapas == 0 && out != in)
+    {
+        for (int i = 0; i < n; i++)
+            out[i] = in[i];
+    }
+}
+
+// ===================== PUNTO FIJO Q2.29 (DF-I) =====================
+
+void biquad_q29_set(BiquadQ29* s, const int32_t coef[5])
+{
+    s->b0 = coef[0];
+    s->b1 = coef[1];
+    s->b2 = coef[2];
+    s->a1 = coef[3];
+    s->a2 = coef[4];
+    biquad_q29_reset(s);
+}
+
+void biquad_q29_reset(BiquadQ29* s)
+{
+    s->x1 = s->x2 = 0;
+    s->y1 = s->y2 = 0;
+}
+
+void biquad_q29_process_block(BiquadQ29* s, const int32_t* in, int32_t* out, int n)
+{
+    const int64_t b0 = s->b0, b1 = s->b1, b2 = s->b2;
+    const int64_t a1 = s->a1, a2 = s->a2;
+    int32_t x1 = s->x1, x2 = s->x2;
+    int32_t y1 = s->y1, y2 = s->y2;
+    const int64_t redondeo = (int64_t)1 << 28;
+
+    for (int i = 0; i < n; i++)
+    {
+        int32_t x = in[i];
+        int64_t acc = b0 * x + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2;
+        int32_t y = (int32_t)((acc + redondeo) >> 29);
+        x2 = x1;
+        x1 = x;
+        y2 = y1;
+        y1 = y;
+        out[i] = y;
+    }
+
+    s->x1 = x1;
+    s->x2 = x2;
+    s->y1 = y1;
+    s->y2 = y2;
+}
+
+void biquad_cascade_q29_init(BiquadCascadeQ29* c, const int32_t (*coef)[5], int num_secciones)
+{
+    if (num_secciones > BIQUAD_MAX_SECCIONES)
+        num_secciones = BIQUAD_MAX_SECCIONES;
+    c->num_etapas = num_secciones;
+    for (int i = 0; i < num_secciones; i++)
+        biquad_q29_set(&c->etapas[i], coef[i]);
+}
+
+void biquad_cascade_q29_reset(BiquadCascadeQ29* c)
+{
+    for (int i = 0; i < c->num_etapas; i++)
+        biquad_q29_reset(&c->etapas[i]);
+}
+
+void biquad_cascade_q29_process_block(BiquadCascadeQ29* c, const int32_t* in, int32_t* out, int n)
+{
+    const int32_t* src = in;
+    for (int i = 0; i < c->num_etapas; i++)
+    {
+        biquad_q29_process_block(&c->etapas[i], src, out, n);
+        src = out;
+    }
+    if (c->num_etapas == 0 && out != in)
+    {
+        for (int i = 0; i < n; i++)
+            out[i] = in[i];
+    }
+}
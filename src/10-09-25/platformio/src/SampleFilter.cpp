@@ -0,0 +1,93 @@
+#include "SampleFilter.h"
+#include "FilterCoeffs.h"
+
+static_assert(FIR_NUM_TAPS == SAMPLEFILTER_TAP_NUM,
+              "FilterCoeffs.h no coincide con SAMPLEFILTER_TAP_NUM");
+
+// ===================== FLOAT =====================
+
+void SampleFilter_init(SampleFilter* f)
+{
+    for (int i = 0; i < SAMPLEFILTER_TAP_NUM; ++i)
+        f->history[i] = 0.0f;
+    f->last_index = 0;
+}
+
+void SampleFilter_put(SampleFilter* f, float input)
+{
+    f->history[f->last_index++] = input;
+    if (f->last_index == SAMPLEFILTER_TAP_NUM)
+        f->last_index = 0;
+}
+
+// Producto punto sobre el historial circular en dos tramos contiguos
+// (sin módulo ni ramas por tap). 'newest' es el índice de la última muestra.
+static inline float fir_dot(const float* hist, int newest)
+{
+    float acc = 0.0f;
+    const float* h = FIR_TAPS_F32;
+    for (int j = newest; j >= 0; --j)
+        acc += hist[j] * *h++;
+    for (int j = SAMPLEFILTER_TAP_NUM - 1; j > newest; --j)
+        acc += hist[j] * *h++;
+    return acc;
+}
+
+float SampleFilter_get(SampleFilter* f)
+{
+    int newest = (f->last_index == 0) ? SAMPLEFILTER_TAP_NUM - 1 : (int)f->last_index - 1;
+    return fir_dot(f->history, newest);
+}
+
+void SampleFilter_process_block(SampleFilter* f, const float* in, float* out, int n)
+{
+    unsigned int idx = f->last_index;
+    for (int i = 0; i < n; i++)
+    {
+        f->history[idx] = in[i];
+        out[i] = fir_dot(f->history, (int)idx);
+        if (++idx == SAMPLEFILTER_TAP_NUM)
+            idx = 0;
+    }
+    f->last_index = idx;
+}
+
+// ===================== PUNTO FIJO Q15 =====================
+
+void SampleFilterQ15_init(SampleFilterQ15* f)
+{
+    for (int i = 0; i < SAMPLEFILTER_TAP_NUM; ++i)
+        f->history[i] = 0;
+    f->last_index = 0;
+}
+
+// El generador garantiza sum|h| * 2^15 * 2^12 < 2^31, así que el acumulador
+// de 32 bits no desborda con muestras de 12 bits centradas.
+static inline int32_t fir_dot_q15(const int16_t* hist, int newest)
+{
+    int32_t acc = 0;
+    const int16_t* h = FIR_TAPS_Q15;
+    for (int j = newest; j >= 0; --j)
+        acc += (int32_t)hist[j] * *h++;
+    for (int j = SAMPLEFILTER_TAP_NUM - 1; j > newest; --j)
+        acc += (int32_t)hist[j] * *h++;
+    return acc;
+}
+
+void SampleFilterQ15_process_block(SampleFilterQ15* f, const int16_t* in, int16_t* out, int n)
+{
+    unsigned int idx = f->last_index;
+    for (int i = 0; i < n; i++)
+    {
+        f->history[idx] = in[i];
+        int32_t y = (fir_dot_q15(f->history, (int)idx) + (1 << (FIR_Q - 1))) >> FIR_Q;
+        if (y > INT16_MAX)
+            y = INT16_MAX;
+        else if (y < INT16_MIN)
+            y = INT16_MIN;
+        out[i] = (int16_t)y;
+        if (++idx == SAMPLEFILTER_TAP_NUM)
+            idx = 0;
+    }
+    f->last_index = idx;
+}
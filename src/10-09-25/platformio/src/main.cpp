@@ -24,9 +24,14 @@
  * The system uses FreeRTOS to manage concurrent tasks for data acquisition,
  *processing, and communication.
  * - An ISR (`onADCTimer`) samples ADC pins at a high frequency (`FS_HZ`) and
- *stores data in a circular FIFO buffer.
- * - `TaskProcesamiento`: Periodically calculates RMS values from the FIFO,
- *applies an adaptive EMA filter, and sends the results to a processing queue.
+ *fills fixed-size ping-pong sample blocks.
+ * - With `ADC_USE_DMA=1`, ADC1 pins are sampled by the ADC digital controller
+ *in continuous (DMA) mode; `TaskAdquisicionDMA` decimates the frames into the
+ *same blocks. ADC2 pins remain on the timer ISR.
+ * - `TaskProcesamiento`: Woken by a notification for every completed block;
+ *calculates RMS over exact, non-overlapping windows of `BLOQUES_POR_VENTANA`
+ *blocks, applies an adaptive EMA filter, and sends the results (stamped with
+ *the window's first-sample time) to a processing queue.
  * - `TaskRegistroResultados`: Collects processed results into blocks. Once a
  *block is full or the system is disabled, it encodes the data into a bit-packed
  *LoRaWAN payload.
@@ -112,6 +117,11 @@ const unsigned char epd_bitmap_[] PROGMEM = {
 #include <math.h>
 #include <stdint.h>
 #include <vector>
+
+// Cadena DSP (coeficientes generados por scripts/gen_filter_coeffs.py)
+#include "Biquad.h"
+#include "FilterCoeffs.h"
+#include "SampleFilter.h"
 // Deshabilitar ventana RX de recepción
 #define DISABLE_INVERT_IQ_ON_RX 1
 #define DISABLE_RX 1
@@ -143,12 +153,34 @@ volatile bool sistema_habilitado = false;
 #ifndef PROCESS_PERIOD_MS
 #define PROCESS_PERIOD_MS 300
 #endif
+// Backend de adquisición: 0 = ISR por timer (por defecto), 1 = ADC continuo (DMA)
+#ifndef ADC_USE_DMA
+#define ADC_USE_DMA 0
+#endif
+#if ADC_USE_DMA
+#include <driver/adc.h>
+#endif
+// Prefiltro por canal entre adquisición y RMS:
+// 0 = sin filtro, 1 = pasabanda Butterworth 55-65 Hz, 2 = FIR paso bajo 67 taps
+#ifndef FILTRO_VOLTAJE
+#define FILTRO_VOLTAJE 0
+#endif
+#ifndef FILTRO_CORRIENTE
+#define FILTRO_CORRIENTE 0
+#endif
+// 1 = kernels en punto fijo (Q2.29 / Q15) en lugar de float
+#ifndef FILTRO_PUNTO_FIJO
+#define FILTRO_PUNTO_FIJO 0
+#endif
 
 // Constantes internas optimizadas (usando los valores definidos arriba)
 constexpr int SYSTEM_FS_HZ = FS_HZ;
 constexpr float SYSTEM_EMA_ALPHA = EMA_ALPHA;
 constexpr int SYSTEM_PROCESS_PERIOD_MS = PROCESS_PERIOD_MS;
 
+static_assert(FILTRO_COEF_FS_HZ == FS_HZ,
+              "FilterCoeffs.h generado para otro FS_HZ: ejecutar scripts/gen_filter_coeffs.py");
+
 constexpr int NUM_PINES = 4;
 constexpr int RESULTADOS_POR_BLOQUE = 20;
 
@@ -199,8 +231,16 @@ typedef struct
     bool enabled;
     float last_rms;
     bool ema_initialized;
+    uint8_t filtro; // TipoFiltro aplicado antes del RMS
 } PinConfig;
 
+enum TipoFiltro : uint8_t
+{
+    FILTRO_NINGUNO = 0,
+    FILTRO_PASABANDA = 1,
+    FILTRO_FIR = 2
+};
+
 typedef struct
 {
     unsigned long timestamp;
@@ -211,26 +251,54 @@ typedef struct
 {
     ResultadoRMS bloque[RESULTADOS_POR_BLOQUE];
     volatile int index;
-    SemaphoreHandle_t mutex;
 } BufferResultados;
 
-// FIFO y sumas para cada pin (OPTIMIZADO)
-#define FIFO_SIZE 320
-struct RMS_FIFO
+// Bloques de muestras ping-pong: la ISR/DMA llena uno mientras
+// TaskProcesamiento consume el otro. Una ventana de RMS son exactamente
+// BLOQUES_POR_VENTANA bloques consecutivos.
+#ifndef BLOQUES_POR_VENTANA
+#define BLOQUES_POR_VENTANA 4
+#endif
+constexpr int MUESTRAS_POR_VENTANA = SYSTEM_FS_HZ * SYSTEM_PROCESS_PERIOD_MS / 1000;
+constexpr int MUESTRAS_POR_BLOQUE = MUESTRAS_POR_VENTANA / BLOQUES_POR_VENTANA;
+static_assert(MUESTRAS_POR_BLOQUE > 0, "FS_HZ * PROCESS_PERIOD_MS demasiado pequeño para BLOQUES_POR_VENTANA");
+static_assert(MUESTRAS_POR_BLOQUE <= UINT16_MAX, "Bloque demasiado grande");
+
+struct BloqueMuestras
 {
-    uint16_t buffer[FIFO_SIZE];
-    int head;
-    int count;
-    uint32_t sum_x;    // Cambio de double a uint32_t
-    uint64_t sum_x2;   // Cambio de double a uint64_t para evitar overflow
+    uint16_t muestras[NUM_PINES][MUESTRAS_POR_BLOQUE];
+    uint16_t count[NUM_PINES];
+    uint32_t total;         // Muestras escritas entre todos los pines
+    uint32_t seq;           // Número de secuencia del bloque
+    unsigned long t0_ms;    // Timestamp de la primera muestra del bloque
 };
-RMS_FIFO fifo_pins[NUM_PINES];
+BloqueMuestras bloques[2];
+volatile uint8_t bloque_escritura = 0;        // Bloque que llena la ISR/DMA
+volatile bool bloque_listo[2] = {false, false}; // Bloque entregado y sin procesar
+volatile uint32_t bloque_seq = 0;
+volatile uint32_t bloques_descartados = 0;    // Overruns del procesamiento
+TaskHandle_t taskProcesamientoHandle = NULL;
 
 PinConfig pin_configs[NUM_PINES] = {
-    {36, 1033.0f, ESP32AnalogRead(), 0.0f, true, 0.0f, false},
-    {39, 1017.0f, ESP32AnalogRead(), 0.0f, true, 0.0f, false},
-    {34, 1025.0f, ESP32AnalogRead(), 0.0f, true, 0.0f, false},
-    {25, 99.0f, ESP32AnalogRead(), 0.0f, true, 0.0f, false}};
+    {36, 1033.0f, ESP32AnalogRead(), 0.0f, true, 0.0f, false, FILTRO_VOLTAJE},
+    {39, 1017.0f, ESP32AnalogRead(), 0.0f, true, 0.0f, false, FILTRO_VOLTAJE},
+    {34, 1025.0f, ESP32AnalogRead(), 0.0f, true, 0.0f, false, FILTRO_VOLTAJE},
+    {25, 99.0f, ESP32AnalogRead(), 0.0f, true, 0.0f, false, FILTRO_CORRIENTE}};
+
+// Estado de los filtros por pin (persistente entre bloques)
+struct EstadoFiltro
+{
+#if FILTRO_PUNTO_FIJO
+    BiquadCascadeQ29 pasabanda;
+    SampleFilterQ15 fir;
+#else
+    BiquadCascade pasabanda;
+    SampleFilter fir;
+#endif
+};
+EstadoFiltro filtros_pin[NUM_PINES];
+
+constexpr int ADC_OFFSET_CUENTAS = 2048; // Centro del ADC de 12 bits
 
 BufferResultados bufferResultados;
 QueueHandle_t queueResultados;
@@ -370,6 +438,65 @@ struct BitPacker
     }
 };
 
+// ==================== BYTE LEN ====================
+// bits 0-4: muestras del bloque
+// bit 5:    LEN_FLAG_AUTO_WIDTH, bloque empaquetado con cabecera de ancho (ver abajo)
+// bit 6:    LEN_FLAG_EXTENDED, cada muestra usa 2 bytes
+// bit 7:    LEN_FLAG_PACKED, datos empaquetados en bits
+#define LEN_FLAG_AUTO_WIDTH 0x20
+#define LEN_FLAG_EXTENDED 0x40
+#define LEN_FLAG_PACKED 0x80
+
+// ==================== ANCHO DE BITS AUTOMÁTICO ====================
+// Bloque empaquetado (LEN_FLAG_PACKED | LEN_FLAG_AUTO_WIDTH) con el ancho mínimo que
+// cubre sus valores:
+//   [cabecera][base 2B si PACK_FLAG_BASE][valores - base a 'ancho' bits, MSB primero]
+//   cabecera bits 0-4: ancho (0-16; 0 = todos los valores iguales a la base)
+// Se resta el mínimo del bloque solo si los 2 bytes de base se pagan con los bits ahorrados.
+#define PACK_FLAG_BASE 0x80
+
+static inline int bitsNecesarios(uint16_t v)
+{
+    int n = 0;
+    while (n < 16 && (v >> n) != 0)
+        n++;
+    return n;
+}
+
+void empaquetarAnchoAuto(const uint16_t *valores, size_t n, std::vector<uint8_t> &out)
+{
+    uint16_t vmin = 0xFFFF, vmax = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        vmin = min(vmin, valores[i]);
+        vmax = max(vmax, valores[i]);
+    }
+    if (n == 0)
+        vmin = 0;
+
+    int ancho_abs = bitsNecesarios(vmax);
+    int ancho_rel = bitsNecesarios(vmax - vmin);
+    size_t bytes_abs = 1 + (n * ancho_abs + 7) / 8;
+    size_t bytes_rel = 3 + (n * ancho_rel + 7) / 8;
+    bool con_base = bytes_rel < bytes_abs;
+    int ancho = con_base ? ancho_rel : ancho_abs;
+    uint16_t base = con_base ? vmin : 0;
+
+    out.push_back((uint8_t)((con_base ? PACK_FLAG_BASE : 0) | ancho));
+    if (con_base)
+    {
+        out.push_back(base >> 8);
+        out.push_back(base & 0xFF);
+    }
+    if (ancho > 0)
+    {
+        BitPacker packer;
+        for (size_t i = 0; i < n; ++i)
+            packer.push(valores[i] - base, ancho, out);
+        packer.flush(out);
+    }
+}
+
 // ===================== DISPLAY DATA (VERSIÓN OPTIMIZADA) =====================
 void updateDisplay(String systemStatus, float batteryVolt, unsigned long timestamp,
                    int volt1 = 0, float curr1 = 0)
@@ -424,6 +551,8 @@ void updateDisplay(String systemStatus, float batteryVolt, unsigned long timesta
 }
 
 // ===================== CODIFICACIÓN UNIFICADA =====================
+// Cabecera clásica [ID][TS 4B]: sin hora de red, la cabecera v2 del maestro 30-01-25
+// (base/delta de hora UNIX) no aporta nada en este nodo.
 void codificarUnificado(
     const BufferResultados &buffer, uint8_t id_mensaje,
     bool nueva_bateria, // Solo se envía si hay nuevo valor
@@ -487,7 +616,7 @@ void codificarUnificado(
     // --- Corriente ---
     if (activate_byte & 0x04)
     {                                                    // Bit 2: corriente
-        uint8_t len_byte = 0x80 | (data_len_rms & 0x1F); // Packed, no extended
+        uint8_t len_byte = LEN_FLAG_PACKED | LEN_FLAG_AUTO_WIDTH | (data_len_rms & 0x1F); // Ancho automático
         payload.push_back(len_byte);
     }
 
@@ -498,17 +627,15 @@ void codificarUnificado(
         {
             uint8_t len_byte = 0;
             if (datos_externos[i].packed)
-                len_byte |= 0x80;
+                len_byte |= LEN_FLAG_PACKED;
             if (datos_externos[i].extended)
-                len_byte |= 0x40;
+                len_byte |= LEN_FLAG_EXTENDED;
             len_byte |= (datos_externos[i].len & 0x1F);
             payload.push_back(len_byte);
         }
     }
 
     // ================== 3. BLOQUES DE DATOS ==================
-    BitPacker packer;
-
     // --- Batería ---
     if (activate_byte & 0x01)
     {
@@ -540,7 +667,8 @@ void codificarUnificado(
         // ASUNCIÓN: pin_configs[3] es la única corriente. Rellenamos 2 canales con
         // ceros.
         int idx_corriente = 3;
-        // Canal 1 (real)
+        // Canal 1 (real), en décimas de amperio
+        uint16_t valores_corriente[RESULTADOS_POR_BLOQUE];
         for (int k = 0; k < data_len_rms; ++k)
         {
             uint16_t valor = 0;
@@ -550,15 +678,15 @@ void codificarUnificado(
                 valor =
                     (uint16_t)round(buffer.bloque[k].valores[idx_corriente] * 10.0f);
             }
-            packer.push(valor, 10, payload);
+            valores_corriente[k] = valor;
         }
+        empaquetarAnchoAuto(valores_corriente, data_len_rms, payload);
         // Canales 2 y 3 (relleno con ceros)
         // for (int ch = 0; ch < 2; ++ch) {
         //    for (int k = 0; k < data_len_rms; ++k) {
         //        packer.push(0, 10, payload);
         //    }
         //}
-        packer.flush(payload);
     }
     // --- Datos de Sensores Externos ---
     for (int i = 0; i < MAX_SENSORES_EXTERNOS; ++i)
@@ -587,25 +715,41 @@ volatile int num_pines_activos = 0;
 volatile int active_pins[NUM_PINES];
 volatile int num_active_pins = 0;
 
-// Cálculo RMS usando sumas acumuladas FIFO (OPTIMIZADO)
-float calculateRMS_fifo(const RMS_FIFO &fifo, float gain = 1.0f)
-{
-    int cnt;
-    uint32_t sx;
-    uint64_t sx2;
+// Pines muestreados por el timer ISR. Con ADC_USE_DMA solo quedan aquí los
+// pines que no pertenecen al ADC1 (el controlador digital del ESP32 solo
+// admite ADC1 en modo continuo).
+volatile int isr_pins[NUM_PINES];
+volatile int num_isr_pins = 0;
+
+#if ADC_USE_DMA
+// ===================== ADC CONTINUO (DMA) =====================
+constexpr uint32_t DMA_FRAME_BYTES = 256;          // Bytes por trama entregada por el driver
+constexpr uint32_t DMA_FS_MIN_HZ = 20000;          // Límite inferior del controlador digital (ESP32)
+constexpr int ADC1_NUM_CANALES = 8;
+
+int dma_pins[NUM_PINES];
+int num_dma_pins = 0;
+bool dma_disponible = true;                         // false si el ADC continuo no arrancó
+int dma_decimacion = 1;                             // Muestras promediadas por muestra útil
+int8_t dma_canal_a_pin[ADC1_NUM_CANALES];           // Canal ADC1 -> índice en pin_configs
+volatile uint32_t dma_tramas_perdidas = 0;
+#endif
 
-    portENTER_CRITICAL(&timerMux);
-    cnt = fifo.count;
-    sx = fifo.sum_x;
-    sx2 = fifo.sum_x2;
-    portEXIT_CRITICAL(&timerMux);
+// Devuelve el canal ADC1 del pin o -1 si el pin pertenece al ADC2
+int canalADC1(int pin)
+{
+    int ch = digitalPinToAnalogChannel(pin);
+    return (ch >= 0 && ch < 8) ? ch : -1;
+}
 
-    if (cnt <= 0)
+// Cálculo RMS a partir de las sumas acumuladas de una ventana
+float calculateRMS_sumas(uint32_t cnt, double sx, double sx2, float gain = 1.0f)
+{
+    if (cnt == 0)
         return NAN;
         
-    // Conversión a double solo cuando es necesario para el cálculo final
-    double mean = (double)sx / cnt;
-    double var = ((double)sx2 / cnt) - (mean * mean);
+    double mean = sx / cnt;
+    double var = (sx2 / cnt) - (mean * mean);
     
     if (var < 0)
         var = 0; // clamp por errores numéricos
@@ -614,10 +758,86 @@ float calculateRMS_fifo(const RMS_FIFO &fifo, float gain = 1.0f)
     return (float)(rms * gain);
 }
 
+void reiniciarFiltros()
+{
+    for (int i = 0; i < NUM_PINES; i++)
+    {
+#if FILTRO_PUNTO_FIJO
+        biquad_cascade_q29_init(&filtros_pin[i].pasabanda, BP_SOS_Q29, BP_NUM_SECCIONES);
+        SampleFilterQ15_init(&filtros_pin[i].fir);
+#else
+        biquad_cascade_init(&filtros_pin[i].pasabanda, BP_SOS, BP_NUM_SECCIONES);
+        SampleFilter_init(&filtros_pin[i].fir);
+#endif
+    }
+}
+
+// Filtra un bloque de muestras crudas del pin y acumula las sumas de la
+// salida (en cuentas de ADC, centradas) para el cálculo RMS.
+void filtrarBloque(int pin_idx, const uint16_t *muestras, int n, double &sx, double &sx2)
+{
+    EstadoFiltro &ef = filtros_pin[pin_idx];
+#if FILTRO_PUNTO_FIJO
+    // Pasabanda en Q4 (muestra << 4) para conservar resolución tras cada etapa
+    static int32_t buf32[MUESTRAS_POR_BLOQUE];
+    static int16_t buf16[MUESTRAS_POR_BLOQUE];
+    int64_t acc_x = 0, acc_x2 = 0;
+
+    if (pin_configs[pin_idx].filtro == FILTRO_PASABANDA)
+    {
+        for (int k = 0; k < n; k++)
+            buf32[k] = ((int32_t)muestras[k] - ADC_OFFSET_CUENTAS) << 4;
+        biquad_cascade_q29_process_block(&ef.pasabanda, buf32, buf32, n);
+        for (int k = 0; k < n; k++)
+        {
+            acc_x += buf32[k];
+            acc_x2 += (int64_t)buf32[k] * buf32[k];
+        }
+        sx += acc_x / 16.0;
+        sx2 += acc_x2 / 256.0;
+    }
+    else
+    {
+        for (int k = 0; k < n; k++)
+            buf16[k] = (int16_t)((int32_t)muestras[k] - ADC_OFFSET_CUENTAS);
+        SampleFilterQ15_process_block(&ef.fir, buf16, buf16, n);
+        for (int k = 0; k < n; k++)
+        {
+            acc_x += buf16[k];
+            acc_x2 += (int32_t)buf16[k] * buf16[k];
+        }
+        sx += (double)acc_x;
+        sx2 += (double)acc_x2;
+    }
+#else
+    static float buf[MUESTRAS_POR_BLOQUE];
+    for (int k = 0; k < n; k++)
+        buf[k] = (float)((int32_t)muestras[k] - ADC_OFFSET_CUENTAS);
+
+    if (pin_configs[pin_idx].filtro == FILTRO_PASABANDA)
+        biquad_cascade_process_block(&ef.pasabanda, buf, buf, n);
+    else
+        SampleFilter_process_block(&ef.fir, buf, buf, n);
+
+    float acc_x = 0.0f, acc_x2 = 0.0f;
+    for (int k = 0; k < n; k++)
+    {
+        acc_x += buf[k];
+        acc_x2 += buf[k] * buf[k];
+    }
+    sx += acc_x;
+    sx2 += acc_x2;
+#endif
+}
+
 void actualizarNumPinesActivos()
 {
     num_pines_activos = 0;
     num_active_pins = 0;
+    num_isr_pins = 0;
+#if ADC_USE_DMA
+    num_dma_pins = 0;
+#endif
     
     // Crear array optimizado de solo los pines activos
     for (int i = 0; i < NUM_PINES; i++)
@@ -626,78 +846,312 @@ void actualizarNumPinesActivos()
         {
             active_pins[num_active_pins++] = i;
             num_pines_activos++;
+#if ADC_USE_DMA
+            if (dma_disponible && canalADC1(pin_configs[i].pin) >= 0)
+            {
+                dma_pins[num_dma_pins++] = i;
+                continue;
+            }
+#endif
+            isr_pins[num_isr_pins++] = i;
         }
     }
     
     // Reiniciar el índice si es necesario
-    if (isr_pin_index >= num_active_pins)
+    if (isr_pin_index >= num_isr_pins)
         isr_pin_index = 0;
 }
 
+static inline void IRAM_ATTR reiniciarBloque(BloqueMuestras &b)
+{
+    memset(b.count, 0, sizeof(b.count));
+    b.total = 0;
+}
+
+// Inserta una muestra en el bloque activo. El llamador debe tener tomado
+// timerMux. Devuelve true cuando el bloque se completó y quedó entregado a
+// TaskProcesamiento (el llamador debe notificar fuera de la sección crítica).
+static inline bool IRAM_ATTR agregarMuestraBloque(int pin_idx, uint16_t val)
+{
+    BloqueMuestras &b = bloques[bloque_escritura];
+
+    // Un pin adelantado respecto a los demás descarta hasta el siguiente bloque
+    if (b.count[pin_idx] >= MUESTRAS_POR_BLOQUE)
+        return false;
+
+    if (b.total == 0)
+        b.t0_ms = millis();
+
+    b.muestras[pin_idx][b.count[pin_idx]++] = val;
+    if (++b.total < (uint32_t)num_pines_activos * MUESTRAS_POR_BLOQUE)
+        return false;
+
+    b.seq = bloque_seq++;
+    uint8_t siguiente = bloque_escritura ^ 1;
+    if (bloque_listo[siguiente])
+    {
+        // El procesamiento no liberó el otro bloque: se reutiliza el actual
+        bloques_descartados++;
+        reiniciarBloque(b);
+        return false;
+    }
+
+    bloque_listo[bloque_escritura] = true;
+    bloque_escritura = siguiente;
+    reiniciarBloque(bloques[siguiente]);
+    return true;
+}
+
 void IRAM_ATTR onADCTimer()
 {
     // Verificación rápida sin sección crítica
-    if (!sistema_habilitado || num_active_pins == 0)
+    if (!sistema_habilitado || num_isr_pins == 0)
         return;
     
     // Obtener el índice del pin actual de forma optimizada
-    int current_pin_idx = active_pins[isr_pin_index];
+    int current_pin_idx = isr_pins[isr_pin_index];
     
     // Lectura ADC fuera de sección crítica (más rápido)
     uint16_t val = pin_configs[current_pin_idx].reader.readRaw();
     
-    // Sección crítica mínima solo para actualizar el FIFO
+    // Sección crítica mínima solo para actualizar el bloque
     portENTER_CRITICAL_ISR(&timerMux);
     
-    RMS_FIFO &fifo = fifo_pins[current_pin_idx];
-    int h = fifo.head;
+    bool bloque_completo = agregarMuestraBloque(current_pin_idx, val);
     
-    // Optimización: usar enteros en lugar de double para sum_x2
-    if (fifo.count == FIFO_SIZE)
+    // Avanzar al siguiente pin activo (sin búsqueda)
+    isr_pin_index = (isr_pin_index + 1) % num_isr_pins;
+    
+    portEXIT_CRITICAL_ISR(&timerMux);
+
+    if (bloque_completo && taskProcesamientoHandle != NULL)
     {
-        uint16_t old = fifo.buffer[h];
-        fifo.sum_x -= old;
-        fifo.sum_x2 -= (uint32_t)old * old; // Cambio a uint32_t
+        BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+        vTaskNotifyGiveFromISR(taskProcesamientoHandle, &xHigherPriorityTaskWoken);
+        if (xHigherPriorityTaskWoken)
+            portYIELD_FROM_ISR();
     }
-    else
+}
+
+#if ADC_USE_DMA
+// Configura el controlador digital del ADC1 para barrer los pines DMA a
+// SYSTEM_FS_HZ por pin. El ESP32 no baja de DMA_FS_MIN_HZ, así que se
+// sobremuestrea y se promedia (decima) en TaskAdquisicionDMA.
+bool iniciarADC_DMA()
+{
+    if (num_dma_pins == 0)
+        return false;
+
+    adc_digi_pattern_config_t patron[SOC_ADC_PATT_LEN_MAX] = {};
+    uint16_t mascara_adc1 = 0;
+
+    for (int c = 0; c < ADC1_NUM_CANALES; c++)
+        dma_canal_a_pin[c] = -1;
+
+    for (int i = 0; i < num_dma_pins; i++)
     {
-        fifo.count++;
+        int idx = dma_pins[i];
+        int ch = canalADC1(pin_configs[idx].pin);
+        dma_canal_a_pin[ch] = idx;
+        mascara_adc1 |= BIT(ch);
+
+        patron[i].atten = ADC_ATTEN_DB_11; // Igual que ESP32AnalogRead
+        patron[i].channel = ch;
+        patron[i].unit = 0; // ADC1
+        patron[i].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
     }
-    
-    fifo.buffer[h] = val;
-    fifo.sum_x += val;
-    fifo.sum_x2 += (uint32_t)val * val; // Cambio a uint32_t
-    fifo.head = (h + 1) % FIFO_SIZE;
-    
-    // Avanzar al siguiente pin activo (sin búsqueda)
-    isr_pin_index = (isr_pin_index + 1) % num_active_pins;
-    
-    portEXIT_CRITICAL_ISR(&timerMux);
+
+    uint32_t fs_total = (uint32_t)SYSTEM_FS_HZ * num_dma_pins;
+    dma_decimacion = (DMA_FS_MIN_HZ + fs_total - 1) / fs_total;
+    if (dma_decimacion < 1)
+        dma_decimacion = 1;
+
+    adc_digi_init_config_t init_cfg = {};
+    init_cfg.max_store_buf_size = DMA_FRAME_BYTES * 4;
+    init_cfg.conv_num_each_intr = DMA_FRAME_BYTES;
+    init_cfg.adc1_chan_mask = mascara_adc1;
+    init_cfg.adc2_chan_mask = 0;
+    if (adc_digi_initialize(&init_cfg) != ESP_OK)
+    {
+        Serial.println("[ADC-DMA] Error en adc_digi_initialize");
+        return false;
+    }
+
+    adc_digi_configuration_t dig_cfg = {};
+    dig_cfg.conv_limit_en = true; // Obligatorio en ESP32
+    dig_cfg.conv_limit_num = 250;
+    dig_cfg.pattern_num = num_dma_pins;
+    dig_cfg.adc_pattern = patron;
+    dig_cfg.sample_freq_hz = fs_total * dma_decimacion;
+    dig_cfg.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+    dig_cfg.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+    if (adc_digi_controller_configure(&dig_cfg) != ESP_OK)
+    {
+        Serial.println("[ADC-DMA] Error en adc_digi_controller_configure");
+        adc_digi_deinitialize();
+        return false;
+    }
+
+    adc_digi_start();
+    Serial.printf("[ADC-DMA] %d pines, %u Hz totales, decimacion x%d\n",
+                  num_dma_pins, (unsigned)dig_cfg.sample_freq_hz, dma_decimacion);
+    return true;
 }
 
-void TaskProcesamiento(void *pvParameters)
+// Recibe tramas del driver, decima por promedio y vuelca las muestras
+// resultantes en los bloques con una sola sección crítica por trama.
+void TaskAdquisicionDMA(void *pvParameters)
 {
-    TickType_t lastWakeTime = xTaskGetTickCount();
-    const TickType_t xFrequency = pdMS_TO_TICKS(SYSTEM_PROCESS_PERIOD_MS);
+    (void)pvParameters;
+    static uint8_t trama[DMA_FRAME_BYTES];
+    static uint16_t salida_val[DMA_FRAME_BYTES / SOC_ADC_DIGI_RESULT_BYTES];
+    static uint8_t salida_pin[DMA_FRAME_BYTES / SOC_ADC_DIGI_RESULT_BYTES];
+    uint32_t acumulado[NUM_PINES] = {0};
+    int n_acumulado[NUM_PINES] = {0};
 
     while (true)
     {
-        vTaskDelayUntil(&lastWakeTime, xFrequency);
+        uint32_t leidos = 0;
+        esp_err_t ret = adc_digi_read_bytes(trama, DMA_FRAME_BYTES, &leidos, ADC_MAX_DELAY);
+        if (ret == ESP_ERR_INVALID_STATE)
+        {
+            // El buffer interno del driver se llenó: se perdieron tramas
+            dma_tramas_perdidas++;
+        }
+        else if (ret != ESP_OK)
+        {
+            continue;
+        }
 
         if (!sistema_habilitado)
         {
-            vTaskDelay(pdMS_TO_TICKS(1));
+            memset(acumulado, 0, sizeof(acumulado));
+            memset(n_acumulado, 0, sizeof(n_acumulado));
+            continue;
+        }
+
+        int n_salida = 0;
+        for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= leidos; i += SOC_ADC_DIGI_RESULT_BYTES)
+        {
+            adc_digi_output_data_t *p = (adc_digi_output_data_t *)&trama[i];
+            uint8_t ch = p->type1.channel;
+            if (ch >= ADC1_NUM_CANALES || dma_canal_a_pin[ch] < 0)
+                continue;
+
+            int idx = dma_canal_a_pin[ch];
+            acumulado[idx] += p->type1.data;
+            if (++n_acumulado[idx] >= dma_decimacion)
+            {
+                salida_val[n_salida] = (uint16_t)(acumulado[idx] / n_acumulado[idx]);
+                salida_pin[n_salida] = (uint8_t)idx;
+                n_salida++;
+                acumulado[idx] = 0;
+                n_acumulado[idx] = 0;
+            }
+        }
+
+        if (n_salida == 0)
+            continue;
+
+        bool bloque_completo = false;
+        portENTER_CRITICAL(&timerMux);
+        for (int k = 0; k < n_salida; k++)
+        {
+            bloque_completo |= agregarMuestraBloque(salida_pin[k], salida_val[k]);
+        }
+        portEXIT_CRITICAL(&timerMux);
+
+        if (bloque_completo && taskProcesamientoHandle != NULL)
+            xTaskNotifyGive(taskProcesamientoHandle);
+    }
+}
+#endif
+
+void TaskProcesamiento(void *pvParameters)
+{
+    (void)pvParameters;
+
+    // Acumuladores de la ventana en curso
+    double sum_x[NUM_PINES] = {0};
+    double sum_x2[NUM_PINES] = {0};
+    uint32_t n_muestras[NUM_PINES] = {0};
+    int bloques_en_ventana = 0;
+    unsigned long t0_ventana = 0;
+    uint32_t seq_esperada = 0;
+
+    // Timeout para detectar que el sistema se deshabilitó a mitad de ventana
+    const TickType_t xTimeout = pdMS_TO_TICKS(2 * SYSTEM_PROCESS_PERIOD_MS);
+
+    while (true)
+    {
+        if (ulTaskNotifyTake(pdTRUE, xTimeout) == 0)
+        {
+            if (!sistema_habilitado)
+                bloques_en_ventana = 0;
+            continue;
+        }
+
+        // Con dos bloques, el entregado siempre es el que no se está llenando
+        uint8_t idx = bloque_escritura ^ 1;
+        if (!bloque_listo[idx])
             continue;
+
+        const BloqueMuestras &b = bloques[idx];
+
+        // Bloques no consecutivos (overrun o sistema deshabilitado): nueva
+        // ventana y filtros desde cero para no mezclar tramos discontinuos
+        if (b.seq != seq_esperada)
+        {
+            bloques_en_ventana = 0;
+            reiniciarFiltros();
+        }
+
+        if (bloques_en_ventana == 0)
+        {
+            memset(sum_x, 0, sizeof(sum_x));
+            memset(sum_x2, 0, sizeof(sum_x2));
+            memset(n_muestras, 0, sizeof(n_muestras));
+            t0_ventana = b.t0_ms;
+        }
+
+        for (int i = 0; i < NUM_PINES; i++)
+        {
+            const uint16_t *m = b.muestras[i];
+            if (pin_configs[i].filtro != FILTRO_NINGUNO)
+            {
+                filtrarBloque(i, m, b.count[i], sum_x[i], sum_x2[i]);
+            }
+            else
+            {
+                uint32_t sx = 0;
+                uint64_t sx2 = 0;
+                for (int k = 0; k < b.count[i]; k++)
+                {
+                    sx += m[k];
+                    sx2 += (uint32_t)m[k] * m[k];
+                }
+                sum_x[i] += sx;
+                sum_x2[i] += (double)sx2;
+            }
+            n_muestras[i] += b.count[i];
         }
 
+        seq_esperada = b.seq + 1;
+        bloque_listo[idx] = false; // Liberar el bloque para la ISR/DMA
+
+        if (++bloques_en_ventana < BLOQUES_POR_VENTANA)
+            continue;
+        bloques_en_ventana = 0;
+
         ResultadoRMS resultado;
-        resultado.timestamp = millis();
+        resultado.timestamp = t0_ventana;
 
         for (int i = 0; i < NUM_PINES; i++)
         {
-            if (pin_configs[i].enabled && fifo_pins[i].count > 0)
+            if (pin_configs[i].enabled && n_muestras[i] > 0)
             {
-                float rms_value = calculateRMS_fifo(fifo_pins[i], pin_configs[i].gain);
+                float rms_value = calculateRMS_sumas(n_muestras[i], sum_x[i], sum_x2[i],
+                                                     pin_configs[i].gain);
                 float rms_salida;
                 if (!pin_configs[i].ema_initialized)
                 {
@@ -1080,7 +1534,14 @@ volatile unsigned long last_interrupt_time = 0;
 void IRAM_ATTR monitorPinISR() {
     unsigned long interrupt_time = xTaskGetTickCountFromISR(); // Versión segura para ISR
     if (interrupt_time - last_interrupt_time > pdMS_TO_TICKS(50)) { // 50ms debounce
-        sistema_habilitado = (digitalRead(MONITOR_PIN) == LOW);
+        bool habilitado = (digitalRead(MONITOR_PIN) == LOW);
+        if (habilitado && !sistema_habilitado) {
+            // Descartar el bloque parcial anterior para no arrastrar un t0 viejo
+            portENTER_CRITICAL_ISR(&timerMux);
+            reiniciarBloque(bloques[bloque_escritura]);
+            portEXIT_CRITICAL_ISR(&timerMux);
+        }
+        sistema_habilitado = habilitado;
         last_interrupt_time = interrupt_time;
     }
 }
@@ -1103,21 +1564,25 @@ void setup()
     // --- Inicialización de lectores ADC ---
     for (int i = 0; i < NUM_PINES; i++)
     {
+#if ADC_USE_DMA
+        // Los pines del ADC1 los lee el controlador digital, no ESP32AnalogRead
+        if (canalADC1(pin_configs[i].pin) >= 0)
+            continue;
+#endif
         pin_configs[i].reader.attach(pin_configs[i].pin);
     }
 
-    // --- Inicialización de estructuras FIFO ---
-    for (int i = 0; i < NUM_PINES; i++)
+    // --- Inicialización de bloques ping-pong ---
+    for (int i = 0; i < 2; i++)
     {
-        fifo_pins[i].head = 0;
-        fifo_pins[i].count = 0;
-        fifo_pins[i].sum_x = 0;
-        fifo_pins[i].sum_x2 = 0;
+        reiniciarBloque(bloques[i]);
+        bloque_listo[i] = false;
     }
+    bloque_escritura = 0;
+    reiniciarFiltros();
 
     // --- Buffer de resultados ---
     bufferResultados.index = 0;
-    bufferResultados.mutex = xSemaphoreCreateMutex();
 
     // --- Colas para resultados, fragmentos y display ---
     queueResultados =
@@ -1134,19 +1599,53 @@ void setup()
     actualizarNumPinesActivos();
     isr_pin_index = 0;
 
-    // --- Configuración del timer ADC ---
-    int freq_isr = SYSTEM_FS_HZ * num_active_pins; // Usar num_active_pins optimizado
-    if (freq_isr < 1)
-        freq_isr = 1; // Frecuencia mínima de 1 Hz
-    adcTimer =
-        timerBegin(0, 80, true); // Prescaler = 80 → tick de 1 µs (80 MHz / 80)
-    timerAttachInterrupt(adcTimer, &onADCTimer, true);
-    timerAlarmWrite(adcTimer, 1000000 / freq_isr, true);
-    timerAlarmEnable(adcTimer);
+#if ADC_USE_DMA
+    // --- ADC continuo (DMA) para los pines del ADC1 ---
+    if (iniciarADC_DMA())
+    {
+        if (xTaskCreatePinnedToCore(TaskAdquisicionDMA, "AdquisicionDMA", 3072, NULL, 2,
+                                    NULL, 0) != pdPASS)
+        {
+            adc_digi_stop();
+            adc_digi_deinitialize();
+            dma_disponible = false;
+        }
+    }
+    else if (num_dma_pins > 0)
+    {
+        dma_disponible = false;
+    }
+    if (!dma_disponible)
+    {
+        // Sin ADC continuo: los pines del ADC1 vuelven a la ISR del timer, que los
+        // lee con ESP32AnalogRead (no se adjuntaron arriba)
+        Serial.println("[ADC-DMA] No disponible, se muestrea todo con la ISR");
+        for (int i = 0; i < NUM_PINES; i++)
+        {
+            if (canalADC1(pin_configs[i].pin) >= 0)
+                pin_configs[i].reader.attach(pin_configs[i].pin);
+        }
+        actualizarNumPinesActivos();
+        isr_pin_index = 0;
+    }
+#endif
+
+    // --- Configuración del timer ADC (solo si quedan pines para la ISR) ---
+    if (num_isr_pins > 0)
+    {
+        int freq_isr = SYSTEM_FS_HZ * num_isr_pins;
+        if (freq_isr < 1)
+            freq_isr = 1; // Frecuencia mínima de 1 Hz
+        adcTimer =
+            timerBegin(0, 80, true); // Prescaler = 80 → tick de 1 µs (80 MHz / 80)
+        timerAttachInterrupt(adcTimer, &onADCTimer, true);
+        timerAlarmWrite(adcTimer, 1000000 / freq_isr, true);
+        timerAlarmEnable(adcTimer);
+    }
 
     // --- Creación de tareas en FreeRTOS ---
     xTaskCreatePinnedToCore(TaskProcesamiento, "Procesamiento", 4096, NULL, 1,
-                            NULL, 0);
+                            &taskProcesamientoHandle, 0);
     xTaskCreatePinnedToCore(TaskRegistroResultados, "RegistroResultados", 4096,
                             NULL, 1, NULL, 0);
 
@@ -0,0 +1,70 @@
+#ifndef REGISTER_IMAGE_H
+#define REGISTER_IMAGE_H
+
+#include <stdint.h>
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/**
+ * @file RegisterImage.h
+ * @brief Double-buffered Modbus holding-register image.
+ * @details The update task edits the back buffer and publish() swaps it in
+ * atomically; the Modbus worker copies any sub-range of the front buffer
+ * without taking a lock. A generation counter detects the rare case where
+ * the writer published and started editing the buffer a reader was copying,
+ * in which case the reader retries until it gets a stable copy. Response time no longer depends
+ * on how long the update task holds a mutex.
+ */
+template<uint16_t N>
+class RegisterImage {
+public:
+    RegisterImage() : front(0), generation(0) { memset(bufs, 0, sizeof(bufs)); }
+
+    static uint16_t size() { return N; }
+
+    /// Writer only: back buffer preloaded with the current image.
+    uint16_t* edit() {
+        uint8_t back = front ^ 1u;
+        memcpy(bufs[back], bufs[front], sizeof(bufs[0]));
+        return bufs[back];
+    }
+
+    /// Writer only: makes the last edit() visible to readers.
+    void publish() {
+        __atomic_store_n(&front, (uint8_t)(front ^ 1u), __ATOMIC_RELEASE);
+        __atomic_store_n(&generation, generation + 1, __ATOMIC_RELEASE);
+    }
+
+    /// Copies registers [offset, offset + count) of the published image.
+    /// Only returns false when the range falls outside the image.
+    bool read(uint16_t offset, uint16_t count, uint16_t* out) const {
+        if ((uint32_t)offset + count > N) return false;
+        for (int attempt = 0; ; attempt++) {
+            uint32_t g1 = __atomic_load_n(&generation, __ATOMIC_ACQUIRE);
+            uint8_t f = __atomic_load_n(&front, __ATOMIC_ACQUIRE);
+            memcpy(out, bufs[f] + offset, count * sizeof(uint16_t));
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&generation, __ATOMIC_RELAXED) == g1) return true;
+            backoff(attempt);
+        }
+    }
+
+private:
+    static const int kSpinRetries = 4;
+
+    uint16_t bufs[2][N];
+    uint8_t front;
+    uint32_t generation;
+
+    /// Spin first, then yield in case the update task was preempted
+    /// between edit() and publish() by the Modbus worker.
+    static void backoff(int attempt) {
+        if (attempt >= kSpinRetries) vTaskDelay(1);
+    }
+
+    RegisterImage(const RegisterImage&);
+    RegisterImage& operator=(const RegisterImage&);
+};
+
+#endif
@@ -13,6 +13,8 @@
 #include <Adafruit_ADS1X15.h>
 #include "HardwareSerial.h"
 #include "ModbusServerRTU.h"
+#include "HistoryRing.h"
+#include "RegisterImage.h"
 
 // =================================================================
 // --- DEBUG / LOGGING ---
@@ -112,6 +114,57 @@ const int RMS_HISTORY_SIZE = 100;
  */
 #define NUM_REGISTERS 18
 
+/**
+ * @def SEQ_WINDOW_ADDRESS
+ * @brief First register of the sequence-addressed history window.
+ * @details Layout: [seq hi][seq lo][depth H][channels C] followed by H slots of
+ * C registers; the sample with sequence @c s lives in slot <tt>s % H</tt>.
+ * A master reads the 4-register header and then only the slots it has not seen.
+ * @ingroup group_modbus
+ */
+#define SEQ_WINDOW_ADDRESS 1000
+
+/**
+ * @def SEQ_WINDOW_HEADER
+ * @brief Number of header registers in the sequence window.
+ * @ingroup group_modbus
+ */
+#define SEQ_WINDOW_HEADER 4
+
+/**
+ * @def SEQ_WINDOW_DEPTH
+ * @brief Number of samples (per channel) kept in the sequence window.
+ * @ingroup group_modbus
+ */
+#define SEQ_WINDOW_DEPTH 16
+
+/**
+ * @def LATCH_REGISTER
+ * @brief Register written by the master's broadcast (ID 0, FC06) latch command.
+ * @details The written value is a token echoed in the latch bank so the master
+ * can tell a fresh snapshot from a missed broadcast.
+ * @ingroup group_modbus
+ */
+#define LATCH_REGISTER 900
+
+/**
+ * @def LATCH_BANK_ADDRESS
+ * @brief Snapshot taken by the last latch command.
+ * @details Layout: [token][seq hi][seq lo], padded to LATCH_HEADER_REGS, then a
+ * copy of the data block, so the latched copy of register @c r sits at
+ * <tt>r + LATCH_BANK_ADDRESS + LATCH_HEADER_REGS - startAddress</tt>
+ * (startAddress + 500 with the default layout).
+ * @ingroup group_modbus
+ */
+#define LATCH_BANK_ADDRESS 500
+
+/**
+ * @def LATCH_HEADER_REGS
+ * @brief Number of header registers in front of the latched data block.
+ * @ingroup group_modbus
+ */
+#define LATCH_HEADER_REGS 10
+
 /**
  * @def RX_PIN
  * @brief UART receive pin for RS485.
@@ -200,34 +253,13 @@ struct RMS_FIFO {
 RMS_FIFO fifos[NUM_CHANNELS];
 
 /**
- * @brief RMS value history for channel 0.
+ * @brief RMS value history, one ring per channel.
+ * @details Single writer (task_procesamiento), lock-free readers via seqlock.
  * @ingroup group_adc_rms
  */
-float rms_history_ch0[RMS_HISTORY_SIZE];
+HistoryRing<float> rms_history[NUM_CHANNELS];
 
-/**
- * @brief RMS value history for channel 1.
- * @ingroup group_adc_rms
- */
-float rms_history_ch1[RMS_HISTORY_SIZE];
-
-/**
- * @brief RMS value history for channel 2.
- * @ingroup group_adc_rms
- */
-float rms_history_ch2[RMS_HISTORY_SIZE];
-
-/**
- * @brief Write index for RMS histories.
- * @ingroup group_adc_rms
- */
-volatile int rms_history_head = 0;
-
-/**
- * @brief Mutex for concurrent access protection to RMS histories.
- * @ingroup group_adc_rms
- */
-SemaphoreHandle_t rms_history_mutex;
+int get_rms_history(int channel, float* output_buffer, int count);
 
 /**
  * @brief ADC data ready flag (ISR).
@@ -248,16 +280,25 @@ volatile uint8_t current_isr_channel = 0;
 ModbusServerRTU MBserver(2000);
 
 /**
- * @brief Modbus registers for RMS data.
+ * @brief Double-buffered Modbus register image for RMS data.
+ * @details Published atomically by the processing task; the Modbus worker
+ * copies any in-range sub-block without locking.
  * @ingroup group_modbus
  */
-uint16_t holdingRegisters[NUM_REGISTERS];
+RegisterImage<NUM_REGISTERS> holdingRegisters;
 
 /**
- * @brief Mutex for Modbus register protection.
+ * @brief Sequence window image (header + ring), see SEQ_WINDOW_ADDRESS.
  * @ingroup group_modbus
  */
-SemaphoreHandle_t dataMutex;
+RegisterImage<SEQ_WINDOW_HEADER + SEQ_WINDOW_DEPTH * NUM_CHANNELS> seqWindow;
+
+/**
+ * @brief Latch bank image, see LATCH_BANK_ADDRESS.
+ * @details Only written by the broadcast worker.
+ * @ingroup group_modbus
+ */
+RegisterImage<LATCH_HEADER_REGS + NUM_REGISTERS> latchBank;
 
 /**
  * @brief Handle for Modbus data update task.
@@ -346,30 +387,23 @@ void task_procesamiento(void *pvParameters) {
             float calculated_rms[NUM_CHANNELS] = {0};
             
             // --- PARTE A: CALCULAR Y GUARDAR HISTORIAL ---
-            if (xSemaphoreTake(rms_history_mutex, portMAX_DELAY) == pdTRUE) {
-                for (int i = 0; i < NUM_CHANNELS; i++) {
-                    if (fifos[i].count > 0) {
-                        double mean = (double)fifos[i].sum_x / fifos[i].count;
-                        double var = ((double)fifos[i].sum_x2 / fifos[i].count) - (mean * mean);
-                        calculated_rms[i] = sqrt(var < 0 ? 0 : var);
-                    }
+            for (int i = 0; i < NUM_CHANNELS; i++) {
+                if (fifos[i].count > 0) {
+                    double mean = (double)fifos[i].sum_x / fifos[i].count;
+                    double var = ((double)fifos[i].sum_x2 / fifos[i].count) - (mean * mean);
+                    calculated_rms[i] = sqrt(var < 0 ? 0 : var);
                 }
-                rms_history_ch0[rms_history_head] = calculated_rms[0];
-                rms_history_ch1[rms_history_head] = calculated_rms[1];
-                rms_history_ch2[rms_history_head] = calculated_rms[2];
-                
-                #if LOG_RMS
-                Serial.printf("[RMS] T=%lu head=%d CH0=%.1f CH1=%.1f CH2=%.1f\n",
-                              millis(), rms_history_head,
-                              calculated_rms[0], calculated_rms[1], calculated_rms[2]);
-                #endif
-                
-                rms_history_head = (rms_history_head + 1) % RMS_HISTORY_SIZE;
-                xSemaphoreGive(rms_history_mutex);
+                rms_history[i].push(calculated_rms[i]);
             }
+            
+            #if LOG_RMS
+            Serial.printf("[RMS] T=%lu seq=%u CH0=%.1f CH1=%.1f CH2=%.1f\n",
+                          millis(), (unsigned)rms_history[0].sequence(),
+                          calculated_rms[0], calculated_rms[1], calculated_rms[2]);
+            #endif
 
-            // --- PARTE B: ACTUALIZAR MODBUS ---
-            if (xSemaphoreTake(dataMutex, portMAX_DELAY) == pdTRUE) {
+            // --- PARTE B: ACTUALIZAR MODBUS (doble buffer, sin mutex) ---
+            {
                 float rms_channel[NUM_CHANNELS][samples_per_channel];
                 int counts[NUM_CHANNELS];
 
@@ -377,21 +411,36 @@ void task_procesamiento(void *pvParameters) {
                     counts[ch] = get_rms_history(ch, rms_channel[ch], samples_per_channel);
                 }
 
+                uint16_t* regs = holdingRegisters.edit();
                 for (int ch = 0; ch < NUM_CHANNELS; ch++) {
                     for (int i = 0; i < samples_per_channel; i++) {
                         int idx = ch * samples_per_channel + i;
                         float volts = rms_channel[ch][i] * CONVERSION_FACTORS[ch]; 
-                        holdingRegisters[idx] = (counts[ch] > i) ? (uint16_t)round(volts) : 0;
+                        regs[idx] = (counts[ch] > i) ? (uint16_t)round(volts) : 0;
                     }
                 }
                 
                 #if LOG_MODBUS_REG_UPDATE
                 Serial.printf("[MODBUS] Regs CH0: %u,%u,%u,%u,%u,%u\n",
-                              holdingRegisters[0], holdingRegisters[1], holdingRegisters[2],
-                              holdingRegisters[3], holdingRegisters[4], holdingRegisters[5]);
+                              regs[0], regs[1], regs[2], regs[3], regs[4], regs[5]);
                 #endif
                 
-                xSemaphoreGive(dataMutex);
+                holdingRegisters.publish();
+            }
+
+            // --- PARTE C: VENTANA POR SECUENCIA (solo la muestra nueva) ---
+            {
+                uint32_t seq = rms_history[0].sequence();
+                uint16_t* win = seqWindow.edit();
+                uint16_t* slot = win + SEQ_WINDOW_HEADER + (seq % SEQ_WINDOW_DEPTH) * NUM_CHANNELS;
+                for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+                    slot[ch] = (uint16_t)round(calculated_rms[ch] * CONVERSION_FACTORS[ch]);
+                }
+                win[0] = (uint16_t)(seq >> 16);
+                win[1] = (uint16_t)(seq & 0xFFFF);
+                win[2] = SEQ_WINDOW_DEPTH;
+                win[3] = NUM_CHANNELS;
+                seqWindow.publish();
             }
         }
         vTaskDelay(pdMS_TO_TICKS(10));
@@ -400,7 +449,8 @@ void task_procesamiento(void *pvParameters) {
 
 /**
  * @brief Gets RMS value history for a specific channel.
- * @details Extracts the last N RMS values in a thread-safe manner using mutex.
+ * @details Copies the last N RMS values without blocking the processing task
+ * (seqlock read, at most two memcpy spans).
  * Values are returned in chronological order (oldest first).
  * @param channel Channel number (0, 1 or 2).
  * @param output_buffer Output buffer for RMS values.
@@ -409,28 +459,10 @@ void task_procesamiento(void *pvParameters) {
  * @ingroup group_adc_rms
  */
 int get_rms_history(int channel, float* output_buffer, int count) {
-    if (count > RMS_HISTORY_SIZE || channel < 0 || channel >= NUM_CHANNELS) {
+    if (channel < 0 || channel >= NUM_CHANNELS) {
         return 0;
     }
-
-    float* source_buffer;
-    switch(channel) {
-        case 0: source_buffer = rms_history_ch0; break;
-        case 1: source_buffer = rms_history_ch1; break;
-        case 2: source_buffer = rms_history_ch2; break;
-        default: return 0;
-    }
-
-    if (xSemaphoreTake(rms_history_mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-        int most_recent_idx = (rms_history_head == 0) ? (RMS_HISTORY_SIZE - 1) : (rms_history_head - 1);
-        for (int i = 0; i < count; i++) {
-            int source_idx = (most_recent_idx - (count - 1 - i) + RMS_HISTORY_SIZE) % RMS_HISTORY_SIZE;
-            output_buffer[i] = source_buffer[source_idx];
-        }
-        xSemaphoreGive(rms_history_mutex);
-        return count;
-    }
-    return 0;
+    return rms_history[channel].latest(output_buffer, count);
 }
 
 // =================================================================
@@ -439,7 +471,7 @@ int get_rms_history(int channel, float* output_buffer, int count) {
 
 /**
  * @brief Modbus register update task with per-channel conversion factors.
- * @details Periodically updates Modbus registers with latest RMS values
+ * @details Periodically publishes the Modbus register image with latest RMS values
  * from all channels. Dynamically organizes data according to configured number of channels.
  * Applies channel-specific conversion factors from CONVERSION_FACTORS array.
  * @param pvParameters Task parameters (unused).
@@ -451,31 +483,29 @@ void dataUpdateTask(void *pvParameters) {
     const int samples_per_channel = NUM_REGISTERS / NUM_CHANNELS;
 
     while (true) {
-        if (xSemaphoreTake(dataMutex, portMAX_DELAY) == pdTRUE) {
-            float rms_channel[NUM_CHANNELS][samples_per_channel];
-            int counts[NUM_CHANNELS];
+        float rms_channel[NUM_CHANNELS][samples_per_channel];
+        int counts[NUM_CHANNELS];
 
-            for (int ch = 0; ch < NUM_CHANNELS; ch++) {
-                counts[ch] = get_rms_history(ch, rms_channel[ch], samples_per_channel);
-            }
+        for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+            counts[ch] = get_rms_history(ch, rms_channel[ch], samples_per_channel);
+        }
 
-            for (int ch = 0; ch < NUM_CHANNELS; ch++) {
-                for (int i = 0; i < samples_per_channel; i++) {
-                    int idx = ch * samples_per_channel + i;
-                    
-                    /**
-                     * @brief Application of channel-specific conversion factor.
-                     * @details Uses CONVERSION_FACTORS[ch] instead of global factor
-                     * to enable individual channel calibration.
-                     */
-                    float volts = rms_channel[ch][i] * CONVERSION_FACTORS[ch]; 
-                    
-                    holdingRegisters[idx] = (counts[ch] > i) ? (uint16_t)round(volts) : 0;
-                }
+        uint16_t* regs = holdingRegisters.edit();
+        for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+            for (int i = 0; i < samples_per_channel; i++) {
+                int idx = ch * samples_per_channel + i;
+                
+                /**
+                 * @brief Application of channel-specific conversion factor.
+                 * @details Uses CONVERSION_FACTORS[ch] instead of global factor
+                 * to enable individual channel calibration.
+                 */
+                float volts = rms_channel[ch][i] * CONVERSION_FACTORS[ch]; 
+                
+                regs[idx] = (counts[ch] > i) ? (uint16_t)round(volts) : 0;
             }
-
-            xSemaphoreGive(dataMutex);
         }
+        holdingRegisters.publish();
         vTaskDelay(pdMS_TO_TICKS(MODBUS_UPDATE_INTERVAL_MS));
     }
 }
@@ -502,12 +532,45 @@ struct SensorData {
  */
 SensorData sensor = {1, 3, 10, NUM_REGISTERS, PROCESS_INTERVAL_MS, 1, 1, 0};
 
+/**
+ * @brief Freezes the published data block and sequence number into the latch bank.
+ * @param token Value written by the master, echoed in the first bank register.
+ * @ingroup group_modbus
+ */
+void latchSnapshot(uint16_t token) {
+    uint16_t* bank = latchBank.edit();
+    holdingRegisters.read(0, NUM_REGISTERS, bank + LATCH_HEADER_REGS);
+    seqWindow.read(0, 2, bank + 1);
+    bank[0] = token;
+    latchBank.publish();
+}
+
+/**
+ * @brief Worker for broadcast (ID 0) messages; they never get a response.
+ * @details A FC06 write to LATCH_REGISTER latches the current values, so every
+ * slave on the bus snapshots the same instant.
+ * @param msg Received broadcast message.
+ * @ingroup group_modbus
+ */
+void broadcastWorker(ModbusMessage msg) {
+    uint16_t address = 0, value = 0;
+    if (msg.getFunctionCode() != WRITE_HOLD_REGISTER) return;
+    msg.get(2, address);
+    msg.get(4, value);
+    if (address == LATCH_REGISTER) {
+        latchSnapshot(value);
+    }
+}
+
 /**
  * @brief Worker to handle Modbus holding register read requests.
  * @details Responds to two types of queries:
  * - Registers 0-7: Sensor configuration parameters
  * - Registers 10+: Historical RMS data
- * Implements address boundary validation to prevent invalid access.
+ * - Registers 500+: Latch bank (snapshot taken by the last broadcast latch)
+ * - Registers 1000+: Sequence window (incremental reads)
+ * Any sub-range of either block is accepted; data reads never wait on
+ * the processing task.
  * @param request Received Modbus request message.
  * @return ModbusMessage Formatted Modbus response.
  * @ingroup group_modbus
@@ -529,54 +592,74 @@ ModbusMessage readHoldingRegistersWorker(ModbusMessage request) {
                   (unsigned)address, (unsigned)words);
     #endif
 
-    if (address == 0 && words == 8) {
+    if (words == 0 || words > 125) {
+        response.setError(request.getServerID(), request.getFunctionCode(), ILLEGAL_DATA_VALUE);
+
+        #if LOG_MODBUS_FRAMES
+        logModbusMessageHex("TX-EX", response);
+        #endif
+        return response;
+    }
+
+    if (address + words <= 8) {
+        const uint16_t* d = reinterpret_cast<const uint16_t*>(&sensor);
         response.add(request.getServerID(), request.getFunctionCode(), (uint8_t)(words * 2));
-        response.add(sensor.sensorID);
-        response.add(sensor.numberOfChannels);
-        response.add(sensor.startAddress);
-        response.add(sensor.maxRegisters);
-        response.add(sensor.samplingInterval);
-        response.add(sensor.dataType);
-        response.add(sensor.scale);
-        response.add(sensor.compressedBytes);
+        for (uint16_t i = 0; i < words; ++i) {
+            response.add(d[address + i]);
+        }
 
         #if LOG_MODBUS_FRAMES
         logModbusMessageHex("TX", response);
         #endif
         return response;
     }
-    else if (address == 10 && words == NUM_REGISTERS)
+    else if (address >= sensor.startAddress && address + words <= sensor.startAddress + NUM_REGISTERS)
     {
-        if (xSemaphoreTake(dataMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-            response.add(request.getServerID(), request.getFunctionCode(), (uint8_t)(words * 2));
-            for (uint16_t i = 0; i < words; ++i) {
-                response.add((uint16_t)holdingRegisters[i]);
-            }
-
-            #if LOG_MODBUS_FRAMES
-            Serial.print("[MODBUS] TX regs:");
-            for (uint16_t i = 0; i < words; ++i) {
-                Serial.printf(" %u", (unsigned)holdingRegisters[i]);
-            }
-            Serial.println();
-            logModbusMessageHex("TX", response);
-            #endif
-
-            xSemaphoreGive(dataMutex);
-        } else {
-            response.setError(request.getServerID(), request.getFunctionCode(), SERVER_DEVICE_BUSY);
+        // Any sub-range of the data block, copied from the published image without locking
+        uint16_t regs[NUM_REGISTERS];
+        holdingRegisters.read(address - sensor.startAddress, words, regs);
+        response.add(request.getServerID(), request.getFunctionCode(), (uint8_t)(words * 2));
+        for (uint16_t i = 0; i < words; ++i) {
+            response.add(regs[i]);
+        }
 
-            #if LOG_MODBUS_FRAMES
-            logModbusMessageHex("TX-EX", response);
-            #endif
+        #if LOG_MODBUS_FRAMES
+        Serial.print("[MODBUS] TX regs:");
+        for (uint16_t i = 0; i < words; ++i) {
+            Serial.printf(" %u", (unsigned)regs[i]);
         }
+        Serial.println();
+        logModbusMessageHex("TX", response);
+        #endif
         return response;
     }
-    else if (address >= NUM_REGISTERS || (address + words) > NUM_REGISTERS) {
-        response.setError(request.getServerID(), request.getFunctionCode(), ILLEGAL_DATA_ADDRESS);
+    else if (address >= LATCH_BANK_ADDRESS && address + words <= LATCH_BANK_ADDRESS + latchBank.size())
+    {
+        // Latch bank: same lock-free copy as the live block
+        uint16_t regs[LATCH_HEADER_REGS + NUM_REGISTERS];
+        latchBank.read(address - LATCH_BANK_ADDRESS, words, regs);
+        response.add(request.getServerID(), request.getFunctionCode(), (uint8_t)(words * 2));
+        for (uint16_t i = 0; i < words; ++i) {
+            response.add(regs[i]);
+        }
 
         #if LOG_MODBUS_FRAMES
-        logModbusMessageHex("TX-EX", response);
+        logModbusMessageHex("TX", response);
+        #endif
+        return response;
+    }
+    else if (address >= SEQ_WINDOW_ADDRESS && address + words <= SEQ_WINDOW_ADDRESS + seqWindow.size())
+    {
+        // Sequence window: header and/or ring slots, same lock-free copy
+        uint16_t regs[SEQ_WINDOW_HEADER + SEQ_WINDOW_DEPTH * NUM_CHANNELS];
+        seqWindow.read(address - SEQ_WINDOW_ADDRESS, words, regs);
+        response.add(request.getServerID(), request.getFunctionCode(), (uint8_t)(words * 2));
+        for (uint16_t i = 0; i < words; ++i) {
+            response.add(regs[i]);
+        }
+
+        #if LOG_MODBUS_FRAMES
+        logModbusMessageHex("TX", response);
         #endif
         return response;
     }
@@ -615,11 +698,8 @@ void setup() {
     ModbusSerial.begin(19200, SERIAL_8N1, RX_PIN, TX_PIN);
 
     queue_adc_samples = xQueueCreate(FIFO_SIZE, sizeof(ADC_Sample));
-    rms_history_mutex = xSemaphoreCreateMutex();
-    dataMutex = xSemaphoreCreateMutex();
-    if (!rms_history_mutex || !dataMutex) {
-        Serial.println("ERROR: Could not create mutexes.");
-        while (1);
+    for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+        rms_history[ch].init(RMS_HISTORY_SIZE);
     }
 
     // ALERT/RDY es open-drain: necesita pull-up
@@ -630,6 +710,7 @@ void setup() {
     // ads.startComparator_SingleEnded(0, 1000);
 
     MBserver.registerWorker(SLAVE_ID, READ_HOLD_REGISTER, &readHoldingRegistersWorker);
+    MBserver.registerBroadcastWorker(&broadcastWorker);
     MBserver.setModbusTimeout(2000);
 
     xTaskCreatePinnedToCore(task_adquisicion, "TaskAdquisicion", 4096, NULL, 5, NULL, 0);
@@ -0,0 +1,83 @@
+#ifndef ADS1X15_IDF_H
+#define ADS1X15_IDF_H
+
+#include <Adafruit_ADS1X15.h>   // Solo constantes (MUX, ganancia, data rate)
+#include <Arduino.h>
+#include <driver/i2c.h>
+
+// ===== BACKEND ADS1x15 SOBRE EL DRIVER I2C DE ESP-IDF =====
+// Misma interfaz que Adafruit_ADS1X15 para lo que usan los managers, pero
+// cada operación es un único command link (i2c_master_cmd_begin):
+//  - startADCReading(): escribe CONFIG y deja el puntero en CONVERSION.
+//  - getLastConversionResults(): lectura directa de 2 bytes (puntero ya fijado).
+//  - readAndStart(): lee el resultado listo y arranca la siguiente
+//    conversión en la misma transacción (1 link por muestra en vez de 6
+//    transacciones Wire con Adafruit).
+// Con enableReadyPin() el ALERT/RDY avisa el fin de conversión por
+// notificación a la tarea (sin polling del bit OS).
+// El reloj del bus lo fija ADS1x15Idf::installBus() y nadie lo reconfigura.
+
+class ADS1x15Idf {
+public:
+    // Instala el driver I2C maestro (una vez por puerto)
+    static bool installBus(i2c_port_t port, int sda, int scl, uint32_t clock_hz);
+    static bool probe(uint8_t addr);
+
+    explicit ADS1x15Idf(uint8_t bit_shift) : m_bitShift(bit_shift) {}
+    virtual ~ADS1x15Idf() {}
+
+    bool begin(uint8_t i2c_addr = 0x48, void* unused_wire = nullptr);
+    void setGain(adsGain_t gain) { m_gain = gain; }
+    adsGain_t getGain() { return m_gain; }
+    void setDataRate(uint16_t rate) { m_dataRate = rate; }
+    uint16_t getDataRate() { return m_dataRate; }
+
+    // Compatibilidad con la API de Adafruit
+    int16_t readADC_SingleEnded(uint8_t channel);
+    int16_t readADC_Differential_0_1() { return readBlocking(ADS1X15_REG_CONFIG_MUX_DIFF_0_1); }
+    int16_t readADC_Differential_0_3() { return readBlocking(ADS1X15_REG_CONFIG_MUX_DIFF_0_3); }
+    int16_t readADC_Differential_1_3() { return readBlocking(ADS1X15_REG_CONFIG_MUX_DIFF_1_3); }
+    int16_t readADC_Differential_2_3() { return readBlocking(ADS1X15_REG_CONFIG_MUX_DIFF_2_3); }
+    void startADCReading(uint16_t mux, bool continuous);
+    bool conversionComplete();
+    int16_t getLastConversionResults();
+    float computeVolts(int16_t counts);
+
+    // ---- Camino rápido ----
+    // Lee el resultado disponible y arranca una conversión single-shot en 'next_mux'
+    bool readAndStart(uint16_t next_mux, int16_t& result);
+
+    // Configura ALERT/RDY como "conversión lista" y notifica a 'task' en cada flanco
+    bool enableReadyPin(int gpio, TaskHandle_t task);
+
+private:
+    static i2c_port_t s_port;
+    static const TickType_t kTimeout;
+
+    uint8_t m_addr = 0x48;
+    uint8_t m_bitShift;
+    adsGain_t m_gain = GAIN_TWOTHIRDS;
+    uint16_t m_dataRate = 0;
+    bool m_rdyEnabled = false;
+    TaskHandle_t m_rdyTask = nullptr;
+
+    uint16_t configWord(uint16_t mux, bool continuous) const;
+    bool writeRegister(uint8_t reg, uint16_t value, bool leave_on_conversion);
+    bool readRegister(uint8_t reg, uint16_t& value);
+    int16_t toSigned(uint16_t raw) const;
+    int16_t readBlocking(uint16_t mux);
+
+    static void IRAM_ATTR rdyIsr(void* arg);
+};
+
+class ADS1015Idf : public ADS1x15Idf {
+public:
+    ADS1015Idf() : ADS1x15Idf(4) { setDataRate(RATE_ADS1015_1600SPS); }
+};
+
+class ADS1115Idf : public ADS1x15Idf {
+public:
+    ADS1115Idf() : ADS1x15Idf(0) { setDataRate(RATE_ADS1115_128SPS); }
+};
+
+#endif
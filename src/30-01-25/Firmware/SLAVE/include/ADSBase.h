@@ -3,11 +3,26 @@
 
 #include <Adafruit_ADS1X15.h>
 #include <Arduino.h>
+#include "I2CBus.h"
+#if ADS_BACKEND_IDF
+#include "ADS1x15Idf.h"
+#endif
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
 
 enum class ADSType { ADS1015, ADS1115 };
 
+// Backend del chip: Adafruit (Wire) o driver I2C de ESP-IDF con command links
+#if ADS_BACKEND_IDF
+typedef ADS1x15Idf ADSDevice;
+typedef ADS1015Idf ADSDevice1015;
+typedef ADS1115Idf ADSDevice1115;
+#else
+typedef Adafruit_ADS1X15 ADSDevice;
+typedef Adafruit_ADS1015 ADSDevice1015;
+typedef Adafruit_ADS1115 ADSDevice1115;
+#endif
+
 // ===== CONFIGURACIÓN BASE (lo que TODO ADC necesita) =====
 struct ADSBaseConfig {
     ADSType type;
@@ -16,60 +31,87 @@ struct ADSBaseConfig {
     int process_interval_ms;
 };
 
+// ===== CONFIGURACIÓN EN TIEMPO DE EJECUCIÓN =====
+// Cada driver expone ADS_CONFIG_REGS registros ajustables por Modbus (FC06/FC10).
+// Comunes: [0] process_interval_ms, [1] SPS del chip (un data rate soportado).
+// El resto depende del driver (ver getConfig de cada uno); los no usados leen 0.
+#define ADS_CONFIG_REGS 16
+
 // ===== CLASE BASE ABSTRACTA =====
 class ADSBase {
 protected:
     // Variables COMUNES a todas las clases hijas
-    Adafruit_ADS1X15* ads;
+    ADSDevice* ads;
     ADSBaseConfig base_config;
-    SemaphoreHandle_t data_mutex;
     
     // Métodos PROTEGIDOS (solo accesibles por clases hijas)
     bool initADS() {
+        I2CBus::Guard bus;
         if (!ads->begin(base_config.i2c_addr, &Wire)) {
             return false;
         }
         ads->setGain(base_config.gain);
+        I2CBus::restoreClock();
         return true;
     }
     
-    // Función auxiliar para leer un canal
-    int16_t readChannel(uint8_t channel) {
-        switch(channel) {
-            // --- Lecturas Single-Ended (Normales) ---
-            case 0: return ads->readADC_SingleEnded(0);
-            case 1: return ads->readADC_SingleEnded(1);
-            case 2: return ads->readADC_SingleEnded(2);
-            case 3: return ads->readADC_SingleEnded(3);
-            
-            // --- Lecturas Diferenciales ---
-            case 10: // Código especial para Par 0-1
-                return ads->readADC_Differential_0_1();
-            case 30: // Código especial para Par 0-3
-                return ads->readADC_Differential_0_3();
-            case 31: // Código especial para Par 1-3
-                return ads->readADC_Differential_1_3();
-            case 32: // Código especial para Par 2-3
-                return ads->readADC_Differential_2_3();
-                
-            default: return 0;
+    // Configura el data rate más cercano soportado y devuelve los SPS efectivos
+    uint16_t applyDataRate(uint16_t sps) {
+        if (base_config.type == ADSType::ADS1115) {
+            switch(sps) {
+                case 8:    ads->setDataRate(RATE_ADS1115_8SPS);   return 8;
+                case 16:   ads->setDataRate(RATE_ADS1115_16SPS);  return 16;
+                case 32:   ads->setDataRate(RATE_ADS1115_32SPS);  return 32;
+                case 64:   ads->setDataRate(RATE_ADS1115_64SPS);  return 64;
+                case 250:  ads->setDataRate(RATE_ADS1115_250SPS); return 250;
+                case 475:  ads->setDataRate(RATE_ADS1115_475SPS); return 475;
+                case 860:  ads->setDataRate(RATE_ADS1115_860SPS); return 860;
+                case 128:
+                default:   ads->setDataRate(RATE_ADS1115_128SPS); return 128; // Fallback seguro
+            }
+        } else {
+            switch(sps) {
+                case 128:  ads->setDataRate(RATE_ADS1015_128SPS);  return 128;
+                case 250:  ads->setDataRate(RATE_ADS1015_250SPS);  return 250;
+                case 490:  ads->setDataRate(RATE_ADS1015_490SPS);  return 490;
+                case 920:  ads->setDataRate(RATE_ADS1015_920SPS);  return 920;
+                case 2400: ads->setDataRate(RATE_ADS1015_2400SPS); return 2400;
+                case 3300: ads->setDataRate(RATE_ADS1015_3300SPS); return 3300;
+                case 1600:
+                default:   ads->setDataRate(RATE_ADS1015_1600SPS); return 1600;
+            }
         }
     }
 
+    // true si 'sps' es un data rate exacto del chip (applyDataRate no lo redondearía)
+    bool dataRateSupported(uint16_t sps) const {
+        static const uint16_t rates1115[] = {8, 16, 32, 64, 128, 250, 475, 860};
+        static const uint16_t rates1015[] = {128, 250, 490, 920, 1600, 2400, 3300};
+        const uint16_t* rates = (base_config.type == ADSType::ADS1115) ? rates1115 : rates1015;
+        int n = (base_config.type == ADSType::ADS1115) ? 8 : 7;
+        for (int i = 0; i < n; i++) {
+            if (rates[i] == sps) return true;
+        }
+        return false;
+    }
+
+    // Validación de los registros comunes [0] y [1]
+    bool validBaseConfig(const uint16_t* regs) const {
+        return regs[0] >= 10 && regs[0] <= 60000 && dataRateSupported(regs[1]);
+    }
+
 public:
     ADSBase(const ADSBaseConfig& cfg) : base_config(cfg) {
         // Crear el objeto ADS según el tipo
         if (cfg.type == ADSType::ADS1015) {
-            ads = new Adafruit_ADS1015();
+            ads = new ADSDevice1015();
         } else {
-            ads = new Adafruit_ADS1115();
+            ads = new ADSDevice1115();
         }
-        data_mutex = xSemaphoreCreateMutex();
     }
     
     virtual ~ADSBase() {
         delete ads;
-        if (data_mutex) vSemaphoreDelete(data_mutex);
     }
     
     // ===== MÉTODOS VIRTUALES PUROS (obligatorios para clases hijas) =====
@@ -77,37 +119,42 @@ public:
     virtual void startSampling() = 0;
     virtual float getLatest(int channel) = 0; // Pure virtual
     virtual int getHistory(int channel, float* buffer, int count) = 0; // Pure virtual
+
+    // Lecturas incrementales: número de secuencia del último valor (0 = ninguno)
+    // y copia de los valores con secuencia > after_seq (ver HistoryRing::since)
+    virtual uint32_t getSequence(int channel) = 0;
+    virtual int getHistorySince(int channel, uint32_t after_seq, float* buffer, int max,
+                                uint32_t* first_seq) = 0;
+
+    // Configuración ajustable: getConfig llena ADS_CONFIG_REGS registros;
+    // setConfig valida todo el bloque y lo aplica sin reiniciar (false = rechazado, sin cambios).
+    // Puede llamarse antes de begin(): lo que dependa del hardware se aplica al arrancar.
+    virtual void getConfig(uint16_t* regs) = 0;
+    virtual bool setConfig(const uint16_t* regs) = 0;
+
+    // Captura de transitorios: copia el evento pendiente (ver TransientCapture) y
+    // rearma el disparo. Devuelve los registros copiados, 0 si no hay evento o el
+    // sensor no captura.
+    virtual uint16_t takeTransient(uint16_t* regs, uint16_t max) { return 0; }
 };
 
-// Función auxiliar para obtener Volts por Bit según ganancia y chip
-static float getVoltsPerBit(adsGain_t gain, ADSType type) {
-    float v_fsr = 0.0f; // Voltaje Full Scale Range (+/-)
-    
-    switch(gain) {
-        case GAIN_TWOTHIRDS: v_fsr = 6.144f; break;
-        case GAIN_ONE:       v_fsr = 4.096f; break;
-        case GAIN_TWO:       v_fsr = 2.048f; break;
-        case GAIN_FOUR:      v_fsr = 1.024f; break;
-        case GAIN_EIGHT:     v_fsr = 0.512f; break;
-        case GAIN_SIXTEEN:   v_fsr = 0.256f; break;
-        default:             v_fsr = 6.144f;
-    }
+// Voltaje Full Scale Range (+/-) según ganancia
+constexpr float adsFullScale(adsGain_t gain) {
+    return gain == GAIN_TWOTHIRDS ? 6.144f :
+           gain == GAIN_ONE       ? 4.096f :
+           gain == GAIN_TWO       ? 2.048f :
+           gain == GAIN_FOUR      ? 1.024f :
+           gain == GAIN_EIGHT     ? 0.512f :
+           gain == GAIN_SIXTEEN   ? 0.256f : 6.144f;
+}
 
-    // ADS1015 corre de -2048 a +2047 (12 bits -> shift 4 = efective 11 bits + signo) -> Rango total / 2048
-    // ADS1115 corre de -32768 a +32767 (16 bits) -> Rango total / 32768
-    
-    // NOTA: La librería de Adafruit devuelve los valores del 1015 ya ajustados 
-    // a rango de 12 bits pero desplazados como int16, pero para cálculo puro de voltaje:
-    
-    if (type == ADSType::ADS1015) {
-         // Adafruit normaliza un poco raro el 1015, usualmente se divide por 2048 si es raw 12-bit
-         // Pero si la librería devuelve el valor "shifteado", puede tratarse igual en rango.
-         // Para simplificar, Adafruit provee un método computeVolts(bit), 
-         // pero si quieres el factor RAW matemático:
-         return v_fsr / 2048.0f; // ADS1015 (11 bits efectivos positivos)
-    } else {
-         return v_fsr / 32768.0f; // ADS1115 (15 bits efectivos positivos)
-    }
+// Función auxiliar para obtener Volts por Bit según ganancia y chip.
+// constexpr para que ADSSequencer lo resuelva en compilación.
+// ADS1015 corre de -2048 a +2047 (la librería ya desplaza 4 bits) -> Rango total / 2048
+// ADS1115 corre de -32768 a +32767 (16 bits) -> Rango total / 32768
+constexpr float getVoltsPerBit(adsGain_t gain, ADSType type) {
+    return type == ADSType::ADS1015 ? adsFullScale(gain) / 2048.0f
+                                    : adsFullScale(gain) / 32768.0f;
 }
 
 #endif
\ No newline at end of file
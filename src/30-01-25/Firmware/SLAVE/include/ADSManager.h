@@ -2,9 +2,34 @@
 #define ADS_MANAGER_H
 
 #include "ADSBase.h"
+#include "ADSSequencer.h"
+#include "HistoryRing.h"
+#include "TransientCapture.h"
 #include <freertos/task.h>
 #include <freertos/queue.h>
 
+// ===== CAPTURA DE TRANSITORIOS =====
+// Ventana por canal alrededor del disparo (muestras crudas) y valores iniciales
+// del disparo; estos últimos son ajustables por Modbus (registros [8..11]).
+#ifndef TRANSIENT_PRE_SAMPLES
+#define TRANSIENT_PRE_SAMPLES 32
+#endif
+#ifndef TRANSIENT_POST_SAMPLES
+#define TRANSIENT_POST_SAMPLES 96
+#endif
+#ifndef TRANSIENT_LEVEL
+#define TRANSIENT_LEVEL 0          // |x - DC| en cuentas (0 = desactivado)
+#endif
+#ifndef TRANSIENT_SLOPE
+#define TRANSIENT_SLOPE 0          // Salto entre muestras en cuentas (0 = desactivado)
+#endif
+#ifndef TRANSIENT_CYCLE_PCT
+#define TRANSIENT_CYCLE_PCT 20     // Desvío del RMS de un ciclo respecto a la referencia (%)
+#endif
+#ifndef TRANSIENT_MAINS_HZ
+#define TRANSIENT_MAINS_HZ 50      // Para la longitud de ciclo automática
+#endif
+
 // ===== CONFIGURACIÓN EXTENDIDA (hereda de ADSBaseConfig) =====
 struct ADSConfig : public ADSBaseConfig {
     int alert_pin;
@@ -13,26 +38,29 @@ struct ADSConfig : public ADSBaseConfig {
     int history_size;
     int num_channels;
     const float* conversion_factors;
+    ADSSequence channels;   // Secuencia de canales generada por ADSSequencer<>
     
-    // ← AGREGAR: Constructor para facilitar la inicialización
-    ADSConfig(ADSType t, uint8_t addr, adsGain_t g, int interval, int ch, const float* factors,
+    // Chip, ganancia y canales salen de la secuencia (resuelta en compilación)
+    ADSConfig(const ADSSequence& seq, uint8_t addr, int interval, const float* factors,
               int alert, int sps, int fifo, int hist)
-        : ADSBaseConfig{t, addr, g, interval},  // Inicializar clase base
-          num_channels(ch),
-          conversion_factors(factors),
+        : ADSBaseConfig{seq.type, addr, seq.gain, interval},  // Inicializar clase base
           alert_pin(alert),
           samples_per_second(sps),
           fifo_size(fifo),
-          history_size(hist) {}
+          history_size(hist),
+          num_channels(seq.count),
+          conversion_factors(factors),
+          channels(seq) {}
     
     ADSConfig() 
         : ADSBaseConfig{ADSType::ADS1015, 0x48, GAIN_TWOTHIRDS, 0},
-          num_channels(0),
-          conversion_factors(nullptr),
           alert_pin(-1),
           samples_per_second(0),
           fifo_size(0),
-          history_size(0) {}
+          history_size(0),
+          num_channels(0),
+          conversion_factors(nullptr),
+          channels{ADSType::ADS1015, GAIN_TWOTHIRDS, nullptr, nullptr, 0, 0.0f} {}
 };
 
 // Estructura para una muestra leída (sin cambios)
@@ -62,9 +90,26 @@ private:
     
     // Procesamiento RMS (sin cambios)
     RMS_FIFO* fifos;
-    float** rms_histories;
-    volatile int rms_history_head;
-    SemaphoreHandle_t rms_mutex;
+    HistoryRing<float>* rms_histories;   // Un historial por canal (sin mutex)
+
+    // Ajustables en caliente (setConfig): factores propios (copia de config),
+    // tamaño de FIFO pendiente (lo aplica la tarea de procesamiento) y SPS efectivos
+    float* factors;
+    volatile int pending_fifo_size;
+    volatile uint16_t effective_sps;
+    void resizeFifos(int size);
+
+    // Disparo sobre muestras crudas; cycle_len_cfg = 0 calcula el ciclo desde los SPS
+    TransientCapture capture;
+    uint16_t cycle_len_cfg;
+    void applyTrigger(uint16_t level, uint16_t slope, uint16_t cycle_pct, uint16_t cycle_len);
+
+    // Factores y disparo escritos por setConfig (tarea Modbus); la tarea de
+    // procesamiento los copia de una vez a factors/capture cuando config_pending
+    float* pending_factors;
+    TransientCapture::Trigger pending_trigger;
+    volatile bool config_pending;
+    portMUX_TYPE config_mux = portMUX_INITIALIZER_UNLOCKED;
     
     // Tareas (sin cambios)
     TaskHandle_t acquisition_task_handle;
@@ -86,7 +131,17 @@ public:
     // API para obtener datos procesados (sin cambios)
     int getHistory(int channel, float* output_buffer, int count);
     float getLatest(int channel);
+    uint32_t getSequence(int channel);
+    int getHistorySince(int channel, uint32_t after_seq, float* output_buffer, int max,
+                        uint32_t* first_seq);
     void getRMSAllChannels(float* output_array);
+
+    // Config: [0] intervalo ms, [1] SPS, [2] fifo_size, [3 + ch] factor de conversión x10000,
+    // [8] nivel, [9] pendiente, [10] desvío de ciclo %, [11] muestras por ciclo (0 = auto)
+    void getConfig(uint16_t* regs) override;
+    bool setConfig(const uint16_t* regs) override;
+
+    uint16_t takeTransient(uint16_t* regs, uint16_t max) override;
 };
 
 #endif // ADS_MANAGER_H
\ No newline at end of file
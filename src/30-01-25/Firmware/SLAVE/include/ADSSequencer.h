@@ -0,0 +1,87 @@
+#ifndef ADS_SEQUENCER_H
+#define ADS_SEQUENCER_H
+
+#include "ADSBase.h"
+
+// ===== SECUENCIADOR DE CANALES EN TIEMPO DE COMPILACIÓN =====
+// La lista de canales (single-ended o diferenciales), el chip y la ganancia
+// son parámetros de plantilla. De ahí salen, en compilación, la tabla de
+// palabras MUX y el factor V/bit, de modo que el bucle de adquisición solo
+// indexa una tabla (sin switch por muestra). Un código de canal inválido
+// es un error de compilación en lugar de una lectura que devuelve 0.
+
+// Códigos de canal (mismos valores que usaban los managers)
+namespace ADSCh {
+    constexpr uint8_t AIN0     = 0;
+    constexpr uint8_t AIN1     = 1;
+    constexpr uint8_t AIN2     = 2;
+    constexpr uint8_t AIN3     = 3;
+    constexpr uint8_t DIFF_0_1 = 10;
+    constexpr uint8_t DIFF_0_3 = 30;
+    constexpr uint8_t DIFF_1_3 = 31;
+    constexpr uint8_t DIFF_2_3 = 32;
+}
+
+constexpr bool adsCanalValido(uint8_t code) {
+    return code <= ADSCh::AIN3 || code == ADSCh::DIFF_0_1 || code == ADSCh::DIFF_0_3 ||
+           code == ADSCh::DIFF_1_3 || code == ADSCh::DIFF_2_3;
+}
+
+constexpr uint16_t adsMuxDeCanal(uint8_t code) {
+    return code == ADSCh::AIN0     ? ADS1X15_REG_CONFIG_MUX_SINGLE_0 :
+           code == ADSCh::AIN1     ? ADS1X15_REG_CONFIG_MUX_SINGLE_1 :
+           code == ADSCh::AIN2     ? ADS1X15_REG_CONFIG_MUX_SINGLE_2 :
+           code == ADSCh::AIN3     ? ADS1X15_REG_CONFIG_MUX_SINGLE_3 :
+           code == ADSCh::DIFF_0_1 ? ADS1X15_REG_CONFIG_MUX_DIFF_0_1 :
+           code == ADSCh::DIFF_0_3 ? ADS1X15_REG_CONFIG_MUX_DIFF_0_3 :
+           code == ADSCh::DIFF_1_3 ? ADS1X15_REG_CONFIG_MUX_DIFF_1_3 :
+                                     ADS1X15_REG_CONFIG_MUX_DIFF_2_3;
+}
+
+// Un canal individual validado en compilación
+template<uint8_t Code>
+struct ADSChannel {
+    static_assert(adsCanalValido(Code), "Codigo de canal ADS invalido (usar 0-3, 10, 30, 31 o 32)");
+    static constexpr uint8_t code = Code;
+    static constexpr uint16_t mux = adsMuxDeCanal(Code);
+};
+
+// Vista en tiempo de ejecución de una secuencia (lo que guardan las configs)
+struct ADSSequence {
+    ADSType type;
+    adsGain_t gain;
+    const uint16_t* mux;     // MUX precalculado por posición
+    const uint8_t* codes;    // Código de canal por posición (para logs/registro)
+    uint8_t count;
+    float volts_per_bit;
+};
+
+// Solo la tabla MUX (para quien fija chip y ganancia en tiempo de ejecución)
+template<uint8_t... Codes>
+struct ADSMuxTable {
+    static constexpr uint8_t count = sizeof...(Codes);
+    static_assert(sizeof...(Codes) > 0, "La secuencia ADS necesita al menos un canal");
+    static constexpr uint16_t mux[sizeof...(Codes)] = { ADSChannel<Codes>::mux... };
+    static constexpr uint8_t codes[sizeof...(Codes)] = { Codes... };
+};
+
+template<uint8_t... Codes>
+constexpr uint16_t ADSMuxTable<Codes...>::mux[sizeof...(Codes)];
+template<uint8_t... Codes>
+constexpr uint8_t ADSMuxTable<Codes...>::codes[sizeof...(Codes)];
+
+// Secuencia completa: chip + ganancia + canales
+template<ADSType Chip, adsGain_t Gain, uint8_t... Codes>
+struct ADSSequencer : public ADSMuxTable<Codes...> {
+    static_assert(sizeof...(Codes) <= 4, "El ADS1x15 tiene como maximo 4 canales por secuencia");
+    static constexpr ADSType type = Chip;
+    static constexpr adsGain_t gain = Gain;
+    static constexpr float volts_per_bit = getVoltsPerBit(Gain, Chip);
+
+    static ADSSequence sequence() {
+        return ADSSequence{Chip, Gain, ADSMuxTable<Codes...>::mux, ADSMuxTable<Codes...>::codes,
+                           (uint8_t)sizeof...(Codes), volts_per_bit};
+    }
+};
+
+#endif
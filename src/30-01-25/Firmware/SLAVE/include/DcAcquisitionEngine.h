@@ -0,0 +1,57 @@
+#ifndef DC_ACQUISITION_ENGINE_H
+#define DC_ACQUISITION_ENGINE_H
+
+#include "ADSBase.h"
+#include <freertos/task.h>
+
+// ===== MOTOR DE ADQUISICIÓN DC (Temp / Press) =====
+// Un único secuenciador por esclavo recorre todos los canales registrados:
+// pone el ADS en modo continuo con el MUX del canal, toma 'decimation'
+// conversiones consecutivas al data rate del chip y las promedia
+// (CIC de orden 1 = integrar y volcar). El resultado queda disponible
+// como último valor en voltios más un número de secuencia.
+
+#define DC_ENGINE_MAX_CANALES 12
+
+class DcAcquisitionEngine {
+public:
+    static DcAcquisitionEngine& instance();
+
+    // Registra un canal y devuelve su slot (-1 si no hay espacio).
+    // data_rate_sps debe ser el data rate ya configurado en el chip.
+    int addChannel(ADSDevice* ads, uint16_t mux, uint16_t data_rate_sps,
+                   uint8_t decimation, float volts_per_bit);
+
+    // Cambia data rate (ya configurado en el chip) y decimación de un slot en caliente
+    bool setTiming(int slot, uint16_t data_rate_sps, uint8_t decimation);
+
+    // Arranca la tarea del secuenciador (idempotente)
+    void start();
+
+    // Último valor decimado del slot. Devuelve false si aún no hay datos.
+    bool read(int slot, float& volts, uint32_t* seq = nullptr);
+
+private:
+    struct Slot {
+        ADSDevice* ads;
+        uint16_t mux;
+        uint32_t period_us;     // Periodo de conversión con margen de tolerancia
+        uint8_t decimation;
+        float volts_per_bit;
+        float volts;            // Último valor decimado
+        uint32_t seq;           // 0 = sin datos todavía
+    };
+
+    DcAcquisitionEngine();
+
+    Slot slots[DC_ENGINE_MAX_CANALES];
+    int num_slots = 0;
+    TaskHandle_t task_handle = nullptr;
+    portMUX_TYPE slot_mux = portMUX_INITIALIZER_UNLOCKED;
+
+    static void task_trampoline(void* arg);
+    void task_body();
+    float acquire(Slot& s);
+};
+
+#endif
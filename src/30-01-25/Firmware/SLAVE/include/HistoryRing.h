@@ -0,0 +1,137 @@
+#ifndef HISTORY_RING_H
+#define HISTORY_RING_H
+
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/**
+ * @file HistoryRing.h
+ * @brief Single-writer / multi-reader circular history protected by a seqlock.
+ * @details The producer task (RMS / Temp / Press processing) calls push() and
+ * never waits on readers. Readers (Modbus worker, dataUpdateTask, loop) copy
+ * out with at most two memcpy spans and retry until no push overlapped the
+ * copy, so neither side takes a mutex. Each pushed value gets a monotonically
+ * increasing sequence number (the first push is sequence 1).
+ */
+template<typename T>
+class HistoryRing {
+    static_assert(std::is_trivially_copyable<T>::value, "HistoryRing<T> requires a trivially copyable T");
+
+public:
+    HistoryRing() : buf(nullptr), cap(0), head(0), written(0), version(0) {}
+    explicit HistoryRing(uint32_t capacity) : HistoryRing() { init(capacity); }
+    ~HistoryRing() { delete[] buf; }
+
+    /// Reserves the buffer (zero-filled). Must be called before the writer starts.
+    bool init(uint32_t capacity) {
+        delete[] buf;
+        buf = capacity ? new T[capacity]() : nullptr;
+        cap = buf ? capacity : 0;
+        head = 0;
+        written = 0;
+        version = 0;
+        return buf != nullptr;
+    }
+
+    uint32_t capacity() const { return cap; }
+
+    /// Sequence number of the newest value (0 = nothing pushed yet).
+    uint32_t sequence() const { return __atomic_load_n(&written, __ATOMIC_ACQUIRE); }
+
+    /// Writer side (single task only).
+    void push(const T& value) {
+        if (cap == 0) return;
+        uint32_t v = version;
+        __atomic_store_n(&version, v + 1, __ATOMIC_RELAXED);   // odd: write in progress
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+
+        buf[head] = value;
+        uint32_t next = head + 1;
+        head = (next == cap) ? 0 : next;
+        __atomic_store_n(&written, written + 1, __ATOMIC_RELAXED);
+
+        __atomic_store_n(&version, v + 2, __ATOMIC_RELEASE);   // even: consistent
+    }
+
+    /**
+     * @brief Copies the last @p count values, oldest first.
+     * @details Slots never written read as zero, matching the previous
+     * mutex-based histories. Returns @p count, or 0 if @p count exceeds the
+     * capacity.
+     */
+    int latest(T* out, int count) const {
+        if (count <= 0 || (uint32_t)count > cap) return 0;
+        for (int attempt = 0; ; attempt++) {
+            uint32_t v1 = __atomic_load_n(&version, __ATOMIC_ACQUIRE);
+            if (v1 & 1u) { backoff(attempt); continue; }
+            uint32_t h = head;
+            uint32_t start = (h >= (uint32_t)count) ? h - count : h + cap - count;
+            copySpans(out, start, count);
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&version, __ATOMIC_RELAXED) == v1) return count;
+            backoff(attempt);
+        }
+    }
+
+    /**
+     * @brief Copies up to @p max values newer than sequence @p after_seq, oldest first.
+     * @details If @p after_seq is older than what the ring still holds, the copy
+     * starts at the oldest retained value. @p first_seq receives the sequence
+     * number of out[0]. Returns the number of values copied (0 if none).
+     */
+    int since(uint32_t after_seq, T* out, int max, uint32_t* first_seq = nullptr) const {
+        if (max <= 0 || cap == 0) return 0;
+        for (int attempt = 0; ; attempt++) {
+            uint32_t v1 = __atomic_load_n(&version, __ATOMIC_ACQUIRE);
+            if (v1 & 1u) { backoff(attempt); continue; }
+            uint32_t w = written;
+            uint32_t h = head;
+            uint32_t oldest = (w > cap) ? w - cap + 1 : 1;
+            uint32_t from = after_seq + 1;
+            if (from < oldest) from = oldest;
+            if (from > w) return 0;
+            uint32_t n = w - from + 1;
+            if (n > (uint32_t)max) n = max;
+            // 'h' is the slot for sequence w+1; step back (w+1-from) slots
+            uint32_t back = w + 1 - from;
+            uint32_t start = (h >= back) ? h - back : h + cap - back;
+            copySpans(out, start, n);
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&version, __ATOMIC_RELAXED) == v1) {
+                if (first_seq) *first_seq = from;
+                return (int)n;
+            }
+            backoff(attempt);
+        }
+    }
+
+private:
+    static const int kSpinRetries = 4;
+
+    T* buf;
+    uint32_t cap;
+    uint32_t head;               ///< Next slot to write.
+    uint32_t written;            ///< Total values pushed (= newest sequence).
+    uint32_t version;            ///< Seqlock counter, odd while push() is running.
+
+    /// push() is only a few instructions: spin first, then yield in case the
+    /// writer was preempted mid-push by a higher-priority reader.
+    static void backoff(int attempt) {
+        if (attempt >= kSpinRetries) vTaskDelay(1);
+    }
+
+    void copySpans(T* out, uint32_t start, uint32_t n) const {
+        uint32_t first = cap - start;
+        if (first > n) first = n;
+        memcpy(out, buf + start, first * sizeof(T));
+        if (n > first) memcpy(out + first, buf, (n - first) * sizeof(T));
+    }
+
+    HistoryRing(const HistoryRing&);
+    HistoryRing& operator=(const HistoryRing&);
+};
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#if ADS_BACKEND_IDF
+#include "ADS1x15Idf.h"
+#endif
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+// ===== SECUENCIADOR DEL BUS I2C =====
+// Varios ADSBase (0x48-0x4B) comparten el mismo Wire desde tareas distintas.
+// Cada transacción (o grupo corto de transacciones de una misma muestra) se
+// hace bajo I2CBus::Guard; el mutex con herencia de prioridad reparte el bus
+// entre tareas a nivel de transacción, de modo que mientras un chip convierte
+// (sin tener el bus) los demás pueden usarlo.
+// Con ADS_BACKEND_IDF=1 el bus lo maneja el driver I2C de ESP-IDF (no Wire)
+// y el reloj queda fijo desde begin().
+#ifndef ADS_BACKEND_IDF
+#define ADS_BACKEND_IDF 0
+#endif
+
+#ifndef I2C_IDF_PORT
+#define I2C_IDF_PORT I2C_NUM_0
+#endif
+
+class I2CBus {
+public:
+    static void begin(int sda, int scl, uint32_t clock_hz) {
+        clockHz() = clock_hz;
+#if ADS_BACKEND_IDF
+        if (!ADS1x15Idf::installBus(I2C_IDF_PORT, sda, scl, clock_hz)) {
+            Serial.println("I2CBus: ERROR instalando driver I2C IDF");
+        }
+#else
+        Wire.begin(sda, scl);
+        Wire.setClock(clock_hz);
+#endif
+        mutex();
+    }
+
+    // La librería de Adafruit reconfigura el reloj en begin(): se restaura aquí
+    static void restoreClock() {
+#if !ADS_BACKEND_IDF
+        Guard g;
+        Wire.setClock(clockHz());
+#endif
+    }
+
+    // true si un dispositivo responde con ACK en 'addr'
+    static bool probe(uint8_t addr) {
+        Guard g;
+#if ADS_BACKEND_IDF
+        return ADS1x15Idf::probe(addr);
+#else
+        Wire.beginTransmission(addr);
+        return Wire.endTransmission() == 0;
+#endif
+    }
+
+    static bool lock(TickType_t timeout = portMAX_DELAY) {
+        return xSemaphoreTakeRecursive(mutex(), timeout) == pdTRUE;
+    }
+
+    static void unlock() {
+        xSemaphoreGiveRecursive(mutex());
+    }
+
+    // Sección RAII: toma el bus en el constructor y lo libera al salir del ámbito
+    class Guard {
+    public:
+        Guard() { I2CBus::lock(); }
+        ~Guard() { I2CBus::unlock(); }
+    private:
+        Guard(const Guard&);
+        Guard& operator=(const Guard&);
+    };
+
+private:
+    static SemaphoreHandle_t mutex() {
+        static SemaphoreHandle_t m = xSemaphoreCreateRecursiveMutex();
+        return m;
+    }
+    static uint32_t& clockHz() {
+        static uint32_t hz = 400000;
+        return hz;
+    }
+};
+
+#endif
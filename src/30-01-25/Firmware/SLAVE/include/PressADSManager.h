@@ -2,10 +2,13 @@
 #define PRESS_ADS_MANAGER_H
 
 #include "ADSBase.h"
+#include "ADSSequencer.h"
+#include "HistoryRing.h"
+#include "DcAcquisitionEngine.h"
 #include <freertos/task.h>
 #include <freertos/queue.h>
 
-struct ADSconfig : public ADSBaseConfig {
+struct PressADSConfig : public ADSBaseConfig {
     // Parámetros para sensor de presión 0.5-4.5V
     float min_voltage;           // Voltaje mínimo (0.5V)
     float max_voltage;           // Voltaje máximo (4.5V)
@@ -16,7 +19,7 @@ struct ADSconfig : public ADSBaseConfig {
     int history_size;            // Tamaño del historial
     u_int8_t NUM_SAMPLES;       // Número de muestras para promediar en cada lectura (para reducir ruido)
 
-    ADSconfig(ADSType t, uint8_t addr, adsGain_t g, int process_interval_ms,
+    PressADSConfig(ADSType t, uint8_t addr, adsGain_t g, int process_interval_ms,
               float v_min, float v_max, float p_min, float p_max,
               uint8_t channels, uint16_t sampling_rate, uint8_t NUM_SAMPLES, int hist_size)
         : ADSBaseConfig{t, addr, g, process_interval_ms},
@@ -29,7 +32,7 @@ struct ADSconfig : public ADSBaseConfig {
           NUM_SAMPLES(NUM_SAMPLES),
           history_size(hist_size) {}
     
-    ADSconfig() 
+    PressADSConfig() 
         : ADSBaseConfig{ADSType::ADS1015, 0x48, GAIN_TWOTHIRDS, 0},
           min_voltage(0.5f),
           max_voltage(4.5f),
@@ -42,27 +45,16 @@ struct ADSconfig : public ADSBaseConfig {
     
 };
 
-struct ADCSample {
-    int16_t value;
-    uint8_t channel;
-};
-
 class PressADSManager : public ADSBase {
     private:
-        ADSconfig config;
+        PressADSConfig config;
         TaskHandle_t press_task_handle = nullptr;
 
         // --- GESTIÓN DE DATOS ---
-        // Array de punteros para buffers circulares (soporta hasta 4 canales del ADS1115)
-        // pressure_histories[0] -> Historial Canal 0, etc.
-        // Si el canal no está activo en 'active_channels', el puntero será nullptr.
-        float* pressure_histories[4] = {nullptr, nullptr, nullptr, nullptr};
-        
-        // Cabeza (índice de escritura) para cada buffer circular
-        int history_heads[4] = {0, 0, 0, 0};
-        
-        // Mutex para proteger la lectura/escritura simultánea de los historiales
-        SemaphoreHandle_t data_mutex;
+        // Historial circular por canal (soporta hasta 4 canales del ADS1115)
+        // Si el canal no está activo en 'active_channels', su capacidad es 0.
+        // Seqlock: los lectores nunca bloquean a press_task_body.
+        HistoryRing<float> pressure_histories[4];
 
         // --- TAREAS ---
         static void press_task_trampoline(void* arg);
@@ -71,16 +63,25 @@ class PressADSManager : public ADSBase {
         // Helper interno para convertir voltaje a unidades de presión
         float convertVoltageToPressure(float voltage);
 
-        float getRaw(uint8_t channel, uint8_t NUM_SAMPLES = 1);
+        // Slot de DcAcquisitionEngine por canal (-1 si el canal no está activo)
+        int engine_slots[4] = {-1, -1, -1, -1};
+
+        // Protege la escala (min/max de voltaje y presión) frente a setConfig
+        portMUX_TYPE scale_mux = portMUX_INITIALIZER_UNLOCKED;
+
+        // Canal lógico (0..popcount(active_channels)-1) -> canal físico del ADS, -1 si no existe
+        int physicalChannel(int channel) const;
 
     public:
-        PressADSManager(const ADSconfig& config);
+        PressADSManager(const PressADSConfig& config);
         virtual ~PressADSManager();
 
         bool begin() override;
         void startSampling() override;
 
         // --- API ESTANDARIZADA (Igual a ADSManager/TempADSManager) ---
+        // 'channel' es el índice lógico entre los canales activos (el n-ésimo bit
+        // a 1 de active_channels), igual que numberOfChannels en el descriptor.
         
         // Obtiene el último valor de presión calculado para un canal específico
         float getLatest(int channel);
@@ -88,6 +89,16 @@ class PressADSManager : public ADSBase {
         // Copia el historial de presión de un canal específico al buffer de salida
         // Retorna la cantidad de datos copiados
         int getHistory(int channel, float* output_buffer, int count);
+
+        // Secuencia y lectura incremental (todos los canales activos avanzan juntos)
+        uint32_t getSequence(int channel);
+        int getHistorySince(int channel, uint32_t after_seq, float* output_buffer, int max,
+                            uint32_t* first_seq);
+
+        // Config: [0] intervalo ms, [1] SPS, [2] NUM_SAMPLES, [3] V mín (mV), [4] V máx (mV),
+        // [5] P mín x10 (int16), [6] P máx x10 (int16)
+        void getConfig(uint16_t* regs) override;
+        bool setConfig(const uint16_t* regs) override;
 };
 
 #endif
\ No newline at end of file
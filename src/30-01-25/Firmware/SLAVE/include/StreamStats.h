@@ -0,0 +1,142 @@
+#ifndef STREAM_STATS_H
+#define STREAM_STATS_H
+
+#include <stdint.h>
+#include <math.h>
+#include <float.h>
+
+/**
+ * @file StreamStats.h
+ * @brief Fixed-memory streaming summary: min, max, mean, variance and one quantile.
+ * @details Mean and variance use Welford's update. The quantile is exact
+ * (nearest rank) over the first kExactSamples values and switches to the P²
+ * estimator (Jain & Chlamtac, five markers) above that, where its error is
+ * small. One instance per channel and reporting window: add() every value,
+ * read the summary, reset() for the next window.
+ */
+class StreamStats {
+public:
+    explicit StreamStats(float quantile = 0.95f) : p(quantile) { reset(); }
+
+    void reset() {
+        n = 0;
+        vmin = FLT_MAX;
+        vmax = -FLT_MAX;
+        m = 0.0;
+        m2 = 0.0;
+    }
+
+    void add(float x) {
+        n++;
+        if (x < vmin) vmin = x;
+        if (x > vmax) vmax = x;
+
+        double delta = x - m;
+        m += delta / n;
+        m2 += delta * (x - m);
+
+        if (n <= kExactSamples) exact[n - 1] = x;
+
+        if (n <= 5) {
+            q[n - 1] = x;
+            if (n == 5) startMarkers();
+            return;
+        }
+        updateMarkers(x);
+    }
+
+    uint32_t count() const { return n; }
+    float min() const { return n ? vmin : 0.0f; }
+    float max() const { return n ? vmax : 0.0f; }
+    float mean() const { return (float)m; }
+    float variance() const { return n > 1 ? (float)(m2 / (n - 1)) : 0.0f; }
+    float stddev() const { return sqrtf(variance()); }
+
+    /// Quantile; exact (nearest rank) up to kExactSamples values, P² estimate above.
+    float quantile() const {
+        if (n > kExactSamples) return q[2];
+        if (n == 0) return 0.0f;
+        float s[kExactSamples];
+        for (uint32_t i = 0; i < n; i++) s[i] = exact[i];
+        sort(s, n);
+        uint32_t rank = (uint32_t)ceilf(p * n);
+        return s[rank ? rank - 1 : 0];
+    }
+
+private:
+    static const uint32_t kExactSamples = 32;
+
+    float p;
+    uint32_t n;
+    float vmin, vmax;
+    double m, m2;
+
+    // First values of the window, kept for the exact small-sample quantile
+    float exact[kExactSamples];
+
+    // P² markers: heights, actual positions (1-based) and desired positions
+    float q[5];
+    int32_t pos[5];
+    float want[5];
+
+    static void sort(float* v, uint32_t len) {
+        for (uint32_t i = 1; i < len; i++) {
+            float key = v[i];
+            int32_t j = (int32_t)i - 1;
+            while (j >= 0 && v[j] > key) { v[j + 1] = v[j]; j--; }
+            v[j + 1] = key;
+        }
+    }
+
+    void startMarkers() {
+        sort(q, 5);
+        for (int i = 0; i < 5; i++) pos[i] = i + 1;
+        want[0] = 1.0f;
+        want[1] = 1.0f + 2.0f * p;
+        want[2] = 1.0f + 4.0f * p;
+        want[3] = 3.0f + 2.0f * p;
+        want[4] = 5.0f;
+    }
+
+    void updateMarkers(float x) {
+        int k;
+        if (x < q[0]) {
+            q[0] = x;
+            k = 0;
+        } else if (x >= q[4]) {
+            q[4] = x;
+            k = 3;
+        } else {
+            k = 0;
+            while (k < 3 && x >= q[k + 1]) k++;
+        }
+
+        for (int i = k + 1; i < 5; i++) pos[i]++;
+        want[1] += p / 2.0f;
+        want[2] += p;
+        want[3] += (1.0f + p) / 2.0f;
+        want[4] += 1.0f;
+
+        for (int i = 1; i <= 3; i++) {
+            float d = want[i] - pos[i];
+            if ((d >= 1.0f && pos[i + 1] - pos[i] > 1) || (d <= -1.0f && pos[i - 1] - pos[i] < -1)) {
+                int s = (d > 0) ? 1 : -1;
+                float qp = parabolic(i, s);
+                if (q[i - 1] < qp && qp < q[i + 1]) {
+                    q[i] = qp;
+                } else {
+                    q[i] += s * (q[i + s] - q[i]) / (pos[i + s] - pos[i]);
+                }
+                pos[i] += s;
+            }
+        }
+    }
+
+    float parabolic(int i, int s) const {
+        float a = (float)(pos[i] - pos[i - 1] + s) * (q[i + 1] - q[i]) / (pos[i + 1] - pos[i]);
+        float b = (float)(pos[i + 1] - pos[i] - s) * (q[i] - q[i - 1]) / (pos[i] - pos[i - 1]);
+        return q[i] + (float)s / (pos[i + 1] - pos[i - 1]) * (a + b);
+    }
+};
+
+#endif
@@ -2,18 +2,21 @@
 #define TEMP_ADS_MANAGER_H
 
 #include "ADSBase.h"
+#include "ADSSequencer.h"
+#include "HistoryRing.h"
+#include "DcAcquisitionEngine.h"
 #include <freertos/task.h>
 #include <freertos/queue.h>
 
 
-struct ADSconfig : public ADSBaseConfig {
+struct TempADSConfig : public ADSBaseConfig {
     int serie_resistor_ohms;
     int r0_ohms;
     uint16_t sampling_rate;
     uint8_t NUM_SAMPLES;
     int history_size; // <--- NUEVO: Para igualar a ADSManager
 
-    ADSconfig(ADSType t, uint8_t addr, adsGain_t g, int process_interval_ms,
+    TempADSConfig(ADSType t, uint8_t addr, adsGain_t g, int process_interval_ms,
               int series_resistor, int r0, uint16_t sampling_rate, uint8_t NUM_SAMPLES, int hist_size)
         : ADSBaseConfig{t, addr, g, process_interval_ms},
           serie_resistor_ohms(series_resistor),
@@ -21,7 +24,7 @@ struct ADSconfig : public ADSBaseConfig {
           sampling_rate(sampling_rate),
           NUM_SAMPLES(NUM_SAMPLES),
           history_size(hist_size) {} // <--- Init
-    ADSconfig() 
+    TempADSConfig() 
         : ADSBaseConfig{ADSType::ADS1015, 0x48, GAIN_TWOTHIRDS, 0},
           serie_resistor_ohms(0),
           r0_ohms(100),
@@ -32,21 +35,25 @@ struct ADSconfig : public ADSBaseConfig {
 
 class TempADSManager : public ADSBase {
 private:
-    ADSconfig config;
+    TempADSConfig config;
     TaskHandle_t temp_task_handle = nullptr;
     
-    // --- NUEVO PARA ALMACENAMIENTO ---
-    float* temp_history = nullptr; // Buffer circular
-    int history_head = 0;
-    SemaphoreHandle_t data_mutex;  // Para proteger la lectura/escritura del historial
-    // ---------------------------------
+    // --- ALMACENAMIENTO ---
+    HistoryRing<float> temp_history; // Historial circular (seqlock, sin mutex)
+
+    // Slots en DcAcquisitionEngine (NUM_SAMPLES = factor de decimación)
+    int slot_vref = -1;
+    int slot_vcable = -1;
+    int slot_vpt100 = -1;
+
+    // Protege las resistencias (serie y R0) frente a setConfig
+    portMUX_TYPE config_mux = portMUX_INITIALIZER_UNLOCKED;
 
     static void temp_task_trampoline(void* arg);
     void temp_task_body();
-    float getRaw(uint8_t channel, uint8_t NUM_SAMPLES = 1);
 
 public:
-    TempADSManager(const ADSconfig& config);
+    TempADSManager(const TempADSConfig& config);
     virtual ~TempADSManager();
 
     bool begin() override;
@@ -55,6 +62,13 @@ public:
     // --- MÉTODOS ESTANDARIZADOS (Iguales a ADSManager) ---
     float getLatest(int channel = 0); // Renombrado para que sea genérico
     int getHistory(int channel, float* output_buffer, int count);
+    uint32_t getSequence(int channel);
+    int getHistorySince(int channel, uint32_t after_seq, float* output_buffer, int max,
+                        uint32_t* first_seq);
+
+    // Config: [0] intervalo ms, [1] SPS, [2] NUM_SAMPLES, [3] R serie (ohm), [4] R0 (ohm)
+    void getConfig(uint16_t* regs) override;
+    bool setConfig(const uint16_t* regs) override;
 };
 
 #endif
\ No newline at end of file
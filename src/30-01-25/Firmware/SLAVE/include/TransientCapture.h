@@ -0,0 +1,236 @@
+#ifndef TRANSIENT_CAPTURE_H
+#define TRANSIENT_CAPTURE_H
+
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+/**
+ * @file TransientCapture.h
+ * @brief Trigger engine on raw ADC samples with a pre/post-trigger capture window.
+ * @details The producer (the RMS processing task) calls add() for every raw
+ * sample. Each channel keeps a ring of the last pre + post samples, a slow DC
+ * estimate and a per-cycle RMS. A sample fires the trigger when any enabled
+ * condition holds:
+ *  - level: |x - dc| above a threshold (counts),
+ *  - slope: |x - previous sample| above a threshold (counts per sample),
+ *  - cycle: the RMS of the last cycle deviates from the running reference by
+ *    more than a percentage (sags, swells, inrush).
+ * After @c post more samples of the triggering channel, every channel's ring is
+ * frozen into the event buffer. The consumer copies it out with take(), which
+ * re-arms the trigger; while an event is waiting, new triggers are ignored, so
+ * a slow reader never sees a half-overwritten event.
+ *
+ * Event layout (registers): [seq hi][seq lo][ms hi][ms lo][(cause << 8) | channel]
+ * [channels][samples per channel][pre-trigger samples], then the raw samples
+ * channel by channel, oldest first. The trigger sample is the last pre-trigger one.
+ */
+class TransientCapture {
+public:
+    enum Cause : uint8_t { CAUSE_LEVEL = 1, CAUSE_SLOPE = 2, CAUSE_CYCLE = 4 };
+
+    /// Trigger settings; 0 disables a condition. cycle_len is in samples per channel.
+    struct Trigger {
+        uint16_t level;
+        uint16_t slope;
+        uint16_t cycle_pct;
+        uint16_t cycle_len;
+    };
+
+    static const uint16_t kHeaderRegs = 8;
+
+    static uint16_t regsFor(uint8_t channels, uint16_t pre, uint16_t post) {
+        return kHeaderRegs + channels * (pre + post);
+    }
+
+    TransientCapture()
+        : chans(nullptr), event(nullptr), num_channels(0), pre(0), len(0),
+          state(ARMED), trig_ch(0), cause(0), remaining(0), trig_ms(0),
+          event_seq(0), frozen(false) {
+        trig = Trigger{0, 0, 0, 0};
+    }
+
+    ~TransientCapture() { release(); }
+
+    /// Reserves the rings and the event buffer. Must be called before the producer starts.
+    bool init(uint8_t channels, uint16_t pre_samples, uint16_t post_samples) {
+        release();
+        num_channels = channels;
+        pre = pre_samples;
+        len = pre_samples + post_samples;
+        chans = new Channel[channels];
+        for (uint8_t ch = 0; ch < channels; ch++) {
+            chans[ch].ring = new int16_t[len]();
+            resetChannel(chans[ch]);
+        }
+        event = new uint16_t[regsFor(channels, pre_samples, post_samples)]();
+        state = ARMED;
+        return len > pre;
+    }
+
+    /// May be called from another task: each field is picked up on the next sample.
+    void setTrigger(const Trigger& t) { trig = t; }
+    Trigger trigger() const { return trig; }
+
+    /// Producer only: one raw sample of channel @p ch taken at @p now_ms.
+    void add(uint8_t ch, int16_t x, uint32_t now_ms) {
+        if (ch >= num_channels) return;
+        Channel& c = chans[ch];
+
+        c.ring[c.head] = x;
+        c.head = (c.head + 1 == len) ? 0 : c.head + 1;
+        if (c.filled < len) c.filled++;
+
+        // Slow DC estimate (Q8): the AC part is measured around it
+        if (!c.started) {
+            c.dc_q8 = (int32_t)x << 8;
+            c.prev = x;
+            c.started = true;
+        }
+        c.dc_q8 += (((int32_t)x << 8) - c.dc_q8) >> kDcShift;
+        int32_t ac = x - (c.dc_q8 >> 8);
+
+        uint8_t fired = 0;
+        if (trig.level && labs(ac) > trig.level) fired |= CAUSE_LEVEL;
+        if (trig.slope && abs(x - c.prev) > trig.slope) fired |= CAUSE_SLOPE;
+        c.prev = x;
+
+        if (trig.cycle_pct && trig.cycle_len) {
+            c.cycle_sq += (int64_t)ac * ac;
+            if (++c.cycle_n >= trig.cycle_len) {
+                float rms = sqrtf((float)c.cycle_sq / c.cycle_n);
+                bool deviates = c.ref_cycles >= kWarmupCycles &&
+                                fabsf(rms - c.ref_rms) * 100.0f > trig.cycle_pct * c.ref_rms;
+                if (deviates) {
+                    fired |= CAUSE_CYCLE;
+                } else {
+                    // The reference only follows normal cycles
+                    c.ref_rms = c.ref_cycles ? c.ref_rms + (rms - c.ref_rms) / kRefWeight : rms;
+                    if (c.ref_cycles < kWarmupCycles) c.ref_cycles++;
+                }
+                c.cycle_sq = 0;
+                c.cycle_n = 0;
+            }
+        }
+
+        if (state == FROZEN && !__atomic_load_n(&frozen, __ATOMIC_ACQUIRE)) {
+            state = ARMED; // The consumer took the event
+        }
+
+        if (state == ARMED) {
+            if (fired && c.filled >= pre) {
+                state = POST;
+                trig_ch = ch;
+                cause = fired;
+                trig_ms = now_ms;
+                remaining = len - pre;
+            }
+        } else if (state == POST && ch == trig_ch) {
+            if (--remaining == 0) freeze();
+        }
+    }
+
+    /// Consumer only: true when an event is waiting to be taken.
+    bool ready() const { return __atomic_load_n(&frozen, __ATOMIC_ACQUIRE); }
+
+    /// Consumer only: copies the waiting event (up to @p max registers) and re-arms.
+    /// Returns the number of registers copied, 0 if there was no event.
+    uint16_t take(uint16_t* regs, uint16_t max) {
+        if (!ready()) return 0;
+        uint16_t count = regsFor(num_channels, pre, len - pre);
+        if (count > max) count = max;
+        memcpy(regs, event, count * sizeof(uint16_t));
+        __atomic_store_n(&frozen, false, __ATOMIC_RELEASE);
+        return count;
+    }
+
+private:
+    enum State : uint8_t { ARMED, POST, FROZEN };
+
+    static const int kDcShift = 10;      // DC time constant: 1024 samples
+    static const uint8_t kWarmupCycles = 8;
+    static const int kRefWeight = 16;
+
+    struct Channel {
+        int16_t* ring;
+        uint16_t head;
+        uint16_t filled;
+        bool started;
+        int16_t prev;
+        int32_t dc_q8;
+        int64_t cycle_sq;
+        uint16_t cycle_n;
+        float ref_rms;
+        uint8_t ref_cycles;
+    };
+
+    Channel* chans;
+    uint16_t* event;
+    uint8_t num_channels;
+    uint16_t pre;
+    uint16_t len;
+    Trigger trig;
+
+    State state;
+    uint8_t trig_ch;
+    uint8_t cause;
+    uint16_t remaining;
+    uint32_t trig_ms;
+    uint32_t event_seq;
+    bool frozen;
+
+    static void resetChannel(Channel& c) {
+        c.head = 0;
+        c.filled = 0;
+        c.started = false;
+        c.prev = 0;
+        c.dc_q8 = 0;
+        c.cycle_sq = 0;
+        c.cycle_n = 0;
+        c.ref_rms = 0.0f;
+        c.ref_cycles = 0;
+    }
+
+    void freeze() {
+        event_seq++;
+        event[0] = event_seq >> 16;
+        event[1] = event_seq & 0xFFFF;
+        event[2] = trig_ms >> 16;
+        event[3] = trig_ms & 0xFFFF;
+        event[4] = ((uint16_t)cause << 8) | trig_ch;
+        event[5] = num_channels;
+        event[6] = len;
+        event[7] = pre;
+
+        for (uint8_t ch = 0; ch < num_channels; ch++) {
+            const Channel& c = chans[ch];
+            uint16_t* out = event + kHeaderRegs + ch * len;
+            uint16_t missing = len - c.filled; // Channel without enough history: leading zeros
+            memset(out, 0, missing * sizeof(uint16_t));
+            uint16_t idx = (c.head + missing) % len;
+            for (uint16_t i = missing; i < len; i++) {
+                out[i] = (uint16_t)c.ring[idx];
+                idx = (idx + 1 == len) ? 0 : idx + 1;
+            }
+        }
+
+        state = FROZEN;
+        __atomic_store_n(&frozen, true, __ATOMIC_RELEASE);
+    }
+
+    void release() {
+        if (chans) {
+            for (uint8_t ch = 0; ch < num_channels; ch++) delete[] chans[ch].ring;
+            delete[] chans;
+            chans = nullptr;
+        }
+        delete[] event;
+        event = nullptr;
+    }
+
+    TransientCapture(const TransientCapture&);
+    TransientCapture& operator=(const TransientCapture&);
+};
+
+#endif
@@ -0,0 +1,218 @@
+#include "ADS1x15Idf.h"
+
+namespace {
+constexpr uint8_t REG_CONVERSION = 0x00;
+constexpr uint8_t REG_CONFIG     = 0x01;
+constexpr uint8_t REG_LO_THRESH  = 0x02;
+constexpr uint8_t REG_HI_THRESH  = 0x03;
+
+constexpr uint16_t CFG_OS_SINGLE   = 0x8000;
+constexpr uint16_t CFG_MODE_SINGLE = 0x0100;
+constexpr uint16_t CFG_MODE_CONTIN = 0x0000;
+constexpr uint16_t CFG_CQUE_NONE   = 0x0003; // Comparador deshabilitado
+constexpr uint16_t CFG_CQUE_1CONV  = 0x0000; // ALERT/RDY tras cada conversión
+
+// Tamaño de buffer para links estáticos (sin malloc en el camino caliente)
+constexpr size_t LINK_BUF_SIZE = I2C_LINK_RECOMMENDED_SIZE(3);
+}
+
+i2c_port_t ADS1x15Idf::s_port = I2C_NUM_0;
+const TickType_t ADS1x15Idf::kTimeout = pdMS_TO_TICKS(10);
+
+bool ADS1x15Idf::installBus(i2c_port_t port, int sda, int scl, uint32_t clock_hz) {
+    i2c_config_t conf = {};
+    conf.mode = I2C_MODE_MASTER;
+    conf.sda_io_num = sda;
+    conf.scl_io_num = scl;
+    conf.sda_pullup_en = GPIO_PULLUP_ENABLE;
+    conf.scl_pullup_en = GPIO_PULLUP_ENABLE;
+    conf.master.clk_speed = clock_hz;
+
+    if (i2c_param_config(port, &conf) != ESP_OK) return false;
+    if (i2c_driver_install(port, I2C_MODE_MASTER, 0, 0, 0) != ESP_OK) return false;
+    s_port = port;
+    return true;
+}
+
+bool ADS1x15Idf::probe(uint8_t addr) {
+    uint8_t buf[LINK_BUF_SIZE];
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create_static(buf, sizeof(buf));
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, (addr << 1) | I2C_MASTER_WRITE, true);
+    i2c_master_stop(cmd);
+    esp_err_t err = i2c_master_cmd_begin(s_port, cmd, kTimeout);
+    i2c_cmd_link_delete_static(cmd);
+    return err == ESP_OK;
+}
+
+bool ADS1x15Idf::begin(uint8_t i2c_addr, void* unused_wire) {
+    (void)unused_wire;
+    m_addr = i2c_addr;
+    uint16_t cfg;
+    // El chip responde y el registro de configuración es legible
+    return readRegister(REG_CONFIG, cfg);
+}
+
+uint16_t ADS1x15Idf::configWord(uint16_t mux, bool continuous) const {
+    uint16_t cfg = CFG_OS_SINGLE | mux | (uint16_t)m_gain | m_dataRate;
+    cfg |= continuous ? CFG_MODE_CONTIN : CFG_MODE_SINGLE;
+    cfg |= m_rdyEnabled ? CFG_CQUE_1CONV : CFG_CQUE_NONE;
+    return cfg;
+}
+
+int16_t ADS1x15Idf::toSigned(uint16_t raw) const {
+    if (m_bitShift == 0) {
+        return (int16_t)raw;
+    }
+    // ADS1015: 12 bits alineados a la izquierda, desplazamiento aritmético
+    return (int16_t)raw >> m_bitShift;
+}
+
+// Escribe un registro; opcionalmente deja el puntero en CONVERSION en el mismo link
+bool ADS1x15Idf::writeRegister(uint8_t reg, uint16_t value, bool leave_on_conversion) {
+    uint8_t buf[LINK_BUF_SIZE];
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create_static(buf, sizeof(buf));
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, (m_addr << 1) | I2C_MASTER_WRITE, true);
+    i2c_master_write_byte(cmd, reg, true);
+    i2c_master_write_byte(cmd, value >> 8, true);
+    i2c_master_write_byte(cmd, value & 0xFF, true);
+    if (leave_on_conversion) {
+        i2c_master_start(cmd);
+        i2c_master_write_byte(cmd, (m_addr << 1) | I2C_MASTER_WRITE, true);
+        i2c_master_write_byte(cmd, REG_CONVERSION, true);
+    }
+    i2c_master_stop(cmd);
+    esp_err_t err = i2c_master_cmd_begin(s_port, cmd, kTimeout);
+    i2c_cmd_link_delete_static(cmd);
+    return err == ESP_OK;
+}
+
+// Lectura con puntero explícito (escritura de puntero + repeated start + 2 bytes)
+bool ADS1x15Idf::readRegister(uint8_t reg, uint16_t& value) {
+    uint8_t data[2] = {0, 0};
+    uint8_t buf[LINK_BUF_SIZE];
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create_static(buf, sizeof(buf));
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, (m_addr << 1) | I2C_MASTER_WRITE, true);
+    i2c_master_write_byte(cmd, reg, true);
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, (m_addr << 1) | I2C_MASTER_READ, true);
+    i2c_master_read(cmd, data, 2, I2C_MASTER_LAST_NACK);
+    i2c_master_stop(cmd);
+    esp_err_t err = i2c_master_cmd_begin(s_port, cmd, kTimeout);
+    i2c_cmd_link_delete_static(cmd);
+    value = ((uint16_t)data[0] << 8) | data[1];
+    return err == ESP_OK;
+}
+
+void ADS1x15Idf::startADCReading(uint16_t mux, bool continuous) {
+    writeRegister(REG_CONFIG, configWord(mux, continuous), true);
+}
+
+bool ADS1x15Idf::conversionComplete() {
+    uint16_t cfg = 0;
+    if (!readRegister(REG_CONFIG, cfg)) return false;
+    // El siguiente getLastConversionResults() debe leer CONVERSION
+    uint16_t dummy;
+    readRegister(REG_CONVERSION, dummy);
+    return (cfg & CFG_OS_SINGLE) != 0;
+}
+
+int16_t ADS1x15Idf::getLastConversionResults() {
+    // El puntero ya apunta a CONVERSION: solo dirección + 2 bytes
+    uint8_t data[2] = {0, 0};
+    uint8_t buf[LINK_BUF_SIZE];
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create_static(buf, sizeof(buf));
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, (m_addr << 1) | I2C_MASTER_READ, true);
+    i2c_master_read(cmd, data, 2, I2C_MASTER_LAST_NACK);
+    i2c_master_stop(cmd);
+    i2c_master_cmd_begin(s_port, cmd, kTimeout);
+    i2c_cmd_link_delete_static(cmd);
+    return toSigned(((uint16_t)data[0] << 8) | data[1]);
+}
+
+bool ADS1x15Idf::readAndStart(uint16_t next_mux, int16_t& result) {
+    uint16_t cfg = configWord(next_mux, false);
+    uint8_t data[2] = {0, 0};
+    uint8_t buf[LINK_BUF_SIZE];
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create_static(buf, sizeof(buf));
+
+    // 1) Resultado listo (puntero en CONVERSION)
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, (m_addr << 1) | I2C_MASTER_READ, true);
+    i2c_master_read(cmd, data, 2, I2C_MASTER_LAST_NACK);
+    // 2) Arranque de la siguiente conversión
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, (m_addr << 1) | I2C_MASTER_WRITE, true);
+    i2c_master_write_byte(cmd, REG_CONFIG, true);
+    i2c_master_write_byte(cmd, cfg >> 8, true);
+    i2c_master_write_byte(cmd, cfg & 0xFF, true);
+    // 3) Puntero de vuelta a CONVERSION para la próxima lectura
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, (m_addr << 1) | I2C_MASTER_WRITE, true);
+    i2c_master_write_byte(cmd, REG_CONVERSION, true);
+    i2c_master_stop(cmd);
+
+    esp_err_t err = i2c_master_cmd_begin(s_port, cmd, kTimeout);
+    i2c_cmd_link_delete_static(cmd);
+    result = toSigned(((uint16_t)data[0] << 8) | data[1]);
+    return err == ESP_OK;
+}
+
+int16_t ADS1x15Idf::readADC_SingleEnded(uint8_t channel) {
+    static const uint16_t muxes[4] = {
+        ADS1X15_REG_CONFIG_MUX_SINGLE_0, ADS1X15_REG_CONFIG_MUX_SINGLE_1,
+        ADS1X15_REG_CONFIG_MUX_SINGLE_2, ADS1X15_REG_CONFIG_MUX_SINGLE_3};
+    if (channel > 3) return 0;
+    return readBlocking(muxes[channel]);
+}
+
+int16_t ADS1x15Idf::readBlocking(uint16_t mux) {
+    startADCReading(mux, false);
+    uint16_t cfg = 0;
+    // Sondeo del bit OS; a 8 SPS una conversión tarda 125 ms
+    for (int i = 0; i < 200; i++) {
+        if (readRegister(REG_CONFIG, cfg) && (cfg & CFG_OS_SINGLE)) break;
+        vTaskDelay(1);
+    }
+    uint16_t raw = 0;
+    readRegister(REG_CONVERSION, raw);
+    return toSigned(raw);
+}
+
+float ADS1x15Idf::computeVolts(int16_t counts) {
+    float fsRange;
+    switch (m_gain) {
+        case GAIN_TWOTHIRDS: fsRange = 6.144f; break;
+        case GAIN_ONE:       fsRange = 4.096f; break;
+        case GAIN_TWO:       fsRange = 2.048f; break;
+        case GAIN_FOUR:      fsRange = 1.024f; break;
+        case GAIN_EIGHT:     fsRange = 0.512f; break;
+        case GAIN_SIXTEEN:   fsRange = 0.256f; break;
+        default:             fsRange = 0.0f;
+    }
+    return counts * (fsRange / (32768 >> m_bitShift));
+}
+
+bool ADS1x15Idf::enableReadyPin(int gpio, TaskHandle_t task) {
+    // Hi_thresh MSB = 1 y Lo_thresh MSB = 0 convierten ALERT en RDY
+    if (!writeRegister(REG_HI_THRESH, 0x8000, false)) return false;
+    if (!writeRegister(REG_LO_THRESH, 0x0000, false)) return false;
+
+    m_rdyTask = task;
+    m_rdyEnabled = true;
+    pinMode(gpio, INPUT_PULLUP);
+    attachInterruptArg(digitalPinToInterrupt(gpio), rdyIsr, this, FALLING);
+    return true;
+}
+
+void IRAM_ATTR ADS1x15Idf::rdyIsr(void* arg) {
+    ADS1x15Idf* self = static_cast<ADS1x15Idf*>(arg);
+    BaseType_t woken = pdFALSE;
+    if (self->m_rdyTask != nullptr) {
+        vTaskNotifyGiveFromISR(self->m_rdyTask, &woken);
+    }
+    if (woken) portYIELD_FROM_ISR();
+}
@@ -6,7 +6,10 @@ ADSManager::ADSManager(const ADSConfig& cfg)
     : ADSBase({cfg.type, cfg.i2c_addr, cfg.gain, cfg.process_interval_ms}),
       config(cfg),  // Guardar config completo
       data_ready(false), 
-      current_channel(0) {
+      current_channel(0),
+      pending_fifo_size(cfg.fifo_size),
+      effective_sps(cfg.samples_per_second),
+      config_pending(false) {
     
     // Crear FIFOs (sin cambios)
     fifos = new RMS_FIFO[config.num_channels];
@@ -19,27 +22,36 @@ ADSManager::ADSManager(const ADSConfig& cfg)
     }
     
     // Crear historiales
-    rms_histories = new float*[config.num_channels];
+    rms_histories = new HistoryRing<float>[config.num_channels];
     for (int i = 0; i < config.num_channels; i++) {
-        rms_histories[i] = new float[config.history_size]();
+        rms_histories[i].init(config.history_size);
+    }
+    
+    // Factores propios: setConfig los puede cambiar sin tocar la tabla global
+    factors = new float[config.num_channels];
+    pending_factors = new float[config.num_channels];
+    for (int i = 0; i < config.num_channels; i++) {
+        factors[i] = config.conversion_factors[i];
+        pending_factors[i] = factors[i];
     }
-    rms_history_head = 0;
     
     sample_queue = xQueueCreate(config.fifo_size, sizeof(ADCSample));
-    rms_mutex = xSemaphoreCreateMutex();
+
+    capture.init(config.num_channels, TRANSIENT_PRE_SAMPLES, TRANSIENT_POST_SAMPLES);
+    applyTrigger(TRANSIENT_LEVEL, TRANSIENT_SLOPE, TRANSIENT_CYCLE_PCT, 0);
 }
 
 // ===== DESTRUCTOR =====
 ADSManager::~ADSManager() {
     for (int i = 0; i < config.num_channels; i++) {
         delete[] fifos[i].buffer;
-        delete[] rms_histories[i];
     }
     delete[] fifos;
     delete[] rms_histories;
+    delete[] factors;
+    delete[] pending_factors;
     
     vQueueDelete(sample_queue);
-    vSemaphoreDelete(rms_mutex);
 }
 
 // ===== ISR =====
@@ -59,14 +71,12 @@ bool ADSManager::begin() {
     
     Serial.println("ADSManager: ADS inicializado correctamente");
     
-    // Configurar velocidad de muestreo según el tipo de ADS
-    if (config.type == ADSType::ADS1015) {
-        ads->setDataRate(RATE_ADS1015_3300SPS);
-        Serial.println("ADSManager: Configurado para ADS1015 @ 3300 SPS");
-    } else {
-        ads->setDataRate(RATE_ADS1115_860SPS);
-        Serial.println("ADSManager: Configurado para ADS1115 @ 860 SPS");
-    }
+    // Configurar velocidad de muestreo (samples_per_second, ajustable por Modbus)
+    effective_sps = applyDataRate(config.samples_per_second);
+    applyTrigger(pending_trigger.level, pending_trigger.slope,
+                 pending_trigger.cycle_pct, cycle_len_cfg); // Ciclo automático con los SPS reales
+    Serial.printf("ADSManager: Configurado para %s @ %u SPS\n",
+                  config.type == ADSType::ADS1015 ? "ADS1015" : "ADS1115", effective_sps);
     
     // NOTA: No usamos interrupción ALERT, usamos polling para mayor confiabilidad
     // Si en el futuro quieres habilitar ALERT, descomenta esta sección:
@@ -93,14 +103,59 @@ void ADSManager::acquisition_task_trampoline(void* arg) {
 }
 
 void ADSManager::acquisition_task_body() {
-    ads->startADCReading(ADS1X15_REG_CONFIG_MUX_SINGLE_0, false);
+    // Tabla MUX precalculada por ADSSequencer: el bucle solo indexa
+    const uint16_t* mux_table = config.channels.mux;
+    const uint8_t num_channels = config.channels.count;
+
+#if ADS_BACKEND_IDF
+    // ALERT/RDY como fin de conversión: la ISR notifica a esta tarea
+    bool rdy_irq = false;
+    if (config.alert_pin != -1) {
+        I2CBus::Guard bus;
+        rdy_irq = ads->enableReadyPin(config.alert_pin, xTaskGetCurrentTaskHandle());
+        Serial.printf("ADSManager: RDY %s en pin %d\n", rdy_irq ? "activo" : "FALLÓ", config.alert_pin);
+    }
+#endif
+    {
+        I2CBus::Guard bus;
+        ads->startADCReading(mux_table[0], false);
+    }
     
     // Contadores para medir SPS por canal
     uint32_t samples_count[4] = {0, 0, 0, 0};
     TickType_t last_debug_time = xTaskGetTickCount();
     
     while (true) {
-        // POLLING: Verificamos si la conversión está lista leyendo el registro de configuración
+#if ADS_BACKEND_IDF
+        // Espera asíncrona: el bus queda libre para otros chips mientras este convierte
+        if (rdy_irq) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(5));
+        } else {
+            // Sin RDY se espera el tiempo nominal de conversión (+10%); el SPS puede cambiar en caliente
+            delayMicroseconds((uint32_t)(1100000UL / effective_sps));
+        }
+
+        uint8_t next_channel = current_channel + 1;
+        if (next_channel == num_channels) next_channel = 0;
+        ADCSample sample;
+        bool ok;
+        {
+            // Lectura del resultado + arranque del siguiente canal en un solo command link
+            I2CBus::Guard bus;
+            ok = ads->readAndStart(mux_table[next_channel], sample.value);
+        }
+        if (ok) {
+            sample.channel = current_channel;
+            if (current_channel < 4) {
+                samples_count[current_channel]++;
+            }
+            xQueueSend(sample_queue, &sample, 0);
+        }
+        current_channel = next_channel;
+#else
+        // POLLING: Verificamos si la conversión está lista leyendo el registro de configuración.
+        // Poll + lectura + siguiente arranque van en una sola toma del bus.
+        I2CBus::lock();
         if (ads->conversionComplete()) {
             ADCSample sample;
             sample.value = ads->getLastConversionResults();
@@ -112,18 +167,14 @@ void ADSManager::acquisition_task_body() {
              
             xQueueSend(sample_queue, &sample, 0);
             
-            current_channel = (current_channel + 1) % config.num_channels;
+            uint8_t next_channel = current_channel + 1;
+            if (next_channel == num_channels) next_channel = 0;
+            current_channel = next_channel;
             
-            uint16_t mux_config;
-            switch(current_channel) {
-                case 0: mux_config = ADS1X15_REG_CONFIG_MUX_SINGLE_0; break;
-                case 1: mux_config = ADS1X15_REG_CONFIG_MUX_SINGLE_1; break;
-                case 2: mux_config = ADS1X15_REG_CONFIG_MUX_SINGLE_2; break;
-                case 3: mux_config = ADS1X15_REG_CONFIG_MUX_SINGLE_3; break;
-                default: mux_config = ADS1X15_REG_CONFIG_MUX_SINGLE_0; break;
-            }
-            ads->startADCReading(mux_config, false);
+            ads->startADCReading(mux_table[current_channel], false);
         }
+        I2CBus::unlock();
+#endif
         
         // Debug cada segundo
         TickType_t current_time = xTaskGetTickCount();
@@ -137,8 +188,10 @@ void ADSManager::acquisition_task_body() {
             last_debug_time = current_time;
         }
         
+#if !ADS_BACKEND_IDF
         // Pequeño delay de 50 microsegundos en lugar de 1 tick (1ms) para alcanzar máxima velocidad
         delayMicroseconds(50);
+#endif
         taskYIELD(); // Permite que otras tareas de igual prioridad se ejecuten
     }
 }
@@ -152,8 +205,27 @@ void ADSManager::processing_task_body() {
     TickType_t last_process_time = xTaskGetTickCount();
     
     while (true) {
+        // Cambio de tamaño pedido por setConfig: esta tarea es la dueña de las FIFOs
+        if (pending_fifo_size != config.fifo_size) {
+            resizeFifos(pending_fifo_size);
+        }
+        // Factores y disparo nuevos: se copian juntos para no mezclar valores viejos y nuevos
+        if (config_pending) {
+            portENTER_CRITICAL(&config_mux);
+            for (int ch = 0; ch < config.num_channels; ch++) {
+                factors[ch] = pending_factors[ch];
+            }
+            TransientCapture::Trigger t = pending_trigger;
+            config_pending = false;
+            portEXIT_CRITICAL(&config_mux);
+            capture.setTrigger(t);
+        }
+
+        uint32_t now = millis();
         while (xQueueReceive(sample_queue, &sample, 0) == pdTRUE) {
             if (sample.channel < config.num_channels) {
+                capture.add(sample.channel, sample.value, now);
+
                 RMS_FIFO& fifo = fifos[sample.channel];
                 
                 if (fifo.count == config.fifo_size) {
@@ -174,18 +246,15 @@ void ADSManager::processing_task_body() {
         if (xTaskGetTickCount() - last_process_time >= pdMS_TO_TICKS(config.process_interval_ms)) {
             last_process_time = xTaskGetTickCount();
             
-            if (xSemaphoreTake(rms_mutex, portMAX_DELAY) == pdTRUE) {
-                for (int ch = 0; ch < config.num_channels; ch++) {
-                    if (fifos[ch].count > 0) {
-                        double mean = (double)fifos[ch].sum_x / fifos[ch].count;
-                        double var = ((double)fifos[ch].sum_x2 / fifos[ch].count) - (mean * mean);
-                        float rms = sqrt(var < 0 ? 0 : var);
-                        
-                        rms_histories[ch][rms_history_head] = rms * config.conversion_factors[ch];
-                    }
+            // El historial es un seqlock: los lectores nunca bloquean esta tarea
+            for (int ch = 0; ch < config.num_channels; ch++) {
+                float rms = 0.0f;
+                if (fifos[ch].count > 0) {
+                    double mean = (double)fifos[ch].sum_x / fifos[ch].count;
+                    double var = ((double)fifos[ch].sum_x2 / fifos[ch].count) - (mean * mean);
+                    rms = sqrt(var < 0 ? 0 : var);
                 }
-                rms_history_head = (rms_history_head + 1) % config.history_size;
-                xSemaphoreGive(rms_mutex);
+                rms_histories[ch].push(rms * factors[ch]);
             }
         }
         
@@ -194,22 +263,25 @@ void ADSManager::processing_task_body() {
 }
 
 int ADSManager::getHistory(int channel, float* output_buffer, int count) {
-    if (channel < 0 || channel >= config.num_channels || count > config.history_size) {
+    if (channel < 0 || channel >= config.num_channels) {
         return 0;
     }
-    
-    if (xSemaphoreTake(rms_mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-        int most_recent = (rms_history_head == 0) ? (config.history_size - 1) : (rms_history_head - 1);
-        
-        for (int i = 0; i < count; i++) {
-            int idx = (most_recent - (count - 1 - i) + config.history_size) % config.history_size;
-            output_buffer[i] = rms_histories[channel][idx];
-        }
-        
-        xSemaphoreGive(rms_mutex);
-        return count;
+    return rms_histories[channel].latest(output_buffer, count);
+}
+
+uint32_t ADSManager::getSequence(int channel) {
+    if (channel < 0 || channel >= config.num_channels) {
+        return 0;
     }
-    return 0;
+    return rms_histories[channel].sequence();
+}
+
+int ADSManager::getHistorySince(int channel, uint32_t after_seq, float* output_buffer, int max,
+                                uint32_t* first_seq) {
+    if (channel < 0 || channel >= config.num_channels) {
+        return 0;
+    }
+    return rms_histories[channel].since(after_seq, output_buffer, max, first_seq);
 }
 
 float ADSManager::getLatest(int channel) {
@@ -222,4 +294,77 @@ void ADSManager::getRMSAllChannels(float* output_array) {
     for (int ch = 0; ch < config.num_channels; ch++) {
         output_array[ch] = getLatest(ch);
     }
-}
\ No newline at end of file
+}
+
+// Recrea las FIFOs con el nuevo tamaño (solo desde la tarea de procesamiento).
+// La cola de muestras conserva su profundidad original.
+void ADSManager::resizeFifos(int size) {
+    for (int i = 0; i < config.num_channels; i++) {
+        delete[] fifos[i].buffer;
+        fifos[i].buffer = new int16_t[size];
+        fifos[i].head = 0;
+        fifos[i].count = 0;
+        fifos[i].sum_x = 0;
+        fifos[i].sum_x2 = 0;
+    }
+    config.fifo_size = size;
+    Serial.printf("ADSManager: FIFOs recreadas con %d muestras\n", size);
+}
+
+void ADSManager::getConfig(uint16_t* regs) {
+    memset(regs, 0, ADS_CONFIG_REGS * sizeof(uint16_t));
+    regs[0] = config.process_interval_ms;
+    regs[1] = config.samples_per_second;
+    regs[2] = pending_fifo_size;
+    portENTER_CRITICAL(&config_mux);
+    for (int ch = 0; ch < config.num_channels && 3 + ch < 8; ch++) {
+        regs[3 + ch] = (uint16_t)lroundf(pending_factors[ch] * 10000.0f);
+    }
+    TransientCapture::Trigger t = pending_trigger;
+    portEXIT_CRITICAL(&config_mux);
+    regs[8] = t.level;
+    regs[9] = t.slope;
+    regs[10] = t.cycle_pct;
+    regs[11] = cycle_len_cfg;
+}
+
+bool ADSManager::setConfig(const uint16_t* regs) {
+    if (!validBaseConfig(regs) || regs[2] < 16 || regs[2] > 4000) {
+        return false;
+    }
+    for (int ch = 0; ch < config.num_channels && 3 + ch < 8; ch++) {
+        if (regs[3 + ch] == 0) return false;
+    }
+    if (regs[10] > 1000 || regs[11] > 2000) {
+        return false;
+    }
+
+    config.process_interval_ms = regs[0];
+    config.samples_per_second = regs[1];
+    effective_sps = applyDataRate(regs[1]); // Solo cambia el config que se escribe en la próxima conversión
+    portENTER_CRITICAL(&config_mux);
+    for (int ch = 0; ch < config.num_channels && 3 + ch < 8; ch++) {
+        pending_factors[ch] = regs[3 + ch] / 10000.0f;
+    }
+    portEXIT_CRITICAL(&config_mux);
+    pending_fifo_size = regs[2];
+    applyTrigger(regs[8], regs[9], regs[10], regs[11]);
+    return true;
+}
+
+// Ajusta el disparo de transitorios; sin longitud de ciclo se usa un ciclo de red
+// a los SPS efectivos repartidos entre canales. Lo aplica la tarea de procesamiento.
+void ADSManager::applyTrigger(uint16_t level, uint16_t slope, uint16_t cycle_pct, uint16_t cycle_len) {
+    cycle_len_cfg = cycle_len;
+    if (cycle_len == 0) {
+        cycle_len = effective_sps / (config.num_channels * TRANSIENT_MAINS_HZ);
+    }
+    portENTER_CRITICAL(&config_mux);
+    pending_trigger = TransientCapture::Trigger{level, slope, cycle_pct, cycle_len};
+    config_pending = true;
+    portEXIT_CRITICAL(&config_mux);
+}
+
+uint16_t ADSManager::takeTransient(uint16_t* regs, uint16_t max) {
+    return capture.take(regs, max);
+}
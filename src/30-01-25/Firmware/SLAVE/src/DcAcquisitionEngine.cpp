@@ -0,0 +1,125 @@
+#include "DcAcquisitionEngine.h"
+#include <esp_timer.h>
+
+// Espera hasta el instante t_us (esp_timer) cediendo la CPU mientras falte
+// más de un tick y terminando con una espera fina en microsegundos.
+static void waitUntilUs(int64_t t_us) {
+    const int64_t tick_us = 1000LL * portTICK_PERIOD_MS;
+    int64_t remaining = t_us - esp_timer_get_time();
+    while (remaining > 2 * tick_us) {
+        vTaskDelay(1);
+        remaining = t_us - esp_timer_get_time();
+    }
+    if (remaining > 0) {
+        delayMicroseconds((uint32_t)remaining);
+    }
+}
+
+DcAcquisitionEngine& DcAcquisitionEngine::instance() {
+    static DcAcquisitionEngine engine;
+    return engine;
+}
+
+DcAcquisitionEngine::DcAcquisitionEngine() {}
+
+int DcAcquisitionEngine::addChannel(ADSDevice* ads, uint16_t mux, uint16_t data_rate_sps,
+                                    uint8_t decimation, float volts_per_bit) {
+    if (num_slots >= DC_ENGINE_MAX_CANALES || ads == nullptr || data_rate_sps == 0) {
+        return -1;
+    }
+
+    Slot& s = slots[num_slots];
+    s.ads = ads;
+    s.mux = mux;
+    // El oscilador interno del ADS tiene ±10%: leer un 10% más lento evita
+    // tomar dos veces la misma conversión.
+    s.period_us = (uint32_t)(1100000UL / data_rate_sps);
+    s.decimation = (decimation == 0) ? 1 : decimation;
+    s.volts_per_bit = volts_per_bit;
+    s.volts = 0.0f;
+    s.seq = 0;
+    return num_slots++;
+}
+
+bool DcAcquisitionEngine::setTiming(int slot, uint16_t data_rate_sps, uint8_t decimation) {
+    if (slot < 0 || slot >= num_slots || data_rate_sps == 0) {
+        return false;
+    }
+    portENTER_CRITICAL(&slot_mux);
+    slots[slot].period_us = (uint32_t)(1100000UL / data_rate_sps);
+    slots[slot].decimation = (decimation == 0) ? 1 : decimation;
+    portEXIT_CRITICAL(&slot_mux);
+    return true;
+}
+
+void DcAcquisitionEngine::start() {
+    if (task_handle != nullptr || num_slots == 0) {
+        return;
+    }
+    xTaskCreatePinnedToCore(task_trampoline, "DC_Engine", 3072, this, 2, &task_handle, 1);
+}
+
+bool DcAcquisitionEngine::read(int slot, float& volts, uint32_t* seq) {
+    if (slot < 0 || slot >= num_slots) {
+        return false;
+    }
+    portENTER_CRITICAL(&slot_mux);
+    volts = slots[slot].volts;
+    uint32_t s = slots[slot].seq;
+    portEXIT_CRITICAL(&slot_mux);
+
+    if (seq != nullptr) {
+        *seq = s;
+    }
+    return s != 0;
+}
+
+void DcAcquisitionEngine::task_trampoline(void* arg) {
+    static_cast<DcAcquisitionEngine*>(arg)->task_body();
+}
+
+// Adquiere un valor decimado del slot en modo continuo
+float DcAcquisitionEngine::acquire(Slot& s) {
+    // Copia de la temporización: setTiming puede cambiarla desde otra tarea
+    portENTER_CRITICAL(&slot_mux);
+    const uint32_t period_us = s.period_us;
+    const uint8_t decimation = s.decimation;
+    portEXIT_CRITICAL(&slot_mux);
+
+    // Escribir la configuración reinicia la conversión con el nuevo MUX;
+    // el filtro sinc del ADS1x15 asienta en un solo ciclo.
+    // El bus solo se toma durante cada transacción: mientras el chip
+    // convierte, el resto de sensores del esclavo puede usar el I2C.
+    {
+        I2CBus::Guard bus;
+        s.ads->startADCReading(s.mux, /*continuous=*/true);
+    }
+
+    int64_t next_us = esp_timer_get_time() + period_us;
+    int32_t acc = 0;
+    for (uint8_t i = 0; i < decimation; i++) {
+        waitUntilUs(next_us);
+        {
+            I2CBus::Guard bus;
+            acc += s.ads->getLastConversionResults();
+        }
+        next_us += period_us;
+    }
+    return ((float)acc / decimation) * s.volts_per_bit;
+}
+
+void DcAcquisitionEngine::task_body() {
+    while (true) {
+        for (int i = 0; i < num_slots; i++) {
+            float volts = acquire(slots[i]);
+
+            portENTER_CRITICAL(&slot_mux);
+            slots[i].volts = volts;
+            slots[i].seq++;
+            if (slots[i].seq == 0) slots[i].seq = 1; // 0 reservado para "sin datos"
+            portEXIT_CRITICAL(&slot_mux);
+        }
+        // Ceder la CPU entre barridos completos
+        vTaskDelay(1);
+    }
+}
@@ -2,22 +2,14 @@
 #include <math.h>
 
 // 1. CONSTRUCTOR
-PressADSManager::PressADSManager(const ADSconfig& cfg)
+PressADSManager::PressADSManager(const PressADSConfig& cfg)
     : ADSBase(cfg), config(cfg) {
     
-    data_mutex = xSemaphoreCreateMutex();
-
     // Inicializar buffers solo para canales activos (según máscara de bits)
     for (int i = 0; i < 4; i++) {
-        // Verificar si el bit 'i' está en 1
         if ((config.active_channels >> i) & 0x01) {
-            if (config.history_size > 0) {
-                pressure_histories[i] = new float[config.history_size](); // Init a 0
-            }
-        } else {
-            pressure_histories[i] = nullptr;
+            pressure_histories[i].init(config.history_size); // Init a 0
         }
-        history_heads[i] = 0;
     }
 }
 
@@ -26,18 +18,6 @@ PressADSManager::~PressADSManager() {
     if (press_task_handle != nullptr) {
         vTaskDelete(press_task_handle);
     }
-
-    // Liberar memoria de historiales
-    for (int i = 0; i < 4; i++) {
-        if (pressure_histories[i] != nullptr) {
-            delete[] pressure_histories[i];
-            pressure_histories[i] = nullptr;
-        }
-    }
-
-    if (data_mutex != nullptr) {
-        vSemaphoreDelete(data_mutex);
-    }
 }
 
 // 3. BEGIN
@@ -48,25 +28,20 @@ bool PressADSManager::begin() {
     }
 
     // Configurar Data Rate (similar a TempADSManager, lectura DC)
-    if (config.type == ADSType::ADS1115) {
-        switch(config.sampling_rate) {
-            case 8:    ads->setDataRate(RATE_ADS1115_8SPS); break;
-            case 16:   ads->setDataRate(RATE_ADS1115_16SPS); break;
-            case 32:   ads->setDataRate(RATE_ADS1115_32SPS); break;
-            case 64:   ads->setDataRate(RATE_ADS1115_64SPS); break;
-            case 128:  ads->setDataRate(RATE_ADS1115_128SPS); break;
-            case 250:  ads->setDataRate(RATE_ADS1115_250SPS); break;
-            case 475:  ads->setDataRate(RATE_ADS1115_475SPS); break;
-            case 860:  ads->setDataRate(RATE_ADS1115_860SPS); break;
-            default:   ads->setDataRate(RATE_ADS1115_128SPS); break;
-        }
-    } else {
-        // ADS1015
-        switch(config.sampling_rate) {
-            case 128:  ads->setDataRate(RATE_ADS1015_128SPS); break;
-            case 250:  ads->setDataRate(RATE_ADS1015_250SPS); break;
-            case 1600: ads->setDataRate(RATE_ADS1015_1600SPS); break;
-            default:   ads->setDataRate(RATE_ADS1015_1600SPS); break;
+    uint16_t effective_sps = applyDataRate(config.sampling_rate);
+
+    // Registrar los canales activos en el motor DC compartido
+    typedef ADSMuxTable<ADSCh::AIN0, ADSCh::AIN1, ADSCh::AIN2, ADSCh::AIN3> PressMux;
+    DcAcquisitionEngine& engine = DcAcquisitionEngine::instance();
+    float vpb = getVoltsPerBit(base_config.gain, base_config.type);
+    for (int ch = 0; ch < 4; ch++) {
+        if ((config.active_channels >> ch) & 0x01) {
+            engine_slots[ch] = engine.addChannel(ads, PressMux::mux[ch], effective_sps,
+                                                 config.NUM_SAMPLES, vpb);
+            if (engine_slots[ch] < 0) {
+                Serial.println("PressADSManager: sin slots libres en DcAcquisitionEngine");
+                return false;
+            }
         }
     }
 
@@ -75,6 +50,8 @@ bool PressADSManager::begin() {
 
 // 4. START SAMPLING
 void PressADSManager::startSampling() {
+    DcAcquisitionEngine::instance().start();
+
     // Creamos la tarea. Usamos un stack size moderado.
     xTaskCreatePinnedToCore(
         press_task_trampoline, 
@@ -103,23 +80,18 @@ void PressADSManager::press_task_body() {
             // Chequear si el canal está activo en la config
             if ((config.active_channels >> ch) & 0x01) {
                 
-                float voltage = getRaw(ch, config.NUM_SAMPLES); // Promediar varias muestras para reducir ruido
-                
-                // Conversión a presión
-                float pressure = convertVoltageToPressure(voltage);
-
-                // Guardar en historial protegido por Mutex
-                if (pressure_histories[ch] != nullptr) {
-                    if (xSemaphoreTake(data_mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-                        int head = history_heads[ch];
-                        pressure_histories[ch][head] = pressure;
-                        history_heads[ch] = (head + 1) % config.history_size;
-                        xSemaphoreGive(data_mutex);
-                    }
+                // Último valor decimado por el motor DC (promedio de NUM_SAMPLES conversiones)
+                // Sin dato aún se guarda -999 (como Temp) para que todos los
+                // canales avancen la misma secuencia
+                float voltage = 0.0f;
+                float pressure = -999.0f;
+                if (DcAcquisitionEngine::instance().read(engine_slots[ch], voltage)) {
+                    // Conversión a presión
+                    pressure = convertVoltageToPressure(voltage);
                 }
-                
-                // Pequeña pausa entre canales para estabilidad del I2C
-                vTaskDelay(pdMS_TO_TICKS(2));
+
+                // Guardar en historial (push no bloquea)
+                pressure_histories[ch].push(pressure);
             }
         }
 
@@ -135,16 +107,37 @@ float PressADSManager::convertVoltageToPressure(float voltage) {
     
     // Clamping: Asegurar que el voltaje esté dentro del rango esperado para evitar
     // valores de presión negativos absurdos o fuera de rango físico.
+    // Copia coherente de la escala (setConfig puede cambiarla en caliente)
+    portENTER_CRITICAL(&scale_mux);
+    const float v_min = config.min_voltage, v_max = config.max_voltage;
+    const float p_min = config.min_pressure, p_max = config.max_pressure;
+    portEXIT_CRITICAL(&scale_mux);
+
     float safe_volts = voltage;
-    if (safe_volts < config.min_voltage) safe_volts = config.min_voltage;
-    if (safe_volts > config.max_voltage) safe_volts = config.max_voltage;
+    if (safe_volts < v_min) safe_volts = v_min;
+    if (safe_volts > v_max) safe_volts = v_max;
 
-    float slope = (config.max_pressure - config.min_pressure) / (config.max_voltage - config.min_voltage);
-    float pressure = config.min_pressure + (safe_volts - config.min_voltage) * slope;
+    float slope = (p_max - p_min) / (v_max - v_min);
+    float pressure = p_min + (safe_volts - v_min) * slope;
 
     return pressure;
 }
 
+// Mapea el índice lógico (denso) al canal físico según la máscara activa
+int PressADSManager::physicalChannel(int channel) const {
+    if (channel < 0) {
+        return -1;
+    }
+    for (int ch = 0; ch < 4; ch++) {
+        if ((config.active_channels >> ch) & 0x01) {
+            if (channel-- == 0) {
+                return ch;
+            }
+        }
+    }
+    return -1;
+}
+
 // 8. API PÚBLICA: getLatest
 float PressADSManager::getLatest(int channel) {
     float val = 0.0f;
@@ -154,39 +147,67 @@ float PressADSManager::getLatest(int channel) {
 
 // 9. API PÚBLICA: getHistory
 int PressADSManager::getHistory(int channel, float* output_buffer, int count) {
-    if (channel < 0 || channel >= 4 || pressure_histories[channel] == nullptr) {
+    int ch = physicalChannel(channel);
+    if (ch < 0) {
         return 0; // Canal inválido o no activo
     }
-    if (count > config.history_size) {
+    return pressure_histories[ch].latest(output_buffer, count);
+}
+
+// 10. API PÚBLICA: lecturas incrementales
+uint32_t PressADSManager::getSequence(int channel) {
+    int ch = physicalChannel(channel);
+    if (ch < 0) {
         return 0;
     }
+    return pressure_histories[ch].sequence();
+}
 
-    if (xSemaphoreTake(data_mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-        // Cálculo del índice más reciente
-        int head = history_heads[channel];
-        int most_recent = (head == 0) ? (config.history_size - 1) : (head - 1);
-
-        for (int i = 0; i < count; i++) {
-            // Recorrer hacia atrás circularmente
-            int idx = (most_recent - (count - 1 - i) + config.history_size) % config.history_size;
-            output_buffer[i] = pressure_histories[channel][idx];
-        }
-
-        xSemaphoreGive(data_mutex);
-        return count;
+int PressADSManager::getHistorySince(int channel, uint32_t after_seq, float* output_buffer, int max,
+                                     uint32_t* first_seq) {
+    int ch = physicalChannel(channel);
+    if (ch < 0) {
+        return 0;
     }
-    return 0;
+    return pressure_histories[ch].since(after_seq, output_buffer, max, first_seq);
+}
+
+// 11. CONFIGURACIÓN EN TIEMPO DE EJECUCIÓN
+void PressADSManager::getConfig(uint16_t* regs) {
+    memset(regs, 0, ADS_CONFIG_REGS * sizeof(uint16_t));
+    regs[0] = config.process_interval_ms;
+    regs[1] = config.sampling_rate;
+    regs[2] = config.NUM_SAMPLES;
+    portENTER_CRITICAL(&scale_mux);
+    regs[3] = (uint16_t)lroundf(config.min_voltage * 1000.0f);
+    regs[4] = (uint16_t)lroundf(config.max_voltage * 1000.0f);
+    regs[5] = (uint16_t)(int16_t)lroundf(config.min_pressure * 10.0f);
+    regs[6] = (uint16_t)(int16_t)lroundf(config.max_pressure * 10.0f);
+    portEXIT_CRITICAL(&scale_mux);
 }
 
-float PressADSManager::getRaw(uint8_t channel, uint8_t NUM_SAMPLES) {
-    float sum = 0.0f;
-    for (uint8_t i = 0; i < NUM_SAMPLES; i++) {
-        sum += readChannel(channel);
-        vTaskDelay(pdMS_TO_TICKS(10)); // Pequeña pausa entre muestras
+bool PressADSManager::setConfig(const uint16_t* regs) {
+    int16_t p_min = (int16_t)regs[5];
+    int16_t p_max = (int16_t)regs[6];
+    if (!validBaseConfig(regs) || regs[2] < 1 || regs[2] > 64 ||
+        regs[4] <= regs[3] || regs[4] > 6144 || p_max <= p_min) {
+        return false;
     }
-    
-    float average_adc = (float)sum / NUM_SAMPLES;
-    float voltage = ads->computeVolts(average_adc); // Usamos el método del ADS para convertir a voltios
 
-    return voltage;
-}
\ No newline at end of file
+    config.process_interval_ms = regs[0];
+    config.sampling_rate = regs[1];
+    config.NUM_SAMPLES = regs[2];
+    portENTER_CRITICAL(&scale_mux);
+    config.min_voltage = regs[3] / 1000.0f;
+    config.max_voltage = regs[4] / 1000.0f;
+    config.min_pressure = p_min / 10.0f;
+    config.max_pressure = p_max / 10.0f;
+    portEXIT_CRITICAL(&scale_mux);
+
+    // Data rate del chip + temporización de los slots activos en el motor DC
+    uint16_t effective_sps = applyDataRate(config.sampling_rate);
+    for (int ch = 0; ch < 4; ch++) {
+        DcAcquisitionEngine::instance().setTiming(engine_slots[ch], effective_sps, config.NUM_SAMPLES);
+    }
+    return true;
+}
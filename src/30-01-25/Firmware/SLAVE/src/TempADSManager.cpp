@@ -6,16 +6,12 @@
 static volatile float _current_temperature = 0.0f;
 
 // 1. CONSTRUCTOR
-TempADSManager::TempADSManager(const ADSconfig& cfg)
+TempADSManager::TempADSManager(const TempADSConfig& cfg)
     : ADSBase(cfg), 
       config(cfg)
 {
-    // --- NUEVO: Inicializar Buffer ---
-    if (config.history_size > 0) {
-        temp_history = new float[config.history_size](); // Init a 0
-    }
-    history_head = 0;
-    data_mutex = xSemaphoreCreateMutex(); // Crear el semáforo
+    // Inicializar Buffer (a 0)
+    temp_history.init(config.history_size);
 }
 
 // 2. DESTRUCTOR
@@ -23,13 +19,6 @@ TempADSManager::~TempADSManager() {
     if (temp_task_handle != nullptr) {
         vTaskDelete(temp_task_handle);
     }
-    // --- NUEVO: Limpieza ---
-    if (temp_history != nullptr) {
-        delete[] temp_history;
-    }
-    if (data_mutex != nullptr) {
-        vSemaphoreDelete(data_mutex);
-    }
 }
 
 // 3. BEGIN
@@ -40,32 +29,18 @@ bool TempADSManager::begin() {
     }
     
     // 2. CONFIGURAR DATA RATE (SAMPLING RATE)
-    // El chip necesita traducir tu número entero a la constante correcta
-    
-    if (config.type == ADSType::ADS1115) {
-        switch(config.sampling_rate) {
-            case 8:    ads->setDataRate(RATE_ADS1115_8SPS); break;
-            case 16:   ads->setDataRate(RATE_ADS1115_16SPS); break;
-            case 32:   ads->setDataRate(RATE_ADS1115_32SPS); break;
-            case 64:   ads->setDataRate(RATE_ADS1115_64SPS); break;
-            case 128:  ads->setDataRate(RATE_ADS1115_128SPS); break; // Default común
-            case 250:  ads->setDataRate(RATE_ADS1115_250SPS); break;
-            case 475:  ads->setDataRate(RATE_ADS1115_475SPS); break;
-            case 860:  ads->setDataRate(RATE_ADS1115_860SPS); break;
-            default:   ads->setDataRate(RATE_ADS1115_128SPS); break; // Fallback seguro
-        }
-    } else {
-        // Para ADS1015 (es más rápido)
-        switch(config.sampling_rate) {
-            case 128:  ads->setDataRate(RATE_ADS1015_128SPS); break;
-            case 250:  ads->setDataRate(RATE_ADS1015_250SPS); break;
-            case 490:  ads->setDataRate(RATE_ADS1015_490SPS); break;
-            case 920:  ads->setDataRate(RATE_ADS1015_920SPS); break;
-            case 1600: ads->setDataRate(RATE_ADS1015_1600SPS); break;
-            case 2400: ads->setDataRate(RATE_ADS1015_2400SPS); break;
-            case 3300: ads->setDataRate(RATE_ADS1015_3300SPS); break;
-            default:   ads->setDataRate(RATE_ADS1015_1600SPS); break;
-        }
+    uint16_t effective_sps = applyDataRate(config.sampling_rate);
+
+    // 3. REGISTRAR CANALES EN EL MOTOR DC (modo continuo + decimación)
+    // Vref (par 2-3), Vcable (par 1-3) y Vpt100 (par 0-3)
+    DcAcquisitionEngine& engine = DcAcquisitionEngine::instance();
+    float vpb = getVoltsPerBit(base_config.gain, base_config.type);
+    slot_vref   = engine.addChannel(ads, ADSChannel<ADSCh::DIFF_2_3>::mux, effective_sps, config.NUM_SAMPLES, vpb);
+    slot_vcable = engine.addChannel(ads, ADSChannel<ADSCh::DIFF_1_3>::mux, effective_sps, config.NUM_SAMPLES, vpb);
+    slot_vpt100 = engine.addChannel(ads, ADSChannel<ADSCh::DIFF_0_3>::mux, effective_sps, config.NUM_SAMPLES, vpb);
+    if (slot_vref < 0 || slot_vcable < 0 || slot_vpt100 < 0) {
+        Serial.println("TempADSManager: sin slots libres en DcAcquisitionEngine");
+        return false;
     }
 
     return true;
@@ -73,6 +48,8 @@ bool TempADSManager::begin() {
 
 // 4. START SAMPLING
 void TempADSManager::startSampling() {
+    DcAcquisitionEngine::instance().start();
+
     // Creamos la tarea pinned to core 1 (app core)
     xTaskCreatePinnedToCore(
         temp_task_trampoline, 
@@ -97,16 +74,27 @@ void TempADSManager::temp_task_trampoline(void* arg) {
 void TempADSManager::temp_task_body() {
     while (true) {
 
-        float Vref = fabsf(getRaw(32, config.NUM_SAMPLES)); // Referencia de voltaje (canal 32)
-        float Vcable = getRaw(31, config.NUM_SAMPLES); 
-        float Vpt100 = getRaw(30, config.NUM_SAMPLES); 
+        // Últimos valores decimados del motor DC (no bloquea el bus)
+        DcAcquisitionEngine& engine = DcAcquisitionEngine::instance();
+        float Vref = 0.0f, Vcable = 0.0f, Vpt100 = 0.0f;
+        if (!engine.read(slot_vref, Vref) || !engine.read(slot_vcable, Vcable) ||
+            !engine.read(slot_vpt100, Vpt100)) {
+            vTaskDelay(pdMS_TO_TICKS(config.process_interval_ms));
+            continue;
+        }
+        Vref = fabsf(Vref); // Referencia de voltaje (canal 32)
 
         float temperature = -999.0f; // VALOR DE ERROR POR DEFECTO
 
+        // Copia coherente de las resistencias (setConfig puede cambiarlas en caliente)
+        portENTER_CRITICAL(&config_mux);
+        const float r_serie = config.serie_resistor_ohms;
+        portEXIT_CRITICAL(&config_mux);
+
         // VALIDACIÓN 1: Resistor de serie válido
-        if (config.serie_resistor_ohms > 0.0f) {
+        if (r_serie > 0.0f) {
             
-            float I = Vref / config.serie_resistor_ohms;
+            float I = Vref / r_serie;
 
             // VALIDACIÓN 2: Corriente válida (>1mA)
             if (I >= 0.0001f) {
@@ -122,11 +110,7 @@ void TempADSManager::temp_task_body() {
         }
 
         // GUARDAR (siempre guarda algo, incluso -999.0f si hay error)
-        if (xSemaphoreTake(data_mutex, portMAX_DELAY) == pdTRUE) {
-            temp_history[history_head] = temperature;
-            history_head = (history_head + 1) % config.history_size;
-            xSemaphoreGive(data_mutex);
-        }
+        temp_history.push(temperature);
         
         vTaskDelay(pdMS_TO_TICKS(config.process_interval_ms));
     }
@@ -142,34 +126,51 @@ float TempADSManager::getLatest(int channel) {
 }
 
 int TempADSManager::getHistory(int channel, float* output_buffer, int count) {
-    if (count > config.history_size || temp_history == nullptr) {
-        return 0;
-    }
-    
-    if (xSemaphoreTake(data_mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-        int most_recent = (history_head == 0) ? (config.history_size - 1) : (history_head - 1);
-        
-        for (int i = 0; i < count; i++) {
-            // Lógica circular inversa (del más reciente hacia atras)
-            int idx = (most_recent - (count - 1 - i) + config.history_size) % config.history_size;
-            output_buffer[i] = temp_history[idx];
-        }
-        
-        xSemaphoreGive(data_mutex);
-        return count;
-    }
-    return 0;
+    // Un solo "canal" de temperatura; copia en orden cronológico sin bloquear
+    return temp_history.latest(output_buffer, count);
+}
+
+uint32_t TempADSManager::getSequence(int channel) {
+    return temp_history.sequence();
+}
+
+int TempADSManager::getHistorySince(int channel, uint32_t after_seq, float* output_buffer, int max,
+                                    uint32_t* first_seq) {
+    return temp_history.since(after_seq, output_buffer, max, first_seq);
 }
 
-float TempADSManager::getRaw(uint8_t channel, uint8_t NUM_SAMPLES) {
-    float sum = 0.0f;
-    for (uint8_t i = 0; i < NUM_SAMPLES; i++) {
-        sum += readChannel(channel);
-        vTaskDelay(pdMS_TO_TICKS(10)); // Pequeña pausa entre muestras
+// --- CONFIGURACIÓN EN TIEMPO DE EJECUCIÓN ---
+
+void TempADSManager::getConfig(uint16_t* regs) {
+    memset(regs, 0, ADS_CONFIG_REGS * sizeof(uint16_t));
+    regs[0] = config.process_interval_ms;
+    regs[1] = config.sampling_rate;
+    regs[2] = config.NUM_SAMPLES;
+    portENTER_CRITICAL(&config_mux);
+    regs[3] = config.serie_resistor_ohms;
+    regs[4] = config.r0_ohms;
+    portEXIT_CRITICAL(&config_mux);
+}
+
+bool TempADSManager::setConfig(const uint16_t* regs) {
+    if (!validBaseConfig(regs) || regs[2] < 1 || regs[2] > 64 || regs[3] == 0 || regs[4] == 0) {
+        return false;
     }
-    
-    float average_adc = (float)sum / NUM_SAMPLES;
-    float voltage = ads->computeVolts(average_adc); // Usamos el método del ADS para convertir a voltios
 
-    return voltage;
-}
\ No newline at end of file
+    config.process_interval_ms = regs[0];
+    config.sampling_rate = regs[1];
+    config.NUM_SAMPLES = regs[2];
+    portENTER_CRITICAL(&config_mux);
+    config.serie_resistor_ohms = regs[3];
+    config.r0_ohms = regs[4];
+    portEXIT_CRITICAL(&config_mux);
+
+    // Data rate del chip + temporización de sus slots en el motor DC
+    // (antes de begin() los slots aún no existen: begin() usa estos valores)
+    uint16_t effective_sps = applyDataRate(config.sampling_rate);
+    DcAcquisitionEngine& engine = DcAcquisitionEngine::instance();
+    engine.setTiming(slot_vref, effective_sps, config.NUM_SAMPLES);
+    engine.setTiming(slot_vcable, effective_sps, config.NUM_SAMPLES);
+    engine.setTiming(slot_vpt100, effective_sps, config.NUM_SAMPLES);
+    return true;
+}
@@ -1,36 +1,164 @@
 /**
  * @file main.cpp
- * @brief Modbus RTU Slave Firmware with ADS1015 and real-time RMS calculation (ESP32).
- * @details This system acquires analog signals from 3 channels using ADS1015 ADC,
- * calculates real-time RMS values using circular FIFOs, maintains a measurement
- * history and responds to Modbus RTU queries over RS485. Includes channel-specific
- * conversion factors and improved ADC multiplexer handling.
+ * @brief Modbus RTU Slave Firmware with ADS1x15 sensors (RMS, PT100, pressure) on ESP32.
+ * @details This system hosts up to four ADSBase drivers on the same I2C bus
+ * (addresses 0x48-0x4B): real-time RMS over ADS1015, PT100 temperature and
+ * 0.5-4.5 V pressure over ADS1115. Every driver shares the bus through
+ * I2CBus, keeps its own measurement history and is published in its own
+ * Modbus register block with its own discovery descriptor.
  * @date 2025-12-04
  */
 
 #include <Arduino.h>
 #include <HardwareSerial.h>
 #include "ModbusServerRTU.h"
+#include "I2CBus.h"
+#include "ADSManager.h"
+#include "TempADSManager.h"
+#include "PressADSManager.h"
+#include "RegisterImage.h"
+#include "StreamStats.h"
+#include <Preferences.h>
 
-// ===== SELECCIÓN DE MODO =====
-// Descomenta UNO de los dos para elegir el modo (o úsalo desde platformio.ini)
-// #define MODE_RMS
-#define MODE_RMS  // <--- En este ejemplo activamos Temperatura
-
-#if defined(MODE_RMS)
-    #include "ADSManager.h"
-#elif defined(MODE_TEMP)
-    #include "TempADSManager.h"
+// ===== SELECCIÓN DE SENSORES =====
+// Cada sensor habilitado se instancia en su propia dirección I2C y publica
+// su propio bloque Modbus. Se pueden sobrescribir desde platformio.ini
+// (build_flags = -D ENABLE_TEMP=1 ...). MODE_RMS / MODE_TEMP / MODE_PRESS
+// se mantienen como alias de un único sensor.
+#if defined(MODE_TEMP)
+    #define ENABLE_TEMP 1
 #elif defined(MODE_PRESS)
-    #include "PressADSManager.h"
-#else
-    #error "Debes definir MODE_RMS o MODE_TEMP"
+    #define ENABLE_PRESS 1
+#endif
+#ifndef ENABLE_RMS
+    #if defined(MODE_TEMP) || defined(MODE_PRESS)
+        #define ENABLE_RMS 0
+    #else
+        #define ENABLE_RMS 1
+    #endif
+#endif
+#ifndef ENABLE_TEMP
+#define ENABLE_TEMP 0
+#endif
+#ifndef ENABLE_PRESS
+#define ENABLE_PRESS 0
+#endif
+
+#if !(ENABLE_RMS || ENABLE_TEMP || ENABLE_PRESS)
+    #error "Debes habilitar al menos un sensor (ENABLE_RMS, ENABLE_TEMP o ENABLE_PRESS)"
+#endif
+
+// Dirección I2C de cada ADS (sobrescribible con -D). Con un único sensor
+// habilitado todos quedan en 0x48, como en los builds MODE_* de siempre;
+// con varios, cada uno ocupa su propia dirección.
+#ifndef RMS_ADS_ADDRESS
+#define RMS_ADS_ADDRESS 0x48
+#endif
+#ifndef TEMP_ADS_ADDRESS
+    #if ENABLE_RMS || ENABLE_PRESS
+        #define TEMP_ADS_ADDRESS 0x49
+    #else
+        #define TEMP_ADS_ADDRESS 0x48
+    #endif
+#endif
+#ifndef PRESS_ADS_ADDRESS
+    #if ENABLE_RMS || ENABLE_TEMP
+        #define PRESS_ADS_ADDRESS 0x4A
+    #else
+        #define PRESS_ADS_ADDRESS 0x48
+    #endif
 #endif
 
 // ===== CONFIGURACIÓN =====
 #define SLAVE_ID 1
-#define NUM_CHANNELS 3
-#define NUM_REGISTERS 18
+#define MAX_SENSORS 4              // Una dirección I2C por sensor (0x48-0x4B)
+#define HISTORY_PER_CHANNEL 6      // Muestras de historial publicadas por canal
+#define DATA_BASE_ADDRESS 10       // Primer registro de datos del primer sensor
+#define DESCRIPTOR_REGS 8          // Registros por descriptor de discovery
+// Tabla de descriptores, legible en un solo bloque:
+//   DESCRIPTOR_TABLE_ADDRESS + 0          : (versión << 8) | número de sensores
+//                            + 1 + k*8 .. : descriptor k (mismo formato que 0..7)
+// Hasta DESCRIPTOR_TABLE_CAPACITY descriptores; las ranuras libres leen 0, así el
+// maestro puede pedir la tabla completa sin saber cuántos sensores hay.
+// Versión 1: la ventana por secuencia del descriptor k está en
+// SEQ_WINDOW_ADDRESS + k*SEQ_WINDOW_STRIDE.
+#define DESCRIPTOR_TABLE_ADDRESS 200
+#define DESCRIPTOR_TABLE_VERSION 1
+#define DESCRIPTOR_TABLE_CAPACITY 15 // 1 + 15*8 = 121 registros (< 125 por lectura)
+#define MAX_DATA_REGISTERS 60
+// Ventana por secuencia (lecturas incrementales), una por sensor en el orden
+// de la tabla de descriptores:
+//   SEQ_WINDOW_ADDRESS + k*SEQ_WINDOW_STRIDE + 0..1 : secuencia del último valor (hi, lo)
+//                                             + 2    : profundidad H (muestras)
+//                                             + 3    : canales C
+//                                             + 4 + (seq % H)*C + ch : valor
+// El maestro lee la cabecera y luego solo las ranuras con secuencia nueva.
+#define SEQ_WINDOW_ADDRESS 1000
+#define SEQ_WINDOW_STRIDE 100
+#define SEQ_WINDOW_HEADER 4
+#define SEQ_WINDOW_DEPTH 16
+#define SEQ_WINDOW_MAX_CHANNELS 4
+// Latch sincronizado: el maestro escribe (FC06, broadcast ID 0) un token en
+// LATCH_REGISTER y todos los esclavos congelan a la vez sus valores publicados:
+//   LATCH_BANK_ADDRESS + 0              : token del último latch
+//                      + 1 + 2k .. 2k+2 : secuencia del sensor k al latch (hi, lo)
+//                      + LATCH_HEADER_REGS + (r - DATA_BASE_ADDRESS) : copia del registro r
+// El bloque congelado de un sensor está en su startAddress + LATCH_BANK_OFFSET.
+#define LATCH_REGISTER 900
+#define LATCH_BANK_ADDRESS 500
+#define LATCH_HEADER_REGS 10
+#define LATCH_BANK_OFFSET (LATCH_BANK_ADDRESS + LATCH_HEADER_REGS - DATA_BASE_ADDRESS)
+// Configuración en tiempo de ejecución: un bloque de ADS_CONFIG_REGS por sensor
+// (mismo orden que la tabla de descriptores), legible con FC03 y escribible con
+// FC06/FC10. Se valida, se aplica sin reiniciar y se guarda en NVS.
+#define CONFIG_ADDRESS 400
+#define CONFIG_NVS_NAMESPACE "slavecfg"
+#define CONFIG_NVS_LAYOUT 2        // Cambiar si cambia el significado de los registros (2: disparo RMS)
+// Resúmenes por ventana: min, max, media, desviación y p95 de cada canal sobre
+// SUMMARY_WINDOW_MS, publicados como descriptor propio (dataType = DATA_TYPE_SUMMARY):
+//   SUMMARY_ADDRESS + j*SUMMARY_STRIDE + 0 : número de ventana cerrada (16 bits bajos)
+//                                      + 1 : valores acumulados en la ventana (mínimo entre canales)
+//                                      + 2 + ch*5 + {0..4} : min, max, media, desv, p95
+// El descriptor apunta al bloque de datos (tras la cabecera), canal a canal como el historial.
+#ifndef SUMMARY_WINDOW_MS
+#define SUMMARY_WINDOW_MS 30000
+#endif
+#define SUMMARY_ADDRESS 600
+#define SUMMARY_STRIDE 24
+#define SUMMARY_HEADER 2
+#define SUMMARY_FIELDS 5
+#define SUMMARY_MAX_CHANNELS 4
+#define MAX_SUMMARIES MAX_SENSORS
+#define DATA_TYPE_SUMMARY 5
+// Tipo de dato del descriptor de cada sensor: 1 = uint8 (byte bajo), 6 = uint16 que el
+// maestro reenvía codificado en deltas (historiales lentos como el RMS), 4 = float16 y
+// 7 = int8/int16 escalado (registro / 10^escala con error máximo QUANT_MAX_ERROR_COUNTS)
+#define DATA_TYPE_UINT8 1
+#define DATA_TYPE_FLOAT16 4
+#define DATA_TYPE_DELTA 6
+#define DATA_TYPE_SCALED 7
+// Error máximo admitido al cuantizar (cuentas del registro, 0 = sin pérdida); va en el
+// campo compressedBytes del descriptor de los sensores float16/escalados
+#ifndef QUANT_MAX_ERROR_COUNTS
+#define QUANT_MAX_ERROR_COUNTS 0
+#endif
+#ifndef RMS_DATA_TYPE
+#define RMS_DATA_TYPE DATA_TYPE_DELTA
+#endif
+#ifndef TEMP_DATA_TYPE
+#define TEMP_DATA_TYPE DATA_TYPE_UINT8
+#endif
+#ifndef PRESS_DATA_TYPE
+#define PRESS_DATA_TYPE DATA_TYPE_UINT8
+#endif
+// Último transitorio capturado (ver TransientCapture.h), se lee en varios bloques:
+//   TRANSIENT_ADDRESS + 0..7 : [seq hi][seq lo][ms hi][ms lo][(causa << 8) | canal]
+//                              [canales][muestras por canal][muestras previas al disparo]
+//                     + 8 + ch*N + i : muestra cruda i del canal ch (int16, la más antigua primero)
+// El maestro relee la secuencia al final: si cambió, hubo un evento nuevo a mitad de lectura.
+#define TRANSIENT_ADDRESS 3000
+#define TRANSIENT_REGS (TransientCapture::kHeaderRegs + \
+                        SUMMARY_MAX_CHANNELS * (TRANSIENT_PRE_SAMPLES + TRANSIENT_POST_SAMPLES))
 #define RX_PIN 16
 #define TX_PIN 17
 
@@ -38,25 +166,31 @@ HardwareSerial ModbusSerial(1);
 ModbusServerRTU MBserver(2000);
 
 // ===== CONFIGURACIÓN ADS =====
-#if defined(MODE_RMS)
+#if ENABLE_RMS
+    // Chip, ganancia y canales fijados en compilación (tabla MUX precalculada)
+    typedef ADSSequencer<ADSType::ADS1015,   // RMS puede usar el modelo más rápido (1015)
+                         GAIN_TWOTHIRDS,      // Ganancia común para señales de hasta ±6.144V 
+                         ADSCh::AIN0, ADSCh::AIN1, ADSCh::AIN2> RmsSequence;
+    #define RMS_NUM_CHANNELS RmsSequence::count
     const float CONVERSION_FACTORS[] = {0.676f, 0.981f, 0.979f};
-    ADSConfig config(
-        ADSType::ADS1015,   // RMS puede usar el modelo más rápido (1015)
-        0x48,
-        GAIN_TWOTHIRDS,     // Ganancia común para señales de hasta ±6.144V 
+    static_assert(sizeof(CONVERSION_FACTORS) / sizeof(CONVERSION_FACTORS[0]) == RmsSequence::count,
+                  "Un factor de conversión por canal RMS");
+    ADSConfig rmsConfig(
+        RmsSequence::sequence(),
+        RMS_ADS_ADDRESS,
         1000,               // Intervalo de procesamiento (1 segundo)
-        NUM_CHANNELS,       // Número de canales a muestrear
         CONVERSION_FACTORS, // Puntero a los factores de conversión específicos por canal
         19,                 // alert_pin
         3300,               // sampling_rate: 3300 SPS (máximo para ADS1015, para asegurar mediciones rápidas y precisas)
         1200,               // Fifo size: 1200 muestras (Permite alojar más de 1 segundo de datos reales a >1000 SPS por canal)
         100                 // History size: 100 muestras por canal (para mantener un historial de ~3 segundos a 330 SPS)
     );
-#elif defined(MODE_TEMP)
+#endif
+#if ENABLE_TEMP
     // Configuración específica de Temp (R0, R_Serie, etc)
-    ADSconfig config(
+    TempADSConfig tempConfig(
         ADSType::ADS1115,    // Temp necesita más resolución (16-bit)
-        0x48,                
+        TEMP_ADS_ADDRESS,
         GAIN_TWO,            // Ganancia más alta para medir mV pequeños
         1000,                // Intervalo
         4700,                // R serie
@@ -65,67 +199,419 @@ ModbusServerRTU MBserver(2000);
         10,
         50                   // Historial
     );
-#elif defined(MODE_PRESS)
-    ADSconfig config(
+#endif
+#if ENABLE_PRESS
+    #define PRESS_ACTIVE_CHANNELS 0b0001
+    PressADSConfig pressConfig(
         ADSType::ADS1115,    // Presión también se beneficia de 16-bit
-        0x48,
+        PRESS_ADS_ADDRESS,
         GAIN_TWOTHIRDS,     // Ganancia media para rango típico de sensores de presión
         1000,               // Intervalo
         0.5f,               // Voltaje mínimo del sensor (0.5V)
         4.5f,               // Voltaje máximo del sensor (4.5V)
         0.0f,               // Presión mínima (ajustar según sensor)
         100.0f,             // Presión máxima (ajustar según sensor)
-        0b0001,            // Solo canal 0 activo
+        PRESS_ACTIVE_CHANNELS, // Solo canal 0 activo
         128,                // Sample rate
         10,                 // Número de muestras para promediar
         50                  // Historial
     );
 #endif
 
-ADSBase* sensorDriver = nullptr; // Puntero Polimórfico
-
 // ===== MODBUS =====
-uint16_t holdingRegisters[NUM_REGISTERS];
-SemaphoreHandle_t dataMutex;
-
 // Variable de estado del sistema
 bool systemInitialized = false;  // ← NUEVA VARIABLE
 
 struct SensorData {
-    uint16_t sensorID = 1;
-    uint16_t numberOfChannels = NUM_CHANNELS;
-    uint16_t startAddress = 10;
-    uint16_t maxRegisters = NUM_REGISTERS;
-    uint16_t samplingInterval = 1000;
-    uint16_t dataType = 1;
-    uint16_t scale = 1;
-    uint16_t compressedBytes = 0;
-} sensor;
+    uint16_t sensorID;
+    uint16_t numberOfChannels;
+    uint16_t startAddress;
+    uint16_t maxRegisters;
+    uint16_t samplingInterval;
+    uint16_t dataType;
+    uint16_t scale;
+    uint16_t compressedBytes;
+};
+
+// Un sensor lógico del esclavo: driver + descriptor + bloque de registros
+struct SensorSlot {
+    const char* name;
+    ADSBase* driver;
+    SensorData descriptor;
+    uint16_t regOffset;    // Desplazamiento de su bloque dentro de dataImage
+    uint32_t seq;          // Última secuencia copiada a la ventana
+    bool ok;               // begin() exitoso
+};
+
+SensorSlot sensors[MAX_SENSORS];
+int numSensors = 0;
+
+// Resumen estadístico de un sensor: descriptor propio + un acumulador por canal
+struct SummarySlot {
+    int sensor;               // Índice en sensors[]
+    SensorData descriptor;
+    uint32_t seq;             // Última secuencia acumulada
+    uint16_t window;          // Ventanas cerradas
+    uint32_t windowStart;     // millis() de apertura de la ventana actual
+    StreamStats stats[SUMMARY_MAX_CHANNELS];
+};
+
+SummarySlot summaries[MAX_SUMMARIES];
+int numSummaries = 0;
+// Última ventana cerrada de cada resumen
+RegisterImage<MAX_SUMMARIES * SUMMARY_STRIDE> summaryImage;
+// Último transitorio capturado (registros válidos: transientRegs)
+RegisterImage<TRANSIENT_REGS> transientImage;
+volatile uint16_t transientRegs = 0;
+// Imagen de registros de datos (doble buffer): dataUpdateTask publica,
+// el worker Modbus copia sin bloquear
+RegisterImage<MAX_DATA_REGISTERS> dataImage;
+// Ventanas por secuencia (cabecera + anillo) de todos los sensores
+RegisterImage<MAX_SENSORS * SEQ_WINDOW_STRIDE> seqImage;
+
+// Banco congelado por el último latch (solo lo escribe el worker de broadcast)
+RegisterImage<LATCH_HEADER_REGS + MAX_DATA_REGISTERS> latchImage;
+
+static_assert(CONFIG_ADDRESS >= DESCRIPTOR_TABLE_ADDRESS + 1 + DESCRIPTOR_TABLE_CAPACITY * DESCRIPTOR_REGS &&
+              CONFIG_ADDRESS + MAX_SENSORS * ADS_CONFIG_REGS <= LATCH_BANK_ADDRESS,
+              "El bloque de configuración se solapa con otra zona del mapa");
+static_assert(1 + 2 * MAX_SENSORS <= LATCH_HEADER_REGS,
+              "La cabecera del latch no tiene sitio para todos los sensores");
+static_assert(SUMMARY_HEADER + SUMMARY_FIELDS * SUMMARY_MAX_CHANNELS <= SUMMARY_STRIDE &&
+              SUMMARY_ADDRESS >= LATCH_BANK_ADDRESS + LATCH_HEADER_REGS + MAX_DATA_REGISTERS &&
+              SUMMARY_ADDRESS + MAX_SUMMARIES * SUMMARY_STRIDE <= LATCH_REGISTER,
+              "El bloque de resúmenes no entra en su zona del mapa");
+static_assert(TRANSIENT_ADDRESS >= SEQ_WINDOW_ADDRESS + DESCRIPTOR_TABLE_CAPACITY * SEQ_WINDOW_STRIDE,
+              "El bloque de transitorios pisa las ventanas por secuencia");
+static_assert(SUMMARY_WINDOW_MS <= 65535, "samplingInterval del descriptor es de 16 bits");
+static_assert(MAX_SENSORS + MAX_SUMMARIES <= DESCRIPTOR_TABLE_CAPACITY,
+              "La tabla de descriptores no tiene ranuras para todos los sensores");
+static_assert(SEQ_WINDOW_HEADER + SEQ_WINDOW_DEPTH * SEQ_WINDOW_MAX_CHANNELS <= SEQ_WINDOW_STRIDE,
+              "La ventana por secuencia no entra en SEQ_WINDOW_STRIDE");
+uint16_t nextDataAddress = DATA_BASE_ADDRESS;
+
+// Registra un sensor y le asigna el siguiente bloque de registros libre
+bool addSensor(const char* name, ADSBase* driver, uint16_t sensorID,
+               uint16_t channels, uint16_t samplingInterval, uint16_t dataType) {
+    uint16_t regs = channels * HISTORY_PER_CHANNEL;
+    uint16_t offset = nextDataAddress - DATA_BASE_ADDRESS;
+    if (numSensors >= MAX_SENSORS || offset + regs > MAX_DATA_REGISTERS ||
+        channels > SEQ_WINDOW_MAX_CHANNELS) {
+        Serial.printf("ERROR: sin espacio para el sensor %s\n", name);
+        return false;
+    }
+
+    SensorSlot& s = sensors[numSensors++];
+    s.name = name;
+    s.driver = driver;
+    uint16_t maxError = (dataType == DATA_TYPE_FLOAT16 || dataType == DATA_TYPE_SCALED) ? QUANT_MAX_ERROR_COUNTS : 0;
+    s.descriptor = {sensorID, channels, nextDataAddress, regs, samplingInterval, dataType, 1, maxError};
+    s.regOffset = offset;
+    s.seq = 0;
+    s.ok = false;
+    nextDataAddress += regs;
+    return true;
+}
+
+// Publica además un resumen por ventana del sensor 'sensor' con su propio sensorID
+bool addSummary(int sensor, uint16_t sensorID) {
+    uint16_t channels = sensors[sensor].descriptor.numberOfChannels;
+    if (numSummaries >= MAX_SUMMARIES || channels > SUMMARY_MAX_CHANNELS) {
+        Serial.printf("ERROR: sin espacio para el resumen de %s\n", sensors[sensor].name);
+        return false;
+    }
+
+    SummarySlot& sum = summaries[numSummaries];
+    sum.sensor = sensor;
+    sum.descriptor = {sensorID, channels,
+                      (uint16_t)(SUMMARY_ADDRESS + numSummaries * SUMMARY_STRIDE + SUMMARY_HEADER),
+                      (uint16_t)(channels * SUMMARY_FIELDS), SUMMARY_WINDOW_MS, DATA_TYPE_SUMMARY, 1, 0};
+    sum.seq = 0;
+    sum.window = 0;
+    sum.windowStart = millis();
+    numSummaries++;
+    return true;
+}
 
 // ===== TAREA ACTUALIZACIÓN MODBUS =====
+// Copia a la ventana del sensor los valores con secuencia posterior a sensor.seq.
+// Una muestra solo se publica cuando todos los canales la tienen: la secuencia
+// avanza hasta la menor alcanzada, y no se escriben ranuras más allá de ella
+// (pisarían valores que el maestro todavía considera dentro de la ventana).
+void updateSeqWindow(uint16_t* window, SensorSlot& sensor) {
+    uint16_t channels = sensor.descriptor.numberOfChannels;
+    uint32_t latest = channels > 0 ? sensor.driver->getSequence(0) : 0;
+    for (uint16_t ch = 1; ch < channels; ch++) {
+        latest = std::min(latest, sensor.driver->getSequence(ch));
+    }
+    if (latest < sensor.seq) {
+        sensor.seq = 0; // El driver se reinició: volver a empezar
+    }
+
+    if (latest != sensor.seq) {
+        // Solo caben las últimas SEQ_WINDOW_DEPTH muestras
+        uint32_t after = sensor.seq;
+        if (latest - after > SEQ_WINDOW_DEPTH) {
+            after = latest - SEQ_WINDOW_DEPTH;
+        }
+        float values[SEQ_WINDOW_MAX_CHANNELS][SEQ_WINDOW_DEPTH];
+        uint32_t first[SEQ_WINDOW_MAX_CHANNELS];
+        int n[SEQ_WINDOW_MAX_CHANNELS];
+        uint32_t reached = latest;
+        for (uint16_t ch = 0; ch < channels; ch++) {
+            first[ch] = 0;
+            n[ch] = sensor.driver->getHistorySince(ch, after, values[ch], latest - after, &first[ch]);
+            reached = std::min(reached, n[ch] > 0 ? first[ch] + n[ch] - 1 : sensor.seq);
+        }
+        for (uint16_t ch = 0; ch < channels; ch++) {
+            for (int i = 0; i < n[ch] && first[ch] + i <= reached; i++) {
+                uint16_t slot = (first[ch] + i) % SEQ_WINDOW_DEPTH;
+                window[SEQ_WINDOW_HEADER + slot * channels + ch] = (uint16_t)round(values[ch][i]);
+            }
+        }
+        if (reached > sensor.seq) {
+            sensor.seq = reached;
+        }
+    }
+
+    window[0] = (uint16_t)(sensor.seq >> 16);
+    window[1] = (uint16_t)(sensor.seq & 0xFFFF);
+    window[2] = SEQ_WINDOW_DEPTH;
+    window[3] = channels;
+}
+
+// Acumula los valores nuevos del sensor y, al cumplirse la ventana, publica su resumen
+void updateSummary(uint16_t* block, SummarySlot& sum) {
+    SensorSlot& sensor = sensors[sum.sensor];
+    uint16_t channels = sum.descriptor.numberOfChannels;
+    uint32_t latest = sensor.driver->getSequence(0);
+    if (latest < sum.seq) {
+        sum.seq = 0; // El driver se reinició
+    }
+
+    if (latest != sum.seq) {
+        for (uint16_t ch = 0; ch < channels; ch++) {
+            float values[16];
+            uint32_t after = sum.seq;
+            int n;
+            do {
+                uint32_t first = 0;
+                n = sensor.driver->getHistorySince(ch, after, values, 16, &first);
+                for (int i = 0; i < n; i++) {
+                    if (values[i] > -999.0f) { // -999 = lectura fallida
+                        sum.stats[ch].add(values[i]);
+                    }
+                }
+                after = first + n - 1;
+            } while (n == 16 && after < latest);
+        }
+        sum.seq = latest;
+    }
+
+    if (millis() - sum.windowStart < SUMMARY_WINDOW_MS) return;
+    sum.windowStart += SUMMARY_WINDOW_MS;
+    sum.window++;
+
+    block[0] = sum.window;
+    // Canal con menos lecturas válidas: cota de cuántos valores respaldan cada resumen
+    uint32_t counted = channels > 0 ? sum.stats[0].count() : 0;
+    for (uint16_t ch = 1; ch < channels; ch++) {
+        counted = std::min(counted, sum.stats[ch].count());
+    }
+    block[1] = (uint16_t)std::min<uint32_t>(counted, 0xFFFF);
+    for (uint16_t ch = 0; ch < channels; ch++) {
+        StreamStats& st = sum.stats[ch];
+        uint16_t* f = block + SUMMARY_HEADER + ch * SUMMARY_FIELDS;
+        f[0] = (uint16_t)round(st.min());
+        f[1] = (uint16_t)round(st.max());
+        f[2] = (uint16_t)round(st.mean());
+        f[3] = (uint16_t)round(st.stddev());
+        f[4] = (uint16_t)round(st.quantile());
+        st.reset();
+    }
+}
+
 void dataUpdateTask(void* pvParameters) {
-    const int samples_per_channel = NUM_REGISTERS / NUM_CHANNELS;
-    
     while (true) {
-        if (xSemaphoreTake(dataMutex, portMAX_DELAY) == pdTRUE) {
-            for (int ch = 0; ch < NUM_CHANNELS; ch++) {
-                float rms_values[samples_per_channel];
-                
-                // --- CAMBIO AQUÍ: getRMSHistory -> getHistory ---
-                // Ahora usamos el método estandarizado que viene de ADSBase
-                int count = sensorDriver->getHistory(ch, rms_values, samples_per_channel);
-                
-                for (int i = 0; i < samples_per_channel; i++) {
-                    int idx = ch * samples_per_channel + i;
-                    holdingRegisters[idx] = (count > i) ? (uint16_t)round(rms_values[i]) : 0;
+        // Se arma la imagen completa en el buffer trasero y se publica de una vez
+        uint16_t* regs = dataImage.edit();
+        uint16_t* windows = seqImage.edit();
+        for (int s = 0; s < numSensors; s++) {
+            SensorSlot& sensor = sensors[s];
+            if (!sensor.ok) continue; // Conserva el valor de error (255)
+
+            uint16_t* block = regs + sensor.regOffset;
+            for (int ch = 0; ch < sensor.descriptor.numberOfChannels; ch++) {
+                float values[HISTORY_PER_CHANNEL];
+                int count = sensor.driver->getHistory(ch, values, HISTORY_PER_CHANNEL);
+                if (count == 0) continue; // Sin historial: se conserva la imagen anterior
+
+                for (int i = 0; i < HISTORY_PER_CHANNEL; i++) {
+                    int idx = ch * HISTORY_PER_CHANNEL + i;
+                    block[idx] = (count > i) ? (uint16_t)round(values[i]) : 0;
                 }
             }
-            xSemaphoreGive(dataMutex);
+
+            updateSeqWindow(windows + s * SEQ_WINDOW_STRIDE, sensor);
+        }
+        uint16_t* sums = summaryImage.edit();
+        for (int j = 0; j < numSummaries; j++) {
+            if (!sensors[summaries[j].sensor].ok) continue;
+            updateSummary(sums + j * SUMMARY_STRIDE, summaries[j]);
+        }
+        dataImage.publish();
+        seqImage.publish();
+        summaryImage.publish();
+
+        // Transitorio pendiente: se publica entero y el sensor rearma el disparo
+        for (int s = 0; s < numSensors; s++) {
+            if (!sensors[s].ok) continue;
+            uint16_t* event = transientImage.edit();
+            uint16_t n = sensors[s].driver->takeTransient(event, TRANSIENT_REGS);
+            if (n > 0) {
+                Serial.printf("Transitorio en %s: causa 0x%02X canal %u\n", sensors[s].name,
+                              event[4] >> 8, event[4] & 0xFF);
+                transientImage.publish();
+                transientRegs = n;
+            }
         }
         vTaskDelay(pdMS_TO_TICKS(300));
     }
 }
 
+// Registro 'reg' de la tabla de descriptores: [versión|count][desc 0 (8 regs)][desc 1]...
+// Primero los sensores, después sus resúmenes.
+uint16_t descriptorTableRegister(uint16_t reg) {
+    if (reg == 0) return (DESCRIPTOR_TABLE_VERSION << 8) | (uint16_t)(numSensors + numSummaries);
+    uint16_t k = (reg - 1) / DESCRIPTOR_REGS;
+    uint16_t field = (reg - 1) % DESCRIPTOR_REGS;
+    const SensorData* desc;
+    if (k < numSensors) {
+        desc = &sensors[k].descriptor;
+    } else if (k < numSensors + numSummaries) {
+        desc = &summaries[k - numSensors].descriptor;
+    } else {
+        return 0; // Ranura libre
+    }
+    return reinterpret_cast<const uint16_t*>(desc)[field];
+}
+
+// ===== CONFIGURACIÓN PERSISTENTE (NVS) =====
+// Clave por sensorID: el bloque sigue al sensor aunque cambie su posición en la tabla.
+// Blob: [CONFIG_NVS_LAYOUT][ADS_CONFIG_REGS registros]
+Preferences configStore;
+
+static void configKey(const SensorSlot& sensor, char* key) {
+    snprintf(key, 8, "s%u", (unsigned)sensor.descriptor.sensorID);
+}
+
+// Aplica la configuración guardada (antes de begin(): solo parámetros)
+void loadSensorConfig(SensorSlot& sensor) {
+    char key[8];
+    configKey(sensor, key);
+    uint16_t blob[1 + ADS_CONFIG_REGS];
+    if (configStore.getBytes(key, blob, sizeof(blob)) != sizeof(blob) || blob[0] != CONFIG_NVS_LAYOUT) {
+        return; // Sin configuración guardada: valores de compilación
+    }
+    if (sensor.driver->setConfig(blob + 1)) {
+        sensor.descriptor.samplingInterval = blob[1];
+        Serial.printf("Config NVS aplicada a %s\n", sensor.name);
+    } else {
+        Serial.printf("Config NVS de %s inválida: se ignora\n", sensor.name);
+    }
+}
+
+void saveSensorConfig(SensorSlot& sensor, const uint16_t* regs) {
+    char key[8];
+    configKey(sensor, key);
+    uint16_t blob[1 + ADS_CONFIG_REGS];
+    blob[0] = CONFIG_NVS_LAYOUT;
+    memcpy(blob + 1, regs, ADS_CONFIG_REGS * sizeof(uint16_t));
+    configStore.putBytes(key, blob, sizeof(blob));
+}
+
+// Escribe [offset, offset + count) del bloque del sensor k: todo o nada
+Error writeSensorConfig(int k, uint16_t offset, uint16_t count, const uint16_t* values) {
+    SensorSlot& sensor = sensors[k];
+    uint16_t regs[ADS_CONFIG_REGS];
+    sensor.driver->getConfig(regs);
+    memcpy(regs + offset, values, count * sizeof(uint16_t));
+    if (!sensor.driver->setConfig(regs)) {
+        return ILLEGAL_DATA_VALUE;
+    }
+    sensor.descriptor.samplingInterval = regs[0];
+    saveSensorConfig(sensor, regs);
+    Serial.printf("Config de %s actualizada (regs %u..%u)\n", sensor.name,
+                  (unsigned)offset, (unsigned)(offset + count - 1));
+    return SUCCESS;
+}
+
+// FC06 / FC10 sobre el bloque de configuración (una escritura no cruza sensores)
+ModbusMessage writeRegistersWorker(ModbusMessage request) {
+    uint16_t address = 0, words = 1;
+    uint16_t values[ADS_CONFIG_REGS];
+    ModbusMessage response;
+
+    request.get(2, address);
+    if (request.getFunctionCode() == WRITE_HOLD_REGISTER) {
+        request.get(4, values[0]);
+    } else {
+        request.get(4, words);
+        if (words == 0 || words > ADS_CONFIG_REGS) {
+            response.setError(request.getServerID(), request.getFunctionCode(), ILLEGAL_DATA_VALUE);
+            return response;
+        }
+        for (uint16_t i = 0; i < words; ++i) {
+            request.get(7 + 2 * i, values[i]);
+        }
+    }
+
+    uint16_t rel = address - CONFIG_ADDRESS;
+    uint16_t k = rel / ADS_CONFIG_REGS;
+    uint16_t offset = rel % ADS_CONFIG_REGS;
+    if (address < CONFIG_ADDRESS || k >= numSensors || offset + words > ADS_CONFIG_REGS) {
+        response.setError(request.getServerID(), request.getFunctionCode(), ILLEGAL_DATA_ADDRESS);
+        return response;
+    }
+
+    Error err = writeSensorConfig(k, offset, words, values);
+    if (err != SUCCESS) {
+        response.setError(request.getServerID(), request.getFunctionCode(), err);
+    } else if (request.getFunctionCode() == WRITE_HOLD_REGISTER) {
+        response.add(request.getServerID(), request.getFunctionCode(), address, values[0]);
+    } else {
+        response.add(request.getServerID(), request.getFunctionCode(), address, words);
+    }
+    return response;
+}
+
+// ===== LATCH POR BROADCAST =====
+// Copia la imagen publicada (datos + secuencias) al banco congelado
+void latchSnapshot(uint16_t token) {
+    uint16_t* bank = latchImage.edit();
+    uint16_t count = nextDataAddress - DATA_BASE_ADDRESS;
+    dataImage.read(0, count, bank + LATCH_HEADER_REGS);
+    for (int k = 0; k < numSensors; k++) {
+        uint16_t seq[2] = {0, 0};
+        seqImage.read(k * SEQ_WINDOW_STRIDE, 2, seq);
+        bank[1 + 2 * k] = seq[0];
+        bank[2 + 2 * k] = seq[1];
+    }
+    bank[0] = token;
+    latchImage.publish();
+}
+
+// Mensajes al ID 0: no llevan respuesta
+void broadcastWorker(ModbusMessage msg) {
+    uint16_t address = 0, value = 0;
+    if (msg.getFunctionCode() != WRITE_HOLD_REGISTER) return;
+    msg.get(2, address);
+    msg.get(4, value);
+    if (address == LATCH_REGISTER) {
+        latchSnapshot(value);
+    }
+}
+
 // ===== WORKER MODBUS =====
 ModbusMessage readHoldingRegistersWorker(ModbusMessage request) {
     uint16_t address, words;
@@ -134,31 +620,110 @@ ModbusMessage readHoldingRegistersWorker(ModbusMessage request) {
     request.get(2, address);
     request.get(4, words);
     
-    if (address == 0 && words == 8) {
+    if (words == 0 || words > 125) {
+        response.setError(request.getServerID(), request.getFunctionCode(), ILLEGAL_DATA_VALUE);
+        return response;
+    }
+
+    // Descriptor del primer sensor en la dirección clásica (compatibilidad)
+    if (address + words <= DESCRIPTOR_REGS && numSensors > 0) {
+        const uint16_t* d = reinterpret_cast<const uint16_t*>(&sensors[0].descriptor);
+        response.add(request.getServerID(), request.getFunctionCode(), (uint8_t)(words * 2));
+        for (uint16_t i = 0; i < words; ++i) {
+            response.add(d[address + i]);
+        }
+        return response;
+    }
+
+    // Tabla de descriptores (uno por sensor, ranuras libres a 0)
+    uint16_t tableSize = 1 + DESCRIPTOR_TABLE_CAPACITY * DESCRIPTOR_REGS;
+    if (address >= DESCRIPTOR_TABLE_ADDRESS &&
+        address + words <= DESCRIPTOR_TABLE_ADDRESS + tableSize) {
+        response.add(request.getServerID(), request.getFunctionCode(), (uint8_t)(words * 2));
+        for (uint16_t i = 0; i < words; ++i) {
+            response.add(descriptorTableRegister(address - DESCRIPTOR_TABLE_ADDRESS + i));
+        }
+        return response;
+    }
+
+    // Cualquier rango dentro de los bloques de datos: copia sin bloqueo
+    if (address >= DATA_BASE_ADDRESS && address + words <= nextDataAddress) {
+        uint16_t regs[125];
+        dataImage.read(address - DATA_BASE_ADDRESS, words, regs);
+        response.add(request.getServerID(), request.getFunctionCode(), (uint8_t)(words * 2));
+        for (uint16_t i = 0; i < words; ++i) {
+            response.add(regs[i]);
+        }
+        return response;
+    }
+    
+    // Bloque de configuración (se lee del driver: no es un camino frecuente)
+    uint16_t crel = address - CONFIG_ADDRESS;
+    if (address >= CONFIG_ADDRESS && crel + words <= numSensors * ADS_CONFIG_REGS) {
         response.add(request.getServerID(), request.getFunctionCode(), (uint8_t)(words * 2));
-        response.add(sensor.sensorID);
-        response.add(sensor.numberOfChannels);
-        response.add(sensor.startAddress);
-        response.add(sensor.maxRegisters);
-        response.add(sensor.samplingInterval);
-        response.add(sensor.dataType);
-        response.add(sensor.scale);
-        response.add(sensor.compressedBytes);
+        uint16_t regs[ADS_CONFIG_REGS];
+        int loaded = -1;
+        for (uint16_t i = 0; i < words; ++i) {
+            int k = (crel + i) / ADS_CONFIG_REGS;
+            if (k != loaded) {
+                sensors[k].driver->getConfig(regs);
+                loaded = k;
+            }
+            response.add(regs[(crel + i) % ADS_CONFIG_REGS]);
+        }
         return response;
     }
-    else if (address == 10 && words == NUM_REGISTERS) {
-        if (xSemaphoreTake(dataMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+
+    // Último transitorio capturado
+    if (address >= TRANSIENT_ADDRESS && address + words <= TRANSIENT_ADDRESS + transientRegs) {
+        uint16_t regs[125];
+        transientImage.read(address - TRANSIENT_ADDRESS, words, regs);
+        response.add(request.getServerID(), request.getFunctionCode(), (uint8_t)(words * 2));
+        for (uint16_t i = 0; i < words; ++i) {
+            response.add(regs[i]);
+        }
+        return response;
+    }
+
+    // Resúmenes de la última ventana cerrada
+    if (address >= SUMMARY_ADDRESS && address + words <= SUMMARY_ADDRESS + numSummaries * SUMMARY_STRIDE) {
+        uint16_t regs[125];
+        summaryImage.read(address - SUMMARY_ADDRESS, words, regs);
+        response.add(request.getServerID(), request.getFunctionCode(), (uint8_t)(words * 2));
+        for (uint16_t i = 0; i < words; ++i) {
+            response.add(regs[i]);
+        }
+        return response;
+    }
+
+    // Banco congelado por el último latch
+    uint16_t latchSize = LATCH_HEADER_REGS + (nextDataAddress - DATA_BASE_ADDRESS);
+    if (address >= LATCH_BANK_ADDRESS && address + words <= LATCH_BANK_ADDRESS + latchSize) {
+        uint16_t regs[125];
+        latchImage.read(address - LATCH_BANK_ADDRESS, words, regs);
+        response.add(request.getServerID(), request.getFunctionCode(), (uint8_t)(words * 2));
+        for (uint16_t i = 0; i < words; ++i) {
+            response.add(regs[i]);
+        }
+        return response;
+    }
+
+    // Ventana por secuencia de un sensor (cabecera + anillo)
+    uint16_t rel = address - SEQ_WINDOW_ADDRESS;
+    uint16_t k = rel / SEQ_WINDOW_STRIDE;
+    if (address >= SEQ_WINDOW_ADDRESS && k < numSensors) {
+        uint16_t used = SEQ_WINDOW_HEADER + SEQ_WINDOW_DEPTH * sensors[k].descriptor.numberOfChannels;
+        if ((rel % SEQ_WINDOW_STRIDE) + words <= used) {
+            uint16_t regs[125];
+            seqImage.read(rel, words, regs);
             response.add(request.getServerID(), request.getFunctionCode(), (uint8_t)(words * 2));
             for (uint16_t i = 0; i < words; ++i) {
-                response.add(holdingRegisters[i]);
+                response.add(regs[i]);
             }
-            xSemaphoreGive(dataMutex);
-        } else {
-            response.setError(request.getServerID(), request.getFunctionCode(), SERVER_DEVICE_BUSY);
+            return response;
         }
-        return response;
     }
-    
+
     response.setError(request.getServerID(), request.getFunctionCode(), ILLEGAL_DATA_ADDRESS);
     return response;
 }
@@ -167,21 +732,19 @@ ModbusMessage readHoldingRegistersWorker(ModbusMessage request) {
 void setup() {
     Serial.begin(115200);
     delay(1000); 
-    Serial.println("Sistema Modbus + ADSManager (Refactorizado)");
+    Serial.println("Sistema Modbus + ADS multi-sensor");
     
     // SDA=21, SCL=22 son los pines por defecto en ESP32 estándar.
-    // Inicializamos Wire UNA sola vez aquí. La librería Adafruit reutilizará esta instancia.
-    Wire.begin(21, 22); 
+    // Inicializamos Wire UNA sola vez aquí; todos los drivers comparten el bus vía I2CBus.
     // Subimos la velocidad I2C a 800kHz (o 400kHz) para acelerar drásticamente la comunicación con el ADS
-    Wire.setClock(800000L);
+    I2CBus::begin(21, 22, 800000L);
     delay(50); // Dar tiempo al bus I2C para estabilizarse
     
     // ===== I2C SCANNER (DIAGNÓSTICO) =====
     Serial.println("Escaneando bus I2C...");
     bool deviceFound = false;
     for (uint8_t addr = 1; addr < 75; addr++) {
-        Wire.beginTransmission(addr);
-        if (Wire.endTransmission() == 0) {
+        if (I2CBus::probe(addr)) {
             Serial.printf("  Dispositivo I2C encontrado en 0x%02X\n", addr);
             deviceFound = true;
         }
@@ -191,74 +754,92 @@ void setup() {
     }
     Serial.println("Scan I2C completo.");
     
-    // ===== INSTANCIACIÓN CONDICIONAL =====
-    #if defined(MODE_RMS)
-        Serial.println(">>> MODO: RMS MONITOR <<<");
-        sensorDriver = new ADSManager(config);
-    #elif defined(MODE_TEMP)
-        Serial.println(">>> MODO: TEMPERATURA PT100 <<<");
-        sensorDriver = new TempADSManager(config);
-    #elif defined(MODE_PRESS)
-        Serial.println(">>> MODO: PRESIÓN <<<");
-        sensorDriver = new PressADSManager(config); 
+    // ===== INSTANCIACIÓN DE SENSORES =====
+    // Cada sensor publica además su resumen por ventana con un sensorID propio (5, 6, 7)
+    #if ENABLE_RMS
+        if (addSensor("RMS", new ADSManager(rmsConfig), 1, RMS_NUM_CHANNELS, rmsConfig.process_interval_ms,
+                      RMS_DATA_TYPE)) {
+            addSummary(numSensors - 1, 5);
+        }
+    #endif
+    #if ENABLE_TEMP
+        if (addSensor("PT100", new TempADSManager(tempConfig), 3, 1, tempConfig.process_interval_ms,
+                      TEMP_DATA_TYPE)) {
+            addSummary(numSensors - 1, 6);
+        }
+    #endif
+    #if ENABLE_PRESS
+        if (addSensor("PRESION", new PressADSManager(pressConfig), 4,
+                      __builtin_popcount(PRESS_ACTIVE_CHANNELS), pressConfig.process_interval_ms,
+                      PRESS_DATA_TYPE)) {
+            addSummary(numSensors - 1, 7);
+        }
     #endif
 
+    // Configuración guardada en NVS (si la hay) antes de arrancar los drivers
+    configStore.begin(CONFIG_NVS_NAMESPACE, false);
+    for (int i = 0; i < numSensors; i++) {
+        loadSensorConfig(sensors[i]);
+    }
+
     // Inicializar Modbus primero (siempre responde)
     RTUutils::prepareHardwareSerial(ModbusSerial);
     ModbusSerial.begin(19200, SERIAL_8N1, RX_PIN, TX_PIN);
     MBserver.registerWorker(SLAVE_ID, READ_HOLD_REGISTER, &readHoldingRegistersWorker);
+    MBserver.registerWorker(SLAVE_ID, WRITE_HOLD_REGISTER, &writeRegistersWorker);
+    MBserver.registerWorker(SLAVE_ID, WRITE_MULT_REGISTERS, &writeRegistersWorker);
+    MBserver.registerBroadcastWorker(&broadcastWorker);
     MBserver.begin(ModbusSerial, 0);
     
-    dataMutex = xSemaphoreCreateMutex();
-    
-    // Intentar inicializar el sensor I2C
-    if (!sensorDriver->begin()) {
-        Serial.println("ERROR: Fallo en comunicación I2C con ADS");
-        Serial.println("Llenando buffer con valor de error (255)");
-        
-        // Llenar todos los registros con 255 (indicador de fallo)
-        if (xSemaphoreTake(dataMutex, portMAX_DELAY) == pdTRUE) {
-            for (int i = 0; i < NUM_REGISTERS; i++) {
-                holdingRegisters[i] = 255;
+    // Inicializar cada sensor por separado: un fallo no detiene a los demás
+    for (int i = 0; i < numSensors; i++) {
+        SensorSlot& sensor = sensors[i];
+        sensor.ok = sensor.driver->begin();
+
+        if (!sensor.ok) {
+            Serial.printf("ERROR: Fallo en comunicación I2C con ADS (%s)\n", sensor.name);
+            Serial.println("Llenando su bloque con valor de error (255)");
+            
+            // Llenar los registros del sensor con 255 (indicador de fallo)
+            // (dataUpdateTask aún no corre: setup es el único escritor)
+            uint16_t* regs = dataImage.edit();
+            for (int r = 0; r < sensor.descriptor.maxRegisters; r++) {
+                regs[sensor.regOffset + r] = 255;
             }
-            xSemaphoreGive(dataMutex);
+            dataImage.publish();
+            continue;
         }
-        
+
+        Serial.printf("ADS %s inicializado correctamente\n", sensor.name);
+        sensor.driver->startSampling();
+        systemInitialized = true;  // ← Al menos un sensor operativo
+    }
+
+    if (!systemInitialized) {
         Serial.println("Sistema en modo ERROR - Modbus responderá con valores 255");
-        systemInitialized = false;  // ← MARCAR COMO NO INICIALIZADO
-        
-        // NO iniciar tareas de muestreo ni actualización
-        // El sistema queda en espera, solo responde Modbus con valores de error
+        // NO iniciar la tarea de actualización: solo responde Modbus con valores de error
         return;
     }
-    else {
-        Serial.println("ADS inicializado correctamente");
-        
-        // Forzar I2C de nuevo a alta velocidad luego de que begin() de Adafruit lo resetee a 100k
-        Wire.setClock(800000L); 
-        
-        // Solo si begin() fue exitoso, iniciar el muestreo y las tareas
-        sensorDriver->startSampling();
-        systemInitialized = true;  // ← MARCAR COMO INICIALIZADO
-    }
-    xTaskCreatePinnedToCore(dataUpdateTask, "ModbusUpdate", 2048, NULL, 1, NULL, 0);
+    xTaskCreatePinnedToCore(dataUpdateTask, "ModbusUpdate", 3072, NULL, 1, NULL, 0);
     
     Serial.println("Sistema listo - Iniciando muestreo...");
 }
 
 void loop() {
-    static int i2cErrorCount = 0;
-    const int MAX_I2C_ERRORS = 3;  // 3 fallos consecutivos = reinicio
-    
     vTaskDelay(pdMS_TO_TICKS(5000));
     
-    if (systemInitialized) {
-        Serial.printf("CH0: %.1f | CH1: %.1f | CH2: %.1f V\n",
-                      sensorDriver->getLatest(0),
-                      sensorDriver->getLatest(1),
-                      sensorDriver->getLatest(2));
-    } else {
+    if (!systemInitialized) {
         // Sistema en modo ERROR desde el inicio
         Serial.println("Sistema en ERROR - I2C no disponible desde inicio");
+        return;
     }
-}
\ No newline at end of file
+
+    for (int i = 0; i < numSensors; i++) {
+        if (!sensors[i].ok) continue;
+        Serial.printf("%s ->", sensors[i].name);
+        for (int ch = 0; ch < sensors[i].descriptor.numberOfChannels; ch++) {
+            Serial.printf(" CH%d: %.1f", ch, sensors[i].driver->getLatest(ch));
+        }
+        Serial.println();
+    }
+}
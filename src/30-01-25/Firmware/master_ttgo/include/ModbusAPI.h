@@ -57,4 +57,16 @@ void modbus_api_init(HardwareSerial& uart_port, int rx_pin, int tx_pin);
  */
 ModbusApiResult modbus_api_read_registers(uint8_t slave_id, uint8_t function_code, uint16_t start_address, uint16_t num_registers, uint32_t timeout_ms);
 
+/**
+ * @brief Envía una escritura de registro (FC06) en broadcast (ID 0).
+ * @details Los esclavos no responden a un broadcast: la función solo indica si la
+ * trama quedó encolada. Se envía en orden con las lecturas pendientes.
+ *
+ * @param address Registro a escribir en todos los esclavos.
+ * @param value Valor a escribir.
+ *
+ * @return SUCCESS si la trama se encoló, ERROR_QUEUE_FULL en caso contrario.
+ */
+ModbusApiError modbus_api_broadcast_write(uint16_t address, uint16_t value);
+
 #endif // MODBUS_API_H
\ No newline at end of file
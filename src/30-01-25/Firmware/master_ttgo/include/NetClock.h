@@ -0,0 +1,48 @@
+#ifndef NET_CLOCK_H
+#define NET_CLOCK_H
+
+#include <Arduino.h>
+#include <cstdint>
+
+// Reloj UNIX disciplinado con la hora de red (LoRaWAN DeviceTimeReq).
+// Cada sincronización ajusta el reloj del sistema (settimeofday) y, a partir de la
+// segunda, estima la deriva del cristal en ppm para corregir la hora entre
+// sincronizaciones. El estado vive en memoria RTC y el reloj del sistema sigue
+// contando en deep sleep, así que la hora sobrevive a un ciclo de sueño.
+#ifndef NET_CLOCK_RESYNC_S
+#define NET_CLOCK_RESYNC_S (6UL * 3600UL)    // Pedir hora de red cada 6 h
+#endif
+#define NET_CLOCK_DRIFT_WINDOW_S 3600        // Mínimo entre sincronizaciones para estimar deriva
+#define NET_CLOCK_MAX_DRIFT_PPM 200.0f
+
+// Bit 31 del timestamp de la trama: hora no sincronizada (los 31 bits bajos son
+// segundos desde el arranque). Las horas UNIX reales no llegan a 2^31 hasta 2038.
+#define TS_UNSYNCED_FLAG 0x80000000UL
+
+/**
+ * @brief Aplica una hora de red.
+ * @param unixSeconds Hora UNIX en el instante de la llamada.
+ */
+void net_clock_sync(uint32_t unixSeconds);
+
+/**
+ * @brief true si hubo al menos una sincronización (en este arranque o antes del deep sleep).
+ */
+bool net_clock_synced();
+
+/**
+ * @brief true si toca pedir la hora a la red (nunca sincronizado o última hace NET_CLOCK_RESYNC_S).
+ */
+bool net_clock_due();
+
+/**
+ * @brief Hora UNIX corregida por deriva, o segundos desde el arranque si no hay sincronización.
+ */
+uint32_t net_clock_now();
+
+/**
+ * @brief Timestamp para la trama: net_clock_now(), con TS_UNSYNCED_FLAG si no está sincronizado.
+ */
+uint32_t net_clock_frame_timestamp();
+
+#endif // NET_CLOCK_H
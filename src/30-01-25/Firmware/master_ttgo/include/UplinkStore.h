@@ -0,0 +1,76 @@
+#ifndef UPLINK_STORE_H
+#define UPLINK_STORE_H
+
+#include <Arduino.h>
+#include <cstdint>
+
+// Cola persistente de uplinks en LittleFS (store-and-forward).
+// Los fragmentos se guardan como registros [0xA5][len][crc16 hi][crc16 lo][datos]
+// en segmentos /uq/<n> de hasta UPLINK_STORE_SEGMENT_BYTES; la cabeza de lectura
+// (segmento, offset) se guarda en /uq/head tras cada confirmación, así un reinicio
+// retoma el envío donde quedó. Si se supera UPLINK_STORE_MAX_SEGMENTS se descarta
+// el segmento más antiguo.
+// Aparte, /uq/live guarda el carril en vivo (fragmentos aún sin confirmar que no
+// están en la cola); tras un reinicio sus fragmentos se pasan al final de la cola.
+// Uso desde una sola tarea (tareaLoRa): no hay bloqueo interno.
+#ifndef UPLINK_STORE_SEGMENT_BYTES
+#define UPLINK_STORE_SEGMENT_BYTES 8192
+#endif
+#ifndef UPLINK_STORE_MAX_SEGMENTS
+#define UPLINK_STORE_MAX_SEGMENTS 48     // 48 x 8 KB = 384 KB de cola
+#endif
+
+/**
+ * @brief Monta LittleFS y reconstruye el estado de la cola.
+ * @details Cuenta los registros pendientes desde la cabeza guardada. Los registros
+ * posteriores a uno corrupto (p. ej. corte de energía a mitad de escritura) en el
+ * mismo segmento se descartan; las escrituras nuevas empiezan siempre en un segmento nuevo.
+ * @return true si la cola está disponible, false si LittleFS no se pudo montar.
+ */
+bool uplink_store_init();
+
+/**
+ * @brief Añade un fragmento al final de la cola.
+ * @param data Bytes del fragmento.
+ * @param len Longitud (1-255).
+ * @return true si quedó escrito en flash.
+ */
+bool uplink_store_append(const uint8_t* data, size_t len);
+
+/**
+ * @brief Copia el fragmento más antiguo sin retirarlo.
+ * @param out Buffer de destino.
+ * @param max Tamaño del buffer.
+ * @param len Longitud del fragmento copiado.
+ * @return false si la cola está vacía.
+ */
+bool uplink_store_peek(uint8_t* out, size_t max, size_t* len);
+
+/**
+ * @brief Retira el fragmento devuelto por el último uplink_store_peek() y guarda la cabeza.
+ */
+void uplink_store_pop();
+
+/**
+ * @brief Sustituye la copia en flash del carril en vivo.
+ * @details LittleFS confirma el fichero al cerrarlo: un corte a mitad de escritura
+ * deja la copia anterior. uplink_store_init() pasa los fragmentos guardados al final
+ * de la cola, por lo que deben estar ya en la forma en que se enviarían desde ella.
+ * @param data Fragmentos, en orden de envío.
+ * @param lens Longitud de cada fragmento (1-255).
+ * @param count Número de fragmentos (0 = carril vacío).
+ * @return true si quedó escrito en flash.
+ */
+bool uplink_store_save_live(const uint8_t* const* data, const size_t* lens, size_t count);
+
+/**
+ * @brief Número de fragmentos pendientes.
+ */
+uint32_t uplink_store_count();
+
+/**
+ * @brief Fragmentos descartados por falta de espacio o corrupción desde el arranque.
+ */
+uint32_t uplink_store_dropped();
+
+#endif // UPLINK_STORE_H
@@ -162,4 +162,15 @@ ModbusApiResult modbus_api_read_registers(uint8_t slave_id, uint8_t function_cod
     // 5. Limpiar y devolver.
     vSemaphoreDelete(completion_sem);
     return result;
-}
\ No newline at end of file
+}
+
+ModbusApiError modbus_api_broadcast_write(uint16_t address, uint16_t value) {
+    // La librería antepone el ID 0; el cuerpo empieza en el código de función
+    uint8_t frame[5] = {
+        WRITE_HOLD_REGISTER,
+        (uint8_t)(address >> 8), (uint8_t)(address & 0xFF),
+        (uint8_t)(value >> 8),   (uint8_t)(value & 0xFF)
+    };
+    Error err = MB.addBroadcastMessage(frame, sizeof(frame));
+    return (err == Error::SUCCESS) ? ModbusApiError::SUCCESS : ModbusApiError::ERROR_QUEUE_FULL;
+}
@@ -0,0 +1,71 @@
+#include "NetClock.h"
+#include <sys/time.h>
+#include <esp_timer.h>
+
+// --- Estado (memoria RTC: sobrevive al deep sleep) ---
+
+RTC_DATA_ATTR static bool synced = false;
+RTC_DATA_ATTR static int64_t lastSyncUs = 0;    // Hora UNIX (us) de la última sincronización
+RTC_DATA_ATTR static float driftPpm = 0.0f;     // Adelanto de la red respecto al reloj local
+RTC_DATA_ATTR static uint32_t syncCount = 0;
+
+static int64_t localUs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return (int64_t)tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+// Hora local más la deriva acumulada desde la última sincronización
+static int64_t correctedUs(int64_t now) {
+    int64_t elapsed = now - lastSyncUs;
+    return now + (int64_t)((double)elapsed * driftPpm / 1e6);
+}
+
+// --- Implementación de las funciones públicas ---
+
+void net_clock_sync(uint32_t unixSeconds) {
+    int64_t now = localUs();
+    int64_t net = (int64_t)unixSeconds * 1000000LL;
+
+    if (synced) {
+        int64_t elapsed = now - lastSyncUs;
+        if (elapsed >= (int64_t)NET_CLOCK_DRIFT_WINDOW_S * 1000000LL) {
+            // Error residual tras la corrección actual; la red solo da segundos enteros,
+            // así que se promedia con peso 1/4 para no seguir el ruido de cuantización
+            float residualPpm = (float)((double)(net - correctedUs(now)) * 1e6 / elapsed);
+            driftPpm += residualPpm / 4.0f;
+            driftPpm = constrain(driftPpm, -NET_CLOCK_MAX_DRIFT_PPM, NET_CLOCK_MAX_DRIFT_PPM);
+        }
+        Serial.printf("[TIEMPO] Sincronizado: error %+lld ms, deriva %.1f ppm\n",
+                      (long long)((correctedUs(now) - net) / 1000), driftPpm);
+    } else {
+        Serial.printf("[TIEMPO] Primera sincronización: UNIX %u\n", unixSeconds);
+    }
+
+    struct timeval tv = {(time_t)unixSeconds, 0};
+    settimeofday(&tv, nullptr);
+    lastSyncUs = net;
+    synced = true;
+    syncCount++;
+}
+
+bool net_clock_synced() {
+    return synced;
+}
+
+bool net_clock_due() {
+    if (!synced) return true;
+    return localUs() - lastSyncUs >= (int64_t)NET_CLOCK_RESYNC_S * 1000000LL;
+}
+
+uint32_t net_clock_now() {
+    if (!synced) {
+        return (uint32_t)(esp_timer_get_time() / 1000000LL);
+    }
+    return (uint32_t)(correctedUs(localUs()) / 1000000LL);
+}
+
+uint32_t net_clock_frame_timestamp() {
+    uint32_t ts = net_clock_now();
+    return synced ? ts : (ts | TS_UNSYNCED_FLAG);
+}
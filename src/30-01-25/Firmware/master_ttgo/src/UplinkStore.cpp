@@ -0,0 +1,268 @@
+#include "UplinkStore.h"
+#include <LittleFS.h>
+#include <algorithm>
+#include <cctype>
+
+// --- Formato en flash (privado a este fichero) ---
+
+#define UPLINK_STORE_DIR "/uq"
+#define UPLINK_STORE_HEAD UPLINK_STORE_DIR "/head"
+#define UPLINK_STORE_LIVE UPLINK_STORE_DIR "/live"
+#define RECORD_MAGIC 0xA5
+#define RECORD_HEADER 4          // magic, len, crc16 (hi, lo)
+
+static bool storeReady = false;
+static uint32_t headSeg = 0;     // Segmento del registro más antiguo
+static uint32_t headOff = 0;     // Offset del registro más antiguo dentro de headSeg
+static uint32_t tailSeg = 0;     // Segmento donde se escribe
+static uint32_t pending = 0;     // Registros válidos pendientes
+static uint32_t dropped = 0;
+static size_t peekedLen = 0;     // Longitud del registro entregado por el último peek (0 = ninguno)
+static bool liveSaved = false;   // /uq/live tiene fragmentos
+
+static void segmentPath(uint32_t seg, char* path, size_t size) {
+    snprintf(path, size, UPLINK_STORE_DIR "/%lu", (unsigned long)seg);
+}
+
+// CRC-16/CCITT-FALSE
+static uint16_t crc16(const uint8_t* data, size_t len, uint16_t crc = 0xFFFF) {
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+// Lee el registro que empieza en 'off'. Devuelve la longitud de los datos,
+// 0 si se llegó al final del segmento o el registro está corrupto.
+static size_t readRecord(File& f, uint32_t off, uint8_t* out, size_t max) {
+    uint8_t hdr[RECORD_HEADER];
+    if (!f.seek(off) || f.read(hdr, RECORD_HEADER) != RECORD_HEADER) return 0;
+    size_t len = hdr[1];
+    if (hdr[0] != RECORD_MAGIC || len == 0) return 0;
+
+    uint8_t buf[255];
+    if (f.read(buf, len) != len) return 0;
+    uint16_t crc = crc16(buf, len, crc16(&hdr[1], 1));
+    if (crc != (uint16_t)((hdr[2] << 8) | hdr[3])) return 0;
+
+    if (out != nullptr) memcpy(out, buf, std::min(len, max));
+    return len;
+}
+
+// Registros válidos del segmento desde 'off' hasta el final o el primer registro corrupto
+static uint32_t countRecords(uint32_t seg, uint32_t off) {
+    char path[24];
+    segmentPath(seg, path, sizeof(path));
+    File f = LittleFS.open(path, "r");
+    if (!f) return 0;
+    uint32_t count = 0;
+    size_t len;
+    while ((len = readRecord(f, off, nullptr, 0)) > 0) {
+        off += RECORD_HEADER + len;
+        count++;
+    }
+    f.close();
+    return count;
+}
+
+static bool writeRecord(File& f, const uint8_t* data, size_t len) {
+    uint8_t hdr[RECORD_HEADER];
+    hdr[0] = RECORD_MAGIC;
+    hdr[1] = (uint8_t)len;
+    uint16_t crc = crc16(data, len, crc16(&hdr[1], 1));
+    hdr[2] = crc >> 8;
+    hdr[3] = crc & 0xFF;
+    return f.write(hdr, RECORD_HEADER) == RECORD_HEADER && f.write(data, len) == len;
+}
+
+static void saveHead() {
+    File f = LittleFS.open(UPLINK_STORE_HEAD, "w");
+    if (!f) return;
+    uint32_t head[2] = {headSeg, headOff};
+    f.write(reinterpret_cast<const uint8_t*>(head), sizeof(head));
+    f.close();
+}
+
+// Pasa la cabeza al segmento siguiente, borrando el actual
+static void dropHeadSegment() {
+    char path[24];
+    segmentPath(headSeg, path, sizeof(path));
+    LittleFS.remove(path);
+    headSeg++;
+    headOff = 0;
+    peekedLen = 0;
+    saveHead();
+}
+
+// Descarta los segmentos más antiguos hasta que headSeg..tailSeg quepa en el límite
+static void enforceSegmentCap() {
+    while (tailSeg - headSeg + 1 > UPLINK_STORE_MAX_SEGMENTS) {
+        uint32_t lost = countRecords(headSeg, headOff);
+        dropped += lost;
+        pending -= std::min(pending, lost);
+        Serial.printf("[UPLINK] Cola llena: %u fragmentos antiguos descartados\n", lost);
+        dropHeadSegment();
+    }
+}
+
+// --- Implementación de las funciones públicas ---
+
+bool uplink_store_init() {
+    if (!LittleFS.begin(true)) {
+        Serial.println("[UPLINK] LittleFS no disponible: la cola queda solo en RAM");
+        return false;
+    }
+    if (!LittleFS.exists(UPLINK_STORE_DIR)) {
+        LittleFS.mkdir(UPLINK_STORE_DIR);
+    }
+
+    // Rango de segmentos presentes (siempre consecutivos: solo se borra el más antiguo)
+    bool any = false;
+    uint32_t minSeg = UINT32_MAX, maxSeg = 0;
+    File dir = LittleFS.open(UPLINK_STORE_DIR);
+    File entry;
+    while ((entry = dir.openNextFile())) {
+        const char* name = strrchr(entry.name(), '/');
+        name = name ? name + 1 : entry.name();
+        bool isSegment = isdigit((unsigned char)name[0]);
+        uint32_t seg = strtoul(name, nullptr, 10);
+        entry.close();
+        if (!isSegment) continue; // "head", "live"
+        any = true;
+        minSeg = std::min(minSeg, seg);
+        maxSeg = std::max(maxSeg, seg);
+    }
+    dir.close();
+
+    headSeg = any ? minSeg : 0;
+    headOff = 0;
+    File hf = LittleFS.open(UPLINK_STORE_HEAD, "r");
+    if (hf) {
+        uint32_t head[2];
+        if (hf.read(reinterpret_cast<uint8_t*>(head), sizeof(head)) == sizeof(head) &&
+            any && head[0] >= minSeg && head[0] <= maxSeg) {
+            headSeg = head[0];
+            headOff = head[1];
+        }
+        hf.close();
+    }
+
+    pending = 0;
+    if (any) {
+        for (uint32_t seg = headSeg; seg <= maxSeg; seg++) {
+            pending += countRecords(seg, seg == headSeg ? headOff : 0);
+        }
+    }
+    // Tras un reinicio no se escribe detrás de un posible registro a medias
+    tailSeg = any ? maxSeg + 1 : 0;
+    peekedLen = 0;
+    // Cada arranque abre un segmento nuevo: el límite se aplica también aquí
+    enforceSegmentCap();
+    storeReady = true;
+
+    // Carril en vivo del arranque anterior: nada de él llegó a confirmarse
+    File lf = LittleFS.open(UPLINK_STORE_LIVE, "r");
+    if (lf) {
+        uint8_t buf[255];
+        uint32_t off = 0;
+        uint32_t recovered = 0;
+        size_t len;
+        while ((len = readRecord(lf, off, buf, sizeof(buf))) > 0) {
+            if (uplink_store_append(buf, len)) recovered++;
+            off += RECORD_HEADER + len;
+        }
+        lf.close();
+        LittleFS.remove(UPLINK_STORE_LIVE);
+        if (recovered > 0) {
+            Serial.printf("[UPLINK] %u fragmentos en vivo recuperados a la cola\n", recovered);
+        }
+    }
+    liveSaved = false;
+
+    Serial.printf("[UPLINK] Cola en flash: %u fragmentos pendientes (segmentos %u..%u)\n",
+                  pending, headSeg, tailSeg);
+    return true;
+}
+
+bool uplink_store_append(const uint8_t* data, size_t len) {
+    if (!storeReady || len == 0 || len > 255) return false;
+
+    char path[24];
+    segmentPath(tailSeg, path, sizeof(path));
+    File f = LittleFS.open(path, "a");
+    if (f && f.size() > 0 && f.size() + RECORD_HEADER + len > UPLINK_STORE_SEGMENT_BYTES) {
+        // Segmento lleno: se abre otro y, si no hay sitio, se sacrifica el más antiguo
+        f.close();
+        tailSeg++;
+        enforceSegmentCap();
+        segmentPath(tailSeg, path, sizeof(path));
+        f = LittleFS.open(path, "a");
+    }
+    if (!f) return false;
+
+    bool ok = writeRecord(f, data, len);
+    f.close();
+
+    if (ok) pending++;
+    return ok;
+}
+
+bool uplink_store_peek(uint8_t* out, size_t max, size_t* len) {
+    while (storeReady && pending > 0) {
+        char path[24];
+        segmentPath(headSeg, path, sizeof(path));
+        File f = LittleFS.open(path, "r");
+        size_t n = f ? readRecord(f, headOff, out, max) : 0;
+        if (f) f.close();
+        if (n > 0) {
+            *len = std::min(n, max);
+            peekedLen = n;
+            return true;
+        }
+        if (headSeg >= tailSeg) {
+            pending = 0; // Nada más que leer
+            break;
+        }
+        // Fin del segmento (o resto corrupto): al siguiente
+        dropHeadSegment();
+    }
+    return false;
+}
+
+void uplink_store_pop() {
+    if (!storeReady || peekedLen == 0) return;
+    headOff += RECORD_HEADER + peekedLen;
+    peekedLen = 0;
+    if (pending > 0) pending--;
+    saveHead();
+}
+
+bool uplink_store_save_live(const uint8_t* const* data, const size_t* lens, size_t count) {
+    if (!storeReady) return false;
+    if (count == 0) {
+        if (liveSaved) LittleFS.remove(UPLINK_STORE_LIVE);
+        liveSaved = false;
+        return true;
+    }
+
+    File f = LittleFS.open(UPLINK_STORE_LIVE, "w");
+    if (!f) return false;
+    bool ok = true;
+    for (size_t i = 0; i < count && ok; i++) {
+        ok = lens[i] > 0 && lens[i] <= 255 && writeRecord(f, data[i], lens[i]);
+    }
+    f.close();
+    liveSaved = true;
+    return ok;
+}
+
+uint32_t uplink_store_count() {
+    return pending;
+}
+
+uint32_t uplink_store_dropped() {
+    return dropped;
+}
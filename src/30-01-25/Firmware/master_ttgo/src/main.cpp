@@ -13,19 +13,25 @@
 #include <vector>
 #include <cstdint>      ///< Necesario para definiciones de tipos enteros de tamaño fijo (uint8_t, etc).
 #include <map>          ///< Estructura de datos para mapeo de sensores.
+#include <set>
 #include <ctime>        ///< Utilizado para la generación de timestamps UNIX.
 #include <cstring>      ///< Utilidades de memoria (memcpy).
 #include <algorithm>
 #include "ModbusClientRTU.h"
 #include "ModbusAPI.h"
+#include "UplinkStore.h"
+#include "NetClock.h"
+#include "QuantCodec.h"
 
 // =================================================================================================
 // Forward Declarations
 // =================================================================================================
 bool discoverDeviceSensors(uint8_t deviceId);
-static bool formatAndEnqueueSensorData(const ModbusApiResult& response, uint8_t slaveId, uint8_t sensorId);
+static bool formatAndEnqueueSensorData(const uint8_t* data, size_t dataLen, uint16_t numRegs,
+                                       uint8_t samplesPerChannel, uint8_t slaveId, uint8_t sensorId);
 void parseAndStoreDiscoveryResponse(const uint8_t* data, size_t length, uint8_t slaveId);
 bool getSensorParams(uint8_t slaveId, uint8_t sensorID, uint16_t& startAddr, uint16_t& numRegs);
+uint8_t getRegistersPerChannel(uint8_t slaveId, uint8_t sensorID);
 void refreshSystemContext();
 
 // =================================================================================================
@@ -57,11 +63,139 @@ typedef struct {
     uint16_t startAddress;      ///< Initial Modbus register address.
     uint16_t maxRegisters;      ///< Total number of registers to read.
     uint16_t samplingInterval;  ///< Base sampling interval in milliseconds.
-    uint8_t dataType;           ///< Data type: 1=uint8, 2=uint16, 3=compressed bytes, 4=float16.
+    uint8_t dataType;           ///< Data type: 1=uint8, 2=uint16, 3=compressed bytes, 4=float16, 5=window summary, 6=uint16 delta-coded, 7=scaled int8/int16.
     uint8_t scale;              ///< Decimal scale factor (10^scale).
-    uint8_t compressedBytes;    ///< Number of bytes per value if compression is used (dataType=3).
+    uint8_t compressedBytes;    ///< Bits per value (dataType=3; > 0 enables packing, see BITPACK_AUTO_WIDTH), or maximum error in register counts (dataType=4, 7).
+    int8_t seqWindow;           ///< Sequence window support: -1 unknown, 0 no (legacy block), 1 yes.
+    uint16_t windowAddress;     ///< First register of the sensor's sequence window.
+    uint32_t lastSeq;           ///< Sequence number of the last sample forwarded (0 = none).
+    uint32_t missedSamples;     ///< Samples overwritten on the slave before we could read them.
 } ModbusSensorParam;
 
+/**
+ * @def SEQ_WINDOW_ADDRESS
+ * @brief Base address of the slaves' sequence windows (one per sensor, SEQ_WINDOW_STRIDE apart).
+ * @details Header: [seq hi][seq lo][depth H][channels C], then H slots of C registers;
+ * sample @c s lives in slot <tt>s % H</tt>.
+ * @ingroup group_modbus_discovery
+ */
+#define SEQ_WINDOW_ADDRESS 1000
+#define SEQ_WINDOW_STRIDE 100
+#define SEQ_WINDOW_HEADER 4
+
+/**
+ * @def DATA_TYPE_SUMMARY
+ * @brief Descriptor dataType of a per-window statistical summary.
+ * @details The block holds, per channel, [min, max, mean, stddev, p95] as uint16 over the
+ * last closed window of samplingInterval ms. It changes once per window, so it is polled
+ * at samplingInterval instead of samplingInterval * registers per channel, and it is
+ * never part of the latch bank.
+ * @ingroup group_modbus_discovery
+ */
+#define DATA_TYPE_SUMMARY 5
+
+/**
+ * @def DATA_TYPE_DELTA
+ * @brief Descriptor dataType of a uint16 history forwarded delta-coded.
+ * @details Each block is sent as [mode][first value of each channel, 2B][deltas
+ * channel-major]. Deltas are zig-zag mapped and written either as varints (mode 0)
+ * or as fixed-width fields of mode - 1 bits packed MSB first (BitPacker), whichever
+ * is smaller for that block. The len byte carries LEN_FLAG_DELTA. If neither beats
+ * the plain uint16 block, the block is sent plain without the flag.
+ * @ingroup group_data_format
+ */
+#define DATA_TYPE_DELTA 6
+#define LEN_FLAG_DELTA 0x20   ///< Len byte bit 5: block is delta-coded (bit 6 = 2BIT, bit 7 = PKD).
+
+/**
+ * @def DATA_TYPE_FLOAT16
+ * @brief Descriptor dataType of a channel forwarded as IEEE 754 half floats.
+ * @details Values are register / 10^scale. If some value would be off by more than
+ * compressedBytes register counts (0 = no bound), the block is sent as plain uint16.
+ * @ingroup group_data_format
+ */
+#define DATA_TYPE_FLOAT16 4
+
+/**
+ * @def DATA_TYPE_SCALED
+ * @brief Descriptor dataType of a channel forwarded as scaled int8/int16 codes.
+ * @details Values are register / 10^scale, rounded to the largest power-of-ten step that
+ * keeps the error within compressedBytes register counts (0 = lossless). Each block picks
+ * int8 or int16, with an offset when it pays off (QuantCodec.h).
+ * @ingroup group_data_format
+ */
+#define DATA_TYPE_SCALED 7
+
+/**
+ * @def LEN_FLAG_QUANT
+ * @brief Len byte bits 5 and 6 together: the block is quantized (DATA_TYPE_FLOAT16 or
+ * DATA_TYPE_SCALED) and starts with its QuantCodec.h codec byte.
+ * @details Delta blocks are always uint16, so DELTA | 2BIT is otherwise never sent.
+ * @ingroup group_data_format
+ */
+#define LEN_FLAG_QUANT (LEN_FLAG_DELTA | 0x40)
+
+/**
+ * @def BITPACK_AUTO_WIDTH
+ * @brief Bit-packed blocks (dataType=3) pick their own width per block (1 = enabled).
+ * @details Instead of packing every value at compressedBytes bits, the block is sent as
+ * [header][base 2B if PACK_FLAG_BASE][(value - base) at width bits, MSB first], header
+ * bits 0-4 = width (0-16; 0 = every value equals the base). The block minimum is used as
+ * base only when its 2 bytes are paid back by the narrower fields. The len byte carries
+ * LEN_FLAG_PACKED. With 0 the block is packed at compressedBytes bits with no header
+ * and no flag, and the decoder needs the width from the descriptor.
+ * @ingroup group_data_format
+ */
+#ifndef BITPACK_AUTO_WIDTH
+#define BITPACK_AUTO_WIDTH 1
+#endif
+#define LEN_FLAG_PACKED 0x80  ///< Len byte bit 7 (PKD): block is bit-packed with its own width header.
+#define PACK_FLAG_BASE 0x80   ///< Width header bit 7: a 2-byte base follows.
+
+/**
+ * @def DESCRIPTOR_TABLE_ADDRESS
+ * @brief Versioned discovery table: [(version << 8) | count][descriptor 0][descriptor 1]...
+ * @details Each descriptor has DESCRIPTOR_REGS registers in the same format as the
+ * classic descriptor at address 0. The table is read in one block sized for
+ * DISCOVERY_TABLE_MAX_SENSORS descriptors (what fits in one API response).
+ * @ingroup group_modbus_discovery
+ */
+/**
+ * @def SYNC_LATCH
+ * @brief Coherent multi-slave snapshots via a broadcast latch (1 = enabled).
+ * @details When a scheduler batch touches more than one slave, the master first
+ * broadcasts a FC06 write of a token to LATCH_REGISTER. Every slave freezes its
+ * published values into the bank at LATCH_BANK_ADDRESS, and the batch is read
+ * from there instead of from the live registers.
+ * Bank layout: [token][seq hi, seq lo per sensor]... (LATCH_HEADER_REGS), then a
+ * copy of the data blocks: the latched block of a sensor is at startAddress +
+ * LATCH_BANK_OFFSET.
+ * @ingroup group_modbus_discovery
+ */
+#ifndef SYNC_LATCH
+#define SYNC_LATCH 1
+#endif
+#define LATCH_REGISTER 900
+#define LATCH_BANK_ADDRESS 500
+#define LATCH_HEADER_REGS 10
+#define LATCH_BANK_OFFSET 500
+#define LATCH_MAX_SENSORS ((LATCH_HEADER_REGS - 1) / 2)
+
+/**
+ * @struct LatchSnapshot
+ * @brief Header of a slave's latch bank, read once per latched batch.
+ * @ingroup group_modbus_discovery
+ */
+struct LatchSnapshot {
+    bool valid;                       ///< The bank holds the token of this batch.
+    uint32_t seq[LATCH_MAX_SENSORS];  ///< Sequence of each sensor (table order) at the latch.
+};
+
+#define DESCRIPTOR_TABLE_ADDRESS 200
+#define DESCRIPTOR_TABLE_VERSION 1
+#define DESCRIPTOR_REGS 8
+#define DISCOVERY_TABLE_MAX_SENSORS ((MODBUS_API_MAX_DATA_SIZE / 2 - 1) / DESCRIPTOR_REGS)
+
 /**
  * @struct ModbusSlaveParam
  * @brief Represents a physical slave device on the RS485 bus.
@@ -71,6 +205,7 @@ struct ModbusSlaveParam {
     uint8_t slaveID;                        ///< Modbus address of the slave (1-247).
     std::vector<ModbusSensorParam> sensors; ///< Vector with the sensors associated with this slave.
     uint8_t consecutiveFails;               ///< Counter of consecutive failures for error handling.
+    int8_t latchSupport;                    ///< Broadcast latch support: -1 unknown, 0 no, 1 yes.
 };
 
 ///< Global vector that stores the configuration and state of all discovered Modbus slaves.
@@ -114,6 +249,18 @@ static inline uint32_t alignNextSampleTime(uint32_t now, uint32_t epoch, uint32_
     return epoch + k * interval;
 }
 
+// Intervalo de sondeo: el bloque de datos guarda maxRegisters/numberOfChannels muestras
+// por canal, así que basta con leerlo cada samplingInterval * ese número. Un resumen
+// cambia una vez por ventana.
+static uint32_t sensorPollInterval(const ModbusSensorParam& sensor) {
+    uint32_t calculatedInterval = sensor.samplingInterval;
+    if (sensor.dataType != DATA_TYPE_SUMMARY && sensor.numberOfChannels > 0 && sensor.maxRegisters > 0) {
+        uint16_t registersPerChannel = sensor.maxRegisters / sensor.numberOfChannels;
+        calculatedInterval = (uint32_t)sensor.samplingInterval * registersPerChannel;
+    }
+    return calculatedInterval;
+}
+
 /**
  * @brief Initializes or updates the scheduling list (Scheduler).
  * @details Iterates through `slaveList`, calculates effective intervals based on channels and registers,
@@ -134,13 +281,7 @@ void initScheduler() {
 
         for (const auto& slave : slaveList) {
             for (const auto& sensor : slave.sensors) {
-                
-
-                uint32_t calculatedInterval = sensor.samplingInterval; 
-                if (sensor.numberOfChannels > 0 && sensor.maxRegisters > 0) {
-                     uint16_t registersPerChannel = sensor.maxRegisters / sensor.numberOfChannels;
-                     calculatedInterval = (uint32_t)sensor.samplingInterval * registersPerChannel;
-                }
+                uint32_t calculatedInterval = sensorPollInterval(sensor);
 
                 uint32_t now = millis();
                 uint32_t nextAligned = alignNextSampleTime(now, schedulerEpochMs, calculatedInterval);
@@ -173,20 +314,172 @@ static void flushUartRx(HardwareSerial& s) {
     while (s.available() > 0) { (void)s.read(); }
 }
 
+/**
+ * @brief Busca los parámetros (mutables) de un sensor descubierto.
+ */
+static ModbusSensorParam* findSensorParam(uint8_t slaveId, uint8_t sensorID) {
+    auto slaveIt = std::find_if(slaveList.begin(), slaveList.end(),
+        [&](const ModbusSlaveParam& s) { return s.slaveID == slaveId; });
+    if (slaveIt == slaveList.end()) return nullptr;
+
+    auto sensorIt = std::find_if(slaveIt->sensors.begin(), slaveIt->sensors.end(),
+        [&](const ModbusSensorParam& sensor) { return sensor.sensorID == sensorID; });
+    return (sensorIt != slaveIt->sensors.end()) ? &(*sensorIt) : nullptr;
+}
+
+/**
+ * @brief Lectura incremental: solo las muestras con secuencia posterior a lastSeq.
+ * @details Lee la cabecera de la ventana por secuencia y luego las ranuras nuevas
+ * (una lectura, o dos si el anillo da la vuelta). Los registros se devuelven
+ * ordenados por canal, igual que el bloque clásico.
+ * @param regs Salida: bytes big-endian, canal 0 completo, luego canal 1, ...
+ * @param samplesPerChannel Salida: muestras nuevas por canal (0 = nada nuevo).
+ * @param upToSeq Si no es 0, última secuencia a entregar (la congelada por el latch).
+ * @return SUCCESS, o el error de la lectura. Si el esclavo no tiene ventana
+ *         (excepción Modbus) se marca seqWindow = 0 y se devuelve ERROR_NOT_FOUND.
+ */
+static ModbusApiError readSinceSequence(uint8_t slaveId, ModbusSensorParam& p,
+                                        std::vector<uint8_t>& regs, uint8_t& samplesPerChannel,
+                                        uint32_t upToSeq = 0) {
+    samplesPerChannel = 0;
+    regs.clear();
+
+    ModbusApiResult hdr = modbus_api_read_registers(slaveId, READ_HOLD_REGISTER, p.windowAddress,
+                                                    SEQ_WINDOW_HEADER, 2000);
+    if (hdr.error_code == ModbusApiError::ERROR_MODBUS_EXCEPTION) {
+        Serial.printf("Esclavo %u sensor %u sin ventana por secuencia: lectura clásica.\n", slaveId, p.sensorID);
+        p.seqWindow = 0;
+        return ModbusApiError::ERROR_NOT_FOUND;
+    }
+    if (hdr.error_code != ModbusApiError::SUCCESS) return hdr.error_code;
+    if (hdr.data_len < SEQ_WINDOW_HEADER * 2) return ModbusApiError::ERROR_INTERNAL;
+
+    uint32_t seq = ((uint32_t)hdr.data[0] << 24) | ((uint32_t)hdr.data[1] << 16) |
+                   ((uint32_t)hdr.data[2] << 8) | hdr.data[3];
+    uint16_t depth = (hdr.data[4] << 8) | hdr.data[5];
+    uint16_t channels = (hdr.data[6] << 8) | hdr.data[7];
+    if (depth < 2 || channels == 0 || channels != p.numberOfChannels) {
+        p.seqWindow = 0;
+        return ModbusApiError::ERROR_NOT_FOUND;
+    }
+    p.seqWindow = 1;
+
+    if (seq < p.lastSeq) {
+        Serial.printf("Esclavo %u sensor %u: secuencia reiniciada (%u < %u).\n",
+                      slaveId, p.sensorID, seq, p.lastSeq);
+        p.lastSeq = 0;
+    }
+
+    // Se deja una ranura de margen: el esclavo puede publicar entre cabecera y datos
+    uint32_t maxNew = depth - 1;
+
+    // Corte en la secuencia del latch, si sus ranuras siguen en el anillo
+    if (upToSeq != 0 && upToSeq < seq && seq - upToSeq < maxNew && upToSeq >= p.lastSeq) {
+        maxNew -= seq - upToSeq;
+        seq = upToSeq;
+    }
+    uint32_t perRead = (MODBUS_API_MAX_DATA_SIZE / 2) / channels;
+    if (perRead < maxNew) maxNew = perRead;
+    if (maxNew > 0x1F) maxNew = 0x1F; // El byte de longitud del payload tiene 5 bits
+
+    uint32_t fresh = seq - p.lastSeq;
+    if (p.lastSeq != 0 && fresh > maxNew) {
+        uint32_t missed = fresh - maxNew;
+        p.missedSamples += missed;
+        Serial.printf("Esclavo %u sensor %u: HUECO de %u muestras (total %u).\n",
+                      slaveId, p.sensorID, missed, p.missedSamples);
+    }
+    if (fresh > maxNew) fresh = maxNew;
+    if (fresh == 0) return ModbusApiError::SUCCESS;
+
+    // Ranuras [first, seq] en orden; como máximo dos tramos contiguos
+    uint32_t first = seq - fresh + 1;
+    uint16_t slot = first % depth;
+    uint16_t n1 = std::min<uint32_t>(fresh, depth - slot);
+    uint16_t n2 = fresh - n1;
+
+    std::vector<uint8_t> raw;
+    raw.reserve(fresh * channels * 2);
+    ModbusApiResult part = modbus_api_read_registers(slaveId, READ_HOLD_REGISTER,
+        p.windowAddress + SEQ_WINDOW_HEADER + slot * channels, n1 * channels, 2000);
+    if (part.error_code != ModbusApiError::SUCCESS) return part.error_code;
+    raw.insert(raw.end(), part.data, part.data + part.data_len);
+    if (n2 > 0) {
+        part = modbus_api_read_registers(slaveId, READ_HOLD_REGISTER,
+            p.windowAddress + SEQ_WINDOW_HEADER, n2 * channels, 2000);
+        if (part.error_code != ModbusApiError::SUCCESS) return part.error_code;
+        raw.insert(raw.end(), part.data, part.data + part.data_len);
+    }
+    if (raw.size() < (size_t)fresh * channels * 2) return ModbusApiError::ERROR_INTERNAL;
+
+    // Muestra-mayor (ranura = C canales) -> canal-mayor (como el bloque clásico)
+    regs.resize(fresh * channels * 2);
+    for (uint32_t i = 0; i < fresh; i++) {
+        for (uint16_t ch = 0; ch < channels; ch++) {
+            size_t src = (i * channels + ch) * 2;
+            size_t dst = (ch * fresh + i) * 2;
+            regs[dst] = raw[src];
+            regs[dst + 1] = raw[src + 1];
+        }
+    }
+
+    p.lastSeq = seq;
+    samplesPerChannel = (uint8_t)fresh;
+    return ModbusApiError::SUCCESS;
+}
+
+/**
+ * @brief Lee la cabecera del banco congelado de un esclavo tras un latch.
+ * @param token Token enviado en el broadcast de este lote.
+ * @return Snapshot con valid = false si el esclavo no tiene latch o perdió el broadcast.
+ */
+static LatchSnapshot readLatchHeader(ModbusSlaveParam& slave, uint16_t token) {
+    LatchSnapshot snap = {};
+    if (slave.latchSupport == 0) return snap;
+
+    ModbusApiResult hdr = modbus_api_read_registers(slave.slaveID, READ_HOLD_REGISTER,
+                                                    LATCH_BANK_ADDRESS, LATCH_HEADER_REGS, 2000);
+    if (hdr.error_code == ModbusApiError::ERROR_MODBUS_EXCEPTION) {
+        Serial.printf("Esclavo %u sin latch: lecturas en vivo.\n", slave.slaveID);
+        slave.latchSupport = 0;
+        return snap;
+    }
+    if (hdr.error_code != ModbusApiError::SUCCESS || hdr.data_len < LATCH_HEADER_REGS * 2) {
+        return snap;
+    }
+    slave.latchSupport = 1;
+
+    uint16_t bankToken = (hdr.data[0] << 8) | hdr.data[1];
+    if (bankToken != token) {
+        Serial.printf("Esclavo %u: latch perdido (token %u, esperado %u). Lectura en vivo.\n",
+                      slave.slaveID, bankToken, token);
+        return snap;
+    }
+    for (int k = 0; k < LATCH_MAX_SENSORS; k++) {
+        const uint8_t* d = hdr.data + 2 + k * 4;
+        snap.seq[k] = ((uint32_t)d[0] << 24) | ((uint32_t)d[1] << 16) | ((uint32_t)d[2] << 8) | d[3];
+    }
+    snap.valid = true;
+    return snap;
+}
+
 /**
  * @brief Procesa una solicitud de muestreo para un sensor específico.
- * @details Realiza la lectura Modbus, formatea los datos en caso de éxito,
- * o gestiona el contador de fallos en caso de error.
+ * @details Si el esclavo expone ventana por secuencia se piden solo las muestras
+ * nuevas; si no, se lee el bloque completo como antes. Formatea los datos en caso
+ * de éxito, o gestiona el contador de fallos en caso de error.
+ * Con un latch válido se lee lo congelado en el instante del broadcast.
  * @param item El elemento del planificador a procesar.
+ * @param latch Cabecera del banco congelado del esclavo, o nullptr para leer en vivo.
  * @return true si el esclavo asociado sigue activo, false si fue eliminado por fallos.
  */
-bool handleScheduledSensor(const SensorSchedule& item) {
+bool handleScheduledSensor(const SensorSchedule& item, const LatchSnapshot* latch = nullptr) {
     const uint8_t MAX_CONSECUTIVE_FAILS = 3;
 
     Serial.printf("Solicitando muestreo: SlaveID=%u, SensorID=%u\n", item.slaveID, item.sensorID);
 
-    uint16_t startAddr, numRegs;
-    if (!getSensorParams(item.slaveID, item.sensorID, startAddr, numRegs)) {
+    ModbusSensorParam* params = findSensorParam(item.slaveID, item.sensorID);
+    if (params == nullptr) {
         Serial.printf("Error: No se encontraron parámetros para Esclavo %u, Sensor %u.\n", item.slaveID, item.sensorID);
         return true;
     }
@@ -194,7 +487,35 @@ bool handleScheduledSensor(const SensorSchedule& item) {
     // IMPORTANTE: limpiar basura antes de una nueva transacción Modbus
     flushUartRx(Serial2);
 
-    ModbusApiResult result = modbus_api_read_registers(item.slaveID, READ_HOLD_REGISTER, startAddr, numRegs, 2000);
+    ModbusApiError err = ModbusApiError::ERROR_NOT_FOUND;
+    std::vector<uint8_t> regs;
+    uint8_t samplesPerChannel = 0;
+    uint16_t numRegs = 0;
+
+    bool latched = (latch != nullptr && latch->valid);
+    uint32_t upToSeq = 0;
+    if (latched) {
+        uint16_t k = (params->windowAddress - SEQ_WINDOW_ADDRESS) / SEQ_WINDOW_STRIDE;
+        if (k < LATCH_MAX_SENSORS) upToSeq = latch->seq[k];
+    }
+
+    if (params->seqWindow != 0) {
+        err = readSinceSequence(item.slaveID, *params, regs, samplesPerChannel, upToSeq);
+        numRegs = samplesPerChannel * params->numberOfChannels;
+    }
+    if (err == ModbusApiError::ERROR_NOT_FOUND) {
+        // Esclavo sin ventana: bloque completo (comportamiento clásico), congelado si hubo latch
+        bool fromBank = latched && params->dataType != DATA_TYPE_SUMMARY;
+        uint16_t addr = params->startAddress + (fromBank ? LATCH_BANK_OFFSET : 0);
+        ModbusApiResult result = modbus_api_read_registers(item.slaveID, READ_HOLD_REGISTER,
+                                                           addr, params->maxRegisters, 2000);
+        err = result.error_code;
+        if (err == ModbusApiError::SUCCESS) {
+            regs.assign(result.data, result.data + result.data_len);
+            numRegs = params->maxRegisters;
+            samplesPerChannel = getRegistersPerChannel(item.slaveID, item.sensorID);
+        }
+    }
 
     auto slaveIt = std::find_if(slaveList.begin(), slaveList.end(), [&](const ModbusSlaveParam& s) { return s.slaveID == item.slaveID; });
     if (slaveIt == slaveList.end()) {
@@ -202,11 +523,16 @@ bool handleScheduledSensor(const SensorSchedule& item) {
         return false;
     }
 
-    if (result.error_code == ModbusApiError::SUCCESS) {
-        formatAndEnqueueSensorData(result, item.slaveID, item.sensorID);
+    if (err == ModbusApiError::SUCCESS) {
+        if (numRegs > 0) {
+            formatAndEnqueueSensorData(regs.data(), regs.size(), numRegs, samplesPerChannel,
+                                       item.slaveID, item.sensorID);
+        } else {
+            Serial.printf("Esclavo %u, Sensor %u: sin muestras nuevas.\n", item.slaveID, item.sensorID);
+        }
         slaveIt->consecutiveFails = 0;
     } else {
-        Serial.printf("Error en muestreo para Esclavo %u, Sensor %u. Código: %u\n", item.slaveID, item.sensorID, static_cast<uint8_t>(result.error_code));
+        Serial.printf("Error en muestreo para Esclavo %u, Sensor %u. Código: %u\n", item.slaveID, item.sensorID, static_cast<uint8_t>(err));
         slaveIt->consecutiveFails++;
         Serial.printf("Fallo consecutivo %u para esclavo %u.\n", slaveIt->consecutiveFails, item.slaveID);
         
@@ -308,8 +634,28 @@ void DataRequestScheduler(void *pvParameters) {
         }
 
         // 2) Fuera del mutex: ejecutar I/O (Modbus). Si algún esclavo cae, marcar rebuild.
+        // Con varios esclavos en el lote, un latch por broadcast congela a todos en el mismo instante.
+        std::map<uint8_t, LatchSnapshot> latches;
+#if SYNC_LATCH
+        std::set<uint8_t> dueSlaves;
+        for (const auto& item : dueItems) dueSlaves.insert(item.slaveID);
+        if (dueSlaves.size() > 1) {
+            static uint16_t latchToken = 0;
+            if (++latchToken == 0) latchToken = 1; // 0 = banco nunca congelado
+            flushUartRx(Serial2);
+            if (modbus_api_broadcast_write(LATCH_REGISTER, latchToken) == ModbusApiError::SUCCESS) {
+                for (auto& slave : slaveList) {
+                    if (dueSlaves.count(slave.slaveID)) {
+                        latches[slave.slaveID] = readLatchHeader(slave, latchToken);
+                    }
+                }
+            }
+        }
+#endif
         for (const auto& item : dueItems) {
-            if (!handleScheduledSensor(item)) {
+            auto latchIt = latches.find(item.slaveID);
+            const LatchSnapshot* latch = (latchIt != latches.end()) ? &latchIt->second : nullptr;
+            if (!handleScheduledSensor(item, latch)) {
                 if (xSemaphoreTake(schedulerMutex, portMAX_DELAY) == pdTRUE) {
                     auto scheduleIt = std::remove_if(scheduleList.begin(), scheduleList.end(),
                         [&](const SensorSchedule& s) { return s.slaveID == item.slaveID; });
@@ -378,19 +724,13 @@ uint8_t getRegistersPerChannel(uint8_t slaveId, uint8_t sensorID) {
 }
 
 /**
- * @brief Parses the discovery response and updates the slave list.
- * @details Decodes the 8 parameter registers and creates or updates the entry in `slaveList`.
- * @param response Raw data received.
- * @param slaveId ID of the slave that responded.
+ * @brief Decodes one 8-register discovery descriptor.
+ * @param data 16 bytes: sensorID, channels, startAddress, maxRegisters,
+ *             samplingInterval, dataType, scale, compressedBytes.
+ * @param index Position of the descriptor in the slave's table (selects its sequence window).
  * @ingroup group_modbus_discovery
  */
-void parseAndStoreDiscoveryResponse(const uint8_t* data, size_t length, uint8_t slaveId) {
-    // Se esperan 8 registros, que son 16 bytes de datos.
-    if (length < 16) {
-        Serial.printf("Error: Respuesta de descubrimiento incompleta para esclavo %u. Se esperaban 16 bytes, se recibieron %u.\n", slaveId, length);
-        return;
-    }
-
+static ModbusSensorParam decodeDescriptor(const uint8_t* data, uint8_t index) {
     ModbusSensorParam newSensor;
     // Los datos de la API ya no tienen la cabecera Modbus, empiezan en el byte 0.
     newSensor.sensorID          = data[1];  // Reg 0: sensorID (byte bajo)
@@ -401,50 +741,139 @@ void parseAndStoreDiscoveryResponse(const uint8_t* data, size_t length, uint8_t
     newSensor.dataType          = data[11]; // Reg 5: dataType (byte bajo)
     newSensor.scale             = data[13]; // Reg 6: scale (byte bajo)
     newSensor.compressedBytes   = data[15]; // Reg 7: compressedBytes (byte bajo)
+    // Se detecta en la primera lectura; un resumen no tiene ventana de secuencia
+    newSensor.seqWindow         = (newSensor.dataType == DATA_TYPE_SUMMARY) ? 0 : -1;
+    newSensor.windowAddress     = SEQ_WINDOW_ADDRESS + index * SEQ_WINDOW_STRIDE;
+    newSensor.lastSeq           = 0;
+    newSensor.missedSamples     = 0;
+    return newSensor;
+}
 
-    Serial.printf("Sensor descubierto en esclavo %u: ID=%u, Canales=%u, Addr=%u, Regs=%u, Intervalo=%u ms\n",
-        slaveId, newSensor.sensorID, newSensor.numberOfChannels, newSensor.startAddress, newSensor.maxRegisters, newSensor.samplingInterval);
+/**
+ * @brief Replaces the sensor list of a slave with the discovered one.
+ * @details Sensors that keep the same ID and sequence window keep their
+ * sequence state, so re-discovery does not resend or lose samples. Sensors
+ * that are no longer advertised are dropped.
+ * @ingroup group_modbus_discovery
+ */
+static void storeDiscoveredSensors(uint8_t slaveId, std::vector<ModbusSensorParam>& found) {
+    for (const auto& sensor : found) {
+        Serial.printf("Sensor descubierto en esclavo %u: ID=%u, Canales=%u, Addr=%u, Regs=%u, Intervalo=%u ms\n",
+            slaveId, sensor.sensorID, sensor.numberOfChannels, sensor.startAddress, sensor.maxRegisters, sensor.samplingInterval);
+    }
 
     // Buscar si el esclavo ya existe en la lista
     auto slaveIt = std::find_if(slaveList.begin(), slaveList.end(),
         [&](const ModbusSlaveParam& s) { return s.slaveID == slaveId; });
 
     if (slaveIt != slaveList.end()) {
-        // El esclavo ya existe. Buscar si el sensor ya está registrado.
-        auto sensorIt = std::find_if(slaveIt->sensors.begin(), slaveIt->sensors.end(),
-            [&](const ModbusSensorParam& s) { return s.sensorID == newSensor.sensorID; });
-
-        if (sensorIt != slaveIt->sensors.end()) {
-            // El sensor ya existe, sobreescribir sus parámetros.
-            *sensorIt = newSensor;
-            Serial.printf("Parámetros del sensor %u actualizados para el esclavo %u.\n", newSensor.sensorID, slaveId);
-        } else {
-            // El sensor no existe, añadirlo a la lista de sensores del esclavo.
-            slaveIt->sensors.push_back(newSensor);
-            Serial.printf("Nuevo sensor %u añadido al esclavo %u.\n", newSensor.sensorID, slaveId);
+        // El esclavo ya existe: conservar el estado de secuencia de los sensores que siguen igual
+        for (auto& sensor : found) {
+            auto sensorIt = std::find_if(slaveIt->sensors.begin(), slaveIt->sensors.end(),
+                [&](const ModbusSensorParam& s) { return s.sensorID == sensor.sensorID; });
+            if (sensorIt != slaveIt->sensors.end() && sensorIt->windowAddress == sensor.windowAddress &&
+                sensorIt->numberOfChannels == sensor.numberOfChannels) {
+                sensor.seqWindow     = sensorIt->seqWindow;
+                sensor.lastSeq       = sensorIt->lastSeq;
+                sensor.missedSamples = sensorIt->missedSamples;
+            }
         }
+        slaveIt->sensors = found;
+        Serial.printf("Parámetros del esclavo %u actualizados (%u sensores).\n", slaveId, (unsigned)found.size());
     } else {
-        // El esclavo no existe, crearlo y añadir el sensor.
+        // El esclavo no existe, crearlo con todos sus sensores.
         ModbusSlaveParam newSlave;
         newSlave.slaveID = slaveId;
         newSlave.consecutiveFails = 0;
-        newSlave.sensors.push_back(newSensor);
+        newSlave.latchSupport = -1;
+        newSlave.sensors = found;
         slaveList.push_back(newSlave);
-        Serial.printf("Nuevo esclavo %u añadido a la lista con sensor %u.\n", slaveId, newSensor.sensorID);
+        Serial.printf("Nuevo esclavo %u añadido a la lista con %u sensores.\n", slaveId, (unsigned)found.size());
+    }
+}
+
+/**
+ * @brief Parses the discovery response and updates the slave list.
+ * @details Decodes the 8 parameter registers of the classic descriptor (address 0)
+ * and creates or updates the entry in `slaveList`.
+ * @param response Raw data received.
+ * @param slaveId ID of the slave that responded.
+ * @ingroup group_modbus_discovery
+ */
+void parseAndStoreDiscoveryResponse(const uint8_t* data, size_t length, uint8_t slaveId) {
+    // Se esperan 8 registros, que son 16 bytes de datos.
+    if (length < 16) {
+        Serial.printf("Error: Respuesta de descubrimiento incompleta para esclavo %u. Se esperaban 16 bytes, se recibieron %u.\n", slaveId, length);
+        return;
     }
+
+    std::vector<ModbusSensorParam> found;
+    found.push_back(decodeDescriptor(data, 0));
+    storeDiscoveredSensors(slaveId, found);
+}
+
+/**
+ * @brief Parses a versioned descriptor table and updates the slave list.
+ * @details Layout: register 0 = (version << 8) | count, then `count`
+ * descriptors of DESCRIPTOR_REGS registers each.
+ * @return false if the table is malformed or empty (the caller falls back to the classic descriptor).
+ * @ingroup group_modbus_discovery
+ */
+bool parseAndStoreDescriptorTable(const uint8_t* data, size_t length, uint8_t slaveId) {
+    if (length < 2) return false;
+
+    uint8_t version = data[0];
+    uint8_t count = data[1];
+    if (version < DESCRIPTOR_TABLE_VERSION || count == 0) {
+        return false;
+    }
+    if (count > DISCOVERY_TABLE_MAX_SENSORS) {
+        Serial.printf("Esclavo %u anuncia %u sensores; se registran los primeros %u.\n",
+                      slaveId, count, DISCOVERY_TABLE_MAX_SENSORS);
+        count = DISCOVERY_TABLE_MAX_SENSORS;
+    }
+    if (length < 2 + (size_t)count * DESCRIPTOR_REGS * 2) {
+        Serial.printf("Error: tabla de descriptores incompleta para esclavo %u.\n", slaveId);
+        return false;
+    }
+
+    std::vector<ModbusSensorParam> found;
+    for (uint8_t k = 0; k < count; k++) {
+        found.push_back(decodeDescriptor(data + 2 + k * DESCRIPTOR_REGS * 2, k));
+    }
+    storeDiscoveredSensors(slaveId, found);
+    return true;
 }
 
 /**
  * @brief Starts the discovery process for a specific device.
+ * @details Reads the whole descriptor table in one transaction. Slaves without
+ * a table answer with an exception and are discovered through the classic
+ * single descriptor at address 0.
  * @param deviceId Modbus ID of the device to query.
- * @return true if the event was queued correctly, false otherwise.
+ * @return true if the slave answered with at least one descriptor, false otherwise.
  * @ingroup group_modbus_discovery
  */
 bool discoverDeviceSensors(uint8_t deviceId) {
     Serial.printf("Iniciando descubrimiento para dispositivo %u...\n", deviceId);
 
+    // Tabla completa: cabecera + DISCOVERY_TABLE_MAX_SENSORS descriptores (las ranuras libres leen 0)
+    ModbusApiResult result = modbus_api_read_registers(deviceId, READ_HOLD_REGISTER, DESCRIPTOR_TABLE_ADDRESS,
+                                                       1 + DISCOVERY_TABLE_MAX_SENSORS * DESCRIPTOR_REGS, 2000);
+    if (result.error_code == ModbusApiError::SUCCESS &&
+        parseAndStoreDescriptorTable(result.data, result.data_len, deviceId)) {
+        Serial.printf("Tabla de descriptores recibida para esclavo %u.\n", deviceId);
+        return true;
+    }
+    if (result.error_code != ModbusApiError::SUCCESS &&
+        result.error_code != ModbusApiError::ERROR_MODBUS_EXCEPTION) {
+        // Sin respuesta: no tiene sentido reintentar con el descriptor clásico
+        Serial.printf("Error en descubrimiento para esclavo %u: Código %u\n", deviceId, static_cast<uint8_t>(result.error_code));
+        return false;
+    }
+
     // Llamada síncrona a la API para leer los 8 registros de parámetros
-    ModbusApiResult result = modbus_api_read_registers(deviceId, READ_HOLD_REGISTER, 0, 8, 2000);
+    result = modbus_api_read_registers(deviceId, READ_HOLD_REGISTER, 0, DESCRIPTOR_REGS, 2000);
 
     if (result.error_code == ModbusApiError::SUCCESS) {
         Serial.printf("Respuesta de descubrimiento recibida para esclavo %u.\n", deviceId);
@@ -501,6 +930,126 @@ struct BitPacker
     }
 };
 
+// ==================== DELTA CODING ====================
+static inline uint32_t zigzag(int32_t d) {
+    return ((uint32_t)d << 1) ^ (uint32_t)(d >> 31);
+}
+
+static inline size_t varintSize(uint32_t v) {
+    size_t n = 1;
+    while (v >= 0x80) { v >>= 7; n++; }
+    return n;
+}
+
+/**
+ * @brief Delta-codes a channel-major uint16 block (see DATA_TYPE_DELTA).
+ * @param data Register bytes (big-endian), channel-major.
+ * @param dataLen Number of valid bytes in @p data.
+ * @param numRegs Number of registers in the block.
+ * @param samplesPerChannel Values per channel.
+ * @param out Encoded block (appended).
+ * @return false if the coded block would not be smaller than the plain one (nothing appended).
+ * @ingroup group_data_format
+ */
+static bool encodeDeltaBlock(const uint8_t* data, size_t dataLen, uint16_t numRegs,
+                             uint8_t samplesPerChannel, std::vector<uint8_t>& out) {
+    if (samplesPerChannel < 2 || numRegs % samplesPerChannel != 0 || (size_t)numRegs * 2 > dataLen) {
+        return false;
+    }
+    uint16_t channels = numRegs / samplesPerChannel;
+
+    // Deltas zig-zag canal a canal (el primer valor de cada canal va aparte)
+    std::vector<uint32_t> deltas;
+    deltas.reserve(numRegs - channels);
+    size_t varintBytes = 0;
+    uint32_t maxZz = 0;
+    for (uint16_t ch = 0; ch < channels; ++ch) {
+        const uint8_t* v = data + ch * samplesPerChannel * 2;
+        for (uint8_t i = 1; i < samplesPerChannel; ++i) {
+            int32_t cur  = (v[i * 2] << 8) | v[i * 2 + 1];
+            int32_t prev = (v[i * 2 - 2] << 8) | v[i * 2 - 1];
+            uint32_t zz = zigzag(cur - prev);
+            deltas.push_back(zz);
+            varintBytes += varintSize(zz);
+            maxZz = std::max(maxZz, zz);
+        }
+    }
+
+    int width = 0;
+    while (width < 32 && (maxZz >> width) != 0) width++;
+    size_t fixedBytes = (deltas.size() * width + 7) / 8;
+    bool fixed = width <= 16 && fixedBytes <= varintBytes; // BitPacker empaqueta hasta 16 bits
+
+    size_t coded = 1 + channels * 2 + (fixed ? fixedBytes : varintBytes);
+    if (coded >= (size_t)numRegs * 2) {
+        return false;
+    }
+
+    out.push_back(fixed ? (uint8_t)(width + 1) : 0);
+    for (uint16_t ch = 0; ch < channels; ++ch) {
+        out.push_back(data[ch * samplesPerChannel * 2]);
+        out.push_back(data[ch * samplesPerChannel * 2 + 1]);
+    }
+    if (fixed) {
+        if (width > 0) {
+            BitPacker packer;
+            for (uint32_t zz : deltas) packer.push((uint16_t)zz, width, out);
+            packer.flush(out);
+        }
+    } else {
+        for (uint32_t zz : deltas) {
+            while (zz >= 0x80) {
+                out.push_back((uint8_t)(zz | 0x80));
+                zz >>= 7;
+            }
+            out.push_back((uint8_t)zz);
+        }
+    }
+    return true;
+}
+
+static inline int bitWidth(uint16_t v) {
+    int n = 0;
+    while (n < 16 && (v >> n) != 0) n++;
+    return n;
+}
+
+/**
+ * @brief Bit-packs a uint16 block at the narrowest width that covers it (see BITPACK_AUTO_WIDTH).
+ * @param values Values to pack.
+ * @param count Number of values.
+ * @param out Encoded block (appended).
+ * @ingroup group_data_format
+ */
+static void encodeAutoWidthBlock(const uint16_t* values, size_t count, std::vector<uint8_t>& out) {
+    uint16_t vmin = count > 0 ? 0xFFFF : 0;
+    uint16_t vmax = 0;
+    for (size_t i = 0; i < count; ++i) {
+        vmin = std::min(vmin, values[i]);
+        vmax = std::max(vmax, values[i]);
+    }
+
+    // Sin base o restando el mínimo del bloque, lo que ocupe menos
+    int absWidth = bitWidth(vmax);
+    int relWidth = bitWidth(vmax - vmin);
+    size_t absBytes = 1 + (count * absWidth + 7) / 8;
+    size_t relBytes = 3 + (count * relWidth + 7) / 8;
+    bool withBase = relBytes < absBytes;
+    int width = withBase ? relWidth : absWidth;
+    uint16_t base = withBase ? vmin : 0;
+
+    out.push_back((uint8_t)((withBase ? PACK_FLAG_BASE : 0) | width));
+    if (withBase) {
+        out.push_back(base >> 8);
+        out.push_back(base & 0xFF);
+    }
+    if (width > 0) {
+        BitPacker packer;
+        for (size_t i = 0; i < count; ++i) packer.push(values[i] - base, width, out);
+        packer.flush(out);
+    }
+}
+
 /**
  * @def MAX_SENSOR_PAYLOAD
  * @brief Maximum size of an individual sensor payload.
@@ -508,6 +1057,39 @@ struct BitPacker
  */
 #define MAX_SENSOR_PAYLOAD 128 ///< Maximum size of an individual sensor payload.
 
+/**
+ * @def FRAME_FORMAT
+ * @brief Unified frame header: 1 = classic, 2 = compact v2.
+ * @details v1: [ID_MSG][TIMESTAMP 4B][ACTIVATE][LEN...][DATA...].
+ * v2: [(2 << 4) | flags][counter varint][BASE: epoch 4B | else: delta varint]
+ *     [ACTIVATE][LEN...][BLOCK_TIME: one age varint per block][DATA...]
+ * - counter wraps at FRAME_V2_COUNTER_MOD, so it always takes one byte.
+ * - A BASE frame carries the absolute timestamp; the following frames carry the
+ *   seconds elapsed since that base. A new base is sent on the first frame, every
+ *   FRAME_V2_BASE_EVERY frames, when the delta would need 3 bytes or when the clock
+ *   changes sync state. Flag P is the parity of the base in use, so a decoder
+ *   notices a lost base instead of applying the delta to an older one.
+ * - Block ages are the seconds between each block's sampling and the frame timestamp.
+ * - v2 frames go out on their own FPorts (3 live, 4 backlog) and every frame moved
+ *   to the backlog is rewritten as a BASE frame, so backlog decoding needs no state.
+ * Reference decoder: tools/frame_decoder.py.
+ * v2 is specific to this master: the 03-06-26 master (keyframe/delta frames indexed by
+ * ID_MSG) and the 10-09-25 node (no network clock) keep the [ID_MSG][TIMESTAMP 4B] header.
+ * @ingroup group_data_format
+ */
+#ifndef FRAME_FORMAT
+#define FRAME_FORMAT 2
+#endif
+#define FRAME_V2_VERSION 2
+#define FRAME_V2_FLAG_BASE 0x01       ///< Absolute epoch instead of a delta.
+#define FRAME_V2_FLAG_BLOCK_TIME 0x02 ///< Per-block ages follow the LEN bytes.
+#define FRAME_V2_FLAG_UNSYNCED 0x04   ///< Time is seconds since boot, not UNIX.
+#define FRAME_V2_FLAG_PARITY 0x08     ///< Parity of the base the delta refers to.
+#define FRAME_V2_COUNTER_MOD 128
+#define FRAME_V2_BASE_EVERY 16
+#define FRAME_V2_MAX_DELTA 16383      ///< Largest delta that fits in a 2-byte varint.
+#define FRAME_V2_BASE_GROWTH 3        ///< Worst-case growth when a frame is rewritten as BASE.
+
 /**
  * @struct SensorDataPayload
  * @brief Container for processed sensor data, ready for aggregation.
@@ -518,19 +1100,102 @@ struct SensorDataPayload {
     uint8_t sensorId;                 ///< Source sensor ID.
     uint8_t data[MAX_SENSOR_PAYLOAD]; ///< Fixed-size data array.
     size_t dataSize;                  ///< Number of valid bytes in data.
+    uint8_t samplesPerChannel;        ///< Values per channel (len byte of the payload).
+    uint8_t lenFlags;                 ///< Flags OR-ed into the len byte (LEN_FLAG_DELTA, LEN_FLAG_QUANT, LEN_FLAG_PACKED).
+    uint32_t sampledAt;               ///< net_clock_now() when the block was read.
 };
 
 QueueHandle_t queueSensorDataPayload; ///< Queue for processed sensor payloads.
 
+/**
+ * @struct SensorDeadband
+ * @brief Report-by-exception settings for one sensor ID.
+ * @details A block is forwarded to the aggregator only if some register moved more than
+ * max(absCounts, relPct % of the last forwarded value) against the same register of the
+ * last forwarded block, or if heartbeatMs elapsed since then (0 = no heartbeat). A
+ * suppressed block never reaches pendingBuffer, so the sensor is simply left out of the
+ * Activate Byte. Blocks whose size differs from the last one are always forwarded; sensor
+ * IDs without an entry are always forwarded.
+ * @ingroup group_data_format
+ */
+struct SensorDeadband {
+    uint8_t sensorID;      ///< Sensor ID (same for every slave).
+    uint16_t absCounts;    ///< Absolute deadband, in raw register counts.
+    float relPct;          ///< Relative deadband, % of the last forwarded value.
+    uint32_t heartbeatMs;  ///< Maximum silence before a block is forwarded anyway.
+};
+
+/**
+ * @brief Deadbands of the slave sensors (RMS 1, PT100 3, pressure 4).
+ * @details Summaries (5-7) are left out: they already are one block per window.
+ * @ingroup group_data_format
+ */
+const SensorDeadband DEADBAND_TABLE[] = {
+    {1, 4, 1.0f, 300000},   // RMS
+    {3, 2, 0.0f, 600000},   // PT100
+    {4, 8, 1.0f, 300000},   // Presión
+};
+
+// Último bloque reenviado por (esclavo, sensor)
+struct DeadbandState {
+    std::vector<uint16_t> last;
+    uint32_t sentMs;
+};
+static std::map<uint16_t, DeadbandState> deadbandState;
+
+static const SensorDeadband* findDeadband(uint8_t sensorId) {
+    for (const auto& db : DEADBAND_TABLE) {
+        if (db.sensorID == sensorId) return &db;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Decides whether a raw register block leaves the deadband (see SensorDeadband).
+ * @ingroup group_data_format
+ */
+static bool deadbandPasses(uint8_t slaveId, uint8_t sensorId, const uint8_t* data, size_t dataLen,
+                           uint16_t numRegs, uint32_t nowMs) {
+    const SensorDeadband* db = findDeadband(sensorId);
+    if (db == nullptr) return true;
+    auto it = deadbandState.find((uint16_t)(slaveId << 8) | sensorId);
+    if (it == deadbandState.end() || it->second.last.size() != numRegs || (size_t)numRegs * 2 > dataLen) {
+        return true;
+    }
+    if (db->heartbeatMs > 0 && nowMs - it->second.sentMs >= db->heartbeatMs) return true;
+
+    for (uint16_t i = 0; i < numRegs; ++i) {
+        int32_t cur = (data[i * 2] << 8) | data[i * 2 + 1];
+        int32_t ref = it->second.last[i];
+        float band = std::max((float)db->absCounts, ref * db->relPct / 100.0f);
+        if (abs(cur - ref) > band) return true;
+    }
+    return false;
+}
+
+// Guarda el bloque reenviado como nueva referencia de la banda muerta
+static void deadbandCommit(uint8_t slaveId, uint8_t sensorId, const uint8_t* data, size_t dataLen,
+                           uint16_t numRegs, uint32_t nowMs) {
+    if (findDeadband(sensorId) == nullptr) return;
+    DeadbandState& st = deadbandState[(uint16_t)(slaveId << 8) | sensorId];
+    st.last.clear();
+    for (uint16_t i = 0; i < numRegs && (size_t)i * 2 + 1 < dataLen; ++i) {
+        st.last.push_back((data[i * 2] << 8) | data[i * 2 + 1]);
+    }
+    st.sentMs = nowMs;
+}
+
 /**
  * @brief Extracts and formats data from a sampling Modbus response.
- * @param response Raw response received.
- * @param request Information from the original request.
- * @param values Output vector where the processed bytes will be stored.
+ * @param data Register bytes (big-endian), channel-major.
+ * @param dataLen Number of valid bytes in @p data.
+ * @param numRegs Number of registers to format.
+ * @param samplesPerChannel Values per channel carried in @p data.
  * @return true if the process was successful.
  * @ingroup group_data_format
  */
-static bool formatAndEnqueueSensorData(const ModbusApiResult& response, uint8_t slaveId, uint8_t sensorId) {
+static bool formatAndEnqueueSensorData(const uint8_t* data, size_t dataLen, uint16_t numRegs,
+                                       uint8_t samplesPerChannel, uint8_t slaveId, uint8_t sensorId) {
     auto slaveIt = std::find_if(slaveList.begin(), slaveList.end(),
         [&](const ModbusSlaveParam& s) { return s.slaveID == slaveId; });
     if (slaveIt == slaveList.end()) {
@@ -548,8 +1213,15 @@ static bool formatAndEnqueueSensorData(const ModbusApiResult& response, uint8_t
     const ModbusSensorParam& params = *sensorIt;
     std::vector<uint8_t> values;
 
+    uint32_t nowMs = millis();
+    if (!deadbandPasses(slaveId, sensorId, data, dataLen, numRegs, nowMs)) {
+        Serial.printf("Formato: esclavo %u sensor %u dentro de la banda muerta, no se envía.\n",
+                      slaveId, sensorId);
+        return true;
+    }
+
     Serial.printf("Formato: esclavo %u sensor %u -> regs:%u tipo:%u escala:%u comp:%u\n",
-                  slaveId, params.sensorID, params.maxRegisters,
+                  slaveId, params.sensorID, numRegs,
                   params.dataType, params.scale, params.compressedBytes);
 
     uint8_t dataType = params.dataType; // 1=uint8, 2=uint16
@@ -557,27 +1229,74 @@ static bool formatAndEnqueueSensorData(const ModbusApiResult& response, uint8_t
     uint8_t compressedBytes = params.compressedBytes;
 
     values.clear();
-    if (compressedBytes > 0) {
+    uint8_t lenFlags = 0;
+    bool quantized = false;
+    if (dataType == DATA_TYPE_FLOAT16 || dataType == DATA_TYPE_SCALED) {
+        // Valor físico = registro / 10^scale; error máximo en cuentas del registro
+        size_t count = std::min<size_t>(numRegs, dataLen / 2);
+        double div = pow(10.0, scale);
+        std::vector<double> phys(count);
+        for (size_t i = 0; i < count; ++i) {
+            phys[i] = ((data[i * 2] << 8) | data[i * 2 + 1]) / div;
+        }
+        double maxCounts = compressedBytes;
+        if (dataType == DATA_TYPE_SCALED && maxCounts < 0.5) maxCounts = 0.5; // Sin pérdida
+        // Solo se cuantiza si el bloque queda estrictamente menor que el uint16 crudo
+        quantized = quant_encode_block(phys.data(), count,
+                                       dataType == DATA_TYPE_FLOAT16 ? QUANT_FLOAT16 : QUANT_SCALED,
+                                       maxCounts / div, count * 2, values);
+        if (quantized) {
+            lenFlags = LEN_FLAG_QUANT;
+        }
+    }
+
+    if (quantized) {
+        // Ya codificado
+    } else if (dataType == DATA_TYPE_FLOAT16 || dataType == DATA_TYPE_SCALED) {
+        // Fuera del error declarado o sin ganancia: uint16 tal cual
+        for (size_t i = 0; i < numRegs && (i * 2 + 1) < dataLen; ++i) {
+            values.push_back(data[i * 2]);
+            values.push_back(data[i * 2 + 1]);
+        }
+    } else if (dataType == DATA_TYPE_DELTA && encodeDeltaBlock(data, dataLen, numRegs, samplesPerChannel, values)) {
+        lenFlags = LEN_FLAG_DELTA;
+    } else if (dataType == DATA_TYPE_DELTA) {
+        // Delta no compensa: uint16 tal cual
+        for (size_t i = 0; i < numRegs && (i * 2 + 1) < dataLen; ++i) {
+            values.push_back(data[i * 2]);
+            values.push_back(data[i * 2 + 1]);
+        }
+    } else if (compressedBytes > 0) {
+#if BITPACK_AUTO_WIDTH
+        std::vector<uint16_t> raws;
+        raws.reserve(numRegs);
+        for (size_t i = 0; i < numRegs && (i * 2 + 1) < dataLen; ++i) {
+            raws.push_back((static_cast<uint16_t>(data[i * 2]) << 8) | data[i * 2 + 1]);
+        }
+        encodeAutoWidthBlock(raws.data(), raws.size(), values);
+        lenFlags = LEN_FLAG_PACKED;
+#else
         BitPacker packer;
-        for (size_t i = 0; i < params.maxRegisters; ++i) {
+        for (size_t i = 0; i < numRegs; ++i) {
             size_t offset = i * 2;
-            if ((offset + 1) >= response.data_len) {
+            if ((offset + 1) >= dataLen) {
                 break;
             }
-            uint8_t high = response.data[offset];
-            uint8_t low  = response.data[offset + 1];
+            uint8_t high = data[offset];
+            uint8_t low  = data[offset + 1];
             uint16_t raw = (static_cast<uint16_t>(high) << 8) | low;
             packer.push(raw, compressedBytes, values);
         }
         packer.flush(values);
+#endif
     } else {
-        for (size_t i = 0; i < params.maxRegisters; ++i) {
+        for (size_t i = 0; i < numRegs; ++i) {
             size_t offset = i * 2;
-            if ((offset + 1) >= response.data_len) {
+            if ((offset + 1) >= dataLen) {
                 break;
             }
-            uint8_t high = response.data[offset];
-            uint8_t low  = response.data[offset + 1];
+            uint8_t high = data[offset];
+            uint8_t low  = data[offset + 1];
 
             if (dataType == 1) {            // uint8 -> solo byte bajo
                 values.push_back(low);
@@ -595,6 +1314,9 @@ static bool formatAndEnqueueSensorData(const ModbusApiResult& response, uint8_t
     SensorDataPayload payload;
     payload.slaveId = slaveId;
     payload.sensorId = sensorId;
+    payload.samplesPerChannel = samplesPerChannel;
+    payload.lenFlags = lenFlags;
+    payload.sampledAt = net_clock_now();
 
     // Copiar los datos de forma segura
     payload.dataSize = std::min(values.size(), (size_t)MAX_SENSOR_PAYLOAD);
@@ -606,6 +1328,7 @@ static bool formatAndEnqueueSensorData(const ModbusApiResult& response, uint8_t
     } else {
         Serial.printf("Payload de datos del sensor encolado: Esclavo %u, Sensor %u, Bytes %u\n",
                       payload.slaveId, payload.sensorId, payload.dataSize);
+        deadbandCommit(slaveId, sensorId, data, dataLen, numRegs, nowMs);
     }
 
     return true;
@@ -659,10 +1382,147 @@ const std::vector<uint8_t> DEFINED_PRIORITY_IDS = { SENSOR_ID_VOLTAJE, SENSOR_ID
 // Almacena qué sensores prioritarios están INSTALADOS actualmente entres todos los esclavos.
 std::vector<uint8_t> activePrioritySensors; 
 
+#if FRAME_FORMAT == 2
+// Entero sin signo en base 128 (LEB128): 7 bits por byte, bit 7 = continúa
+static void putVarint(std::vector<uint8_t>& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t)value);
+}
+
+// Edad de un bloque en segundos (0 si no se puede expresar: reloj resincronizado entre medias)
+static uint32_t blockAge(uint32_t frameTs, uint32_t sampledAt) {
+    if (sampledAt >= frameTs || frameTs - sampledAt > FRAME_V2_MAX_DELTA) return 0;
+    return frameTs - sampledAt;
+}
+
+// Estado de la cabecera v2: contador, base vigente y hora absoluta de cada trama
+// (para reescribirla como BASE si pasa al histórico)
+static uint8_t v2Counter = 0;
+static bool v2HaveBase = false;
+static uint32_t v2BaseTime = 0;
+static uint8_t v2BaseCounter = 0;
+static bool v2BaseParity = false;
+static bool v2BaseUnsynced = false;
+static uint32_t v2FrameTime[FRAME_V2_COUNTER_MOD];
+static uint8_t v2FrameBase[FRAME_V2_COUNTER_MOD];            // Contador de la base de cada trama
+// Bases cuya trama pasó al histórico sin llegar en vivo (las marca tareaLoRa); la
+// próxima cabecera vuelve a ser BASE y sus deltas se reescriben como BASE al enviarse
+static volatile bool v2BaseLost[FRAME_V2_COUNTER_MOD];
+static volatile bool v2ForceBase = false;
+
+/**
+ * @brief Appends the v2 header ([version|flags][counter][epoch or delta]).
+ * @param payload Output buffer (empty).
+ * @param blockTimes Whether per-block ages will follow the LEN bytes.
+ * @return Frame timestamp (UNIX seconds, or seconds since boot if unsynchronized).
+ * @ingroup group_data_format
+ */
+static uint32_t appendFrameHeaderV2(std::vector<uint8_t>& payload, bool blockTimes) {
+    bool unsynced = !net_clock_synced();
+    uint32_t ts = net_clock_now();
+    uint8_t counter = v2Counter;
+    v2Counter = (v2Counter + 1) % FRAME_V2_COUNTER_MOD;
+
+    bool force = __atomic_exchange_n(&v2ForceBase, false, __ATOMIC_ACQ_REL);
+    bool base = force || !v2HaveBase || unsynced != v2BaseUnsynced || ts < v2BaseTime ||
+                ts - v2BaseTime > FRAME_V2_MAX_DELTA ||
+                (uint8_t)(counter - v2BaseCounter) % FRAME_V2_COUNTER_MOD >= FRAME_V2_BASE_EVERY;
+    if (base) {
+        v2HaveBase = true;
+        v2BaseTime = ts;
+        v2BaseCounter = counter;
+        v2BaseParity = !v2BaseParity;
+        v2BaseUnsynced = unsynced;
+        v2BaseLost[counter] = false;
+    }
+    v2FrameTime[counter] = ts;
+    v2FrameBase[counter] = v2BaseCounter;
+
+    uint8_t flags = 0;
+    if (base)         flags |= FRAME_V2_FLAG_BASE;
+    if (blockTimes)   flags |= FRAME_V2_FLAG_BLOCK_TIME;
+    if (unsynced)     flags |= FRAME_V2_FLAG_UNSYNCED;
+    if (v2BaseParity) flags |= FRAME_V2_FLAG_PARITY;
+    payload.push_back((FRAME_V2_VERSION << 4) | flags);
+    putVarint(payload, counter);
+    if (base) {
+        payload.push_back((ts >> 24) & 0xFF);
+        payload.push_back((ts >> 16) & 0xFF);
+        payload.push_back((ts >> 8) & 0xFF);
+        payload.push_back(ts & 0xFF);
+    } else {
+        putVarint(payload, ts - v2BaseTime);
+    }
+    return ts;
+}
+
+#endif
+
+/**
+ * @brief Rewrites a v2 delta frame as a BASE frame (absolute epoch) in place.
+ * @details Used when a frame moves to the backlog: by the time it is sent, the
+ * base it refers to may be long gone from the decoder. No-op for v1 and BASE frames.
+ * @ingroup group_data_format
+ */
+static void frameToBaseV2(uint8_t* data, size_t& len, size_t max) {
+#if FRAME_FORMAT == 2
+    if (len < 3 || (data[0] >> 4) != FRAME_V2_VERSION || (data[0] & FRAME_V2_FLAG_BASE)) return;
+    uint8_t counter = data[1] % FRAME_V2_COUNTER_MOD;
+    size_t deltaEnd = 2;
+    while (deltaEnd < len && (data[deltaEnd] & 0x80)) deltaEnd++;
+    deltaEnd++; // último byte del varint
+    if (deltaEnd > len || len - deltaEnd + 6 > max) return;
+
+    uint32_t ts = v2FrameTime[counter];
+    memmove(data + 6, data + deltaEnd, len - deltaEnd);
+    len = len - deltaEnd + 6;
+    data[0] |= FRAME_V2_FLAG_BASE;
+    data[2] = (ts >> 24) & 0xFF;
+    data[3] = (ts >> 16) & 0xFF;
+    data[4] = (ts >> 8) & 0xFF;
+    data[5] = ts & 0xFF;
+#endif
+}
+
+/**
+ * @brief Notes that a live frame left the live lane without reaching the server.
+ * @details If it was the BASE of its run, the next header is forced to BASE and the
+ * deltas that refer to it are rewritten by fixLostBaseV2() before they are sent:
+ * the decoder only takes bases from live frames.
+ * @ingroup group_data_format
+ */
+static void noteDemotedV2(const uint8_t* data, size_t len) {
+#if FRAME_FORMAT == 2
+    if (len < 2 || (data[0] >> 4) != FRAME_V2_VERSION || !(data[0] & FRAME_V2_FLAG_BASE)) return;
+    uint8_t counter = data[1] % FRAME_V2_COUNTER_MOD;
+    if (v2FrameBase[counter] != counter) return; // Delta ya reescrita, no era base de nadie
+    v2BaseLost[counter] = true;
+    __atomic_store_n(&v2ForceBase, true, __ATOMIC_RELEASE);
+#endif
+}
+
+/**
+ * @brief Rewrites a live delta frame as BASE if its base never reached the server.
+ * @ingroup group_data_format
+ */
+static void fixLostBaseV2(uint8_t* data, size_t& len, size_t max) {
+#if FRAME_FORMAT == 2
+    if (len < 2 || (data[0] >> 4) != FRAME_V2_VERSION || (data[0] & FRAME_V2_FLAG_BASE)) return;
+    if (v2BaseLost[v2FrameBase[data[1] % FRAME_V2_COUNTER_MOD]]) {
+        frameToBaseV2(data, len, max);
+    }
+#endif
+}
+
 /**
  * @brief Builds a unified payload from a collection of sensor data.
- * @details Payload Structure: [ID_MSG][TIMESTAMP][ACTIVATE_BYTE][LEN_BYTES...][DATA_BLOCKS...]
- * @param id_mensaje The message ID byte (Header).
+ * @details Payload Structure (FRAME_FORMAT 1): [ID_MSG][TIMESTAMP][ACTIVATE_BYTE][LEN_BYTES...][DATA_BLOCKS...].
+ * With FRAME_FORMAT 2 the first five bytes are replaced by the compact v2 header and
+ * per-block ages may follow the LEN bytes (see FRAME_FORMAT).
+ * @param id_mensaje The message ID byte (Header, v1 only).
  * @param collectedPayloads The vector with the collected data.
  * @return std::vector<uint8_t> The binary payload ready to be sent.
  * @ingroup group_data_format
@@ -673,24 +1533,36 @@ std::vector<uint8_t> construirPayloadUnificado(
 {
     std::vector<uint8_t> payload;
 
+    // Usamos un mapa para organizar los sensores presentes y manejar duplicados
+    // (el último sensor con el mismo ID sobreescribe a los anteriores).
+    std::map<uint8_t, const SensorDataPayload*> activeSensors;
+    for (const auto& sensorData : collectedPayloads) {
+        activeSensors[sensorData.sensorId] = &sensorData;
+    }
+
+#if FRAME_FORMAT == 2
+    // ================== 1-2. CABECERA v2 ==================
+    // Edad de cada bloque respecto a la trama; solo se envían si alguna no es 0
+    uint32_t ts_s = net_clock_now();
+    bool blockTimes = false;
+    for (const auto& kv : activeSensors) {
+        if (blockAge(ts_s, kv.second->sampledAt) > 0) blockTimes = true;
+    }
+    ts_s = appendFrameHeaderV2(payload, blockTimes);
+#else
     // ================== 1. CABECERA (1 byte) ==================
     payload.push_back(id_mensaje);
 
     // ================== 2. TIMESTAMP (4 bytes) ==================
-    // Usamos el timestamp UNIX actual. El código original usaba millis()
-    // o un timestamp del buffer. time(nullptr) es el estándar C++.
-    uint32_t ts_s = static_cast<uint32_t>(time(nullptr));
+    // Hora UNIX sincronizada con la red (DeviceTimeReq). Mientras no haya
+    // sincronización se envían los segundos desde el arranque con el bit 31
+    // (TS_UNSYNCED_FLAG) activo para que el servidor no los tome por UNIX.
+    uint32_t ts_s = net_clock_frame_timestamp();
     payload.push_back((ts_s >> 24) & 0xFF);
     payload.push_back((ts_s >> 16) & 0xFF);
     payload.push_back((ts_s >> 8) & 0xFF);
     payload.push_back(ts_s & 0xFF);
-
-    // Usamos un mapa para organizar los sensores presentes y manejar duplicados
-    // (el último sensor con el mismo ID sobreescribe a los anteriores).
-    std::map<uint8_t, const SensorDataPayload*> activeSensors;
-    for (const auto& sensorData : collectedPayloads) {
-        activeSensors[sensorData.sensorId] = &sensorData;
-    }
+#endif
 
     // ================== 3. ACTIVATE BYTE (1 byte) ==================
     // Construido dinámicamente basado en los SENSOR_ID presentes
@@ -718,9 +1590,9 @@ std::vector<uint8_t> construirPayloadUnificado(
     if (activate_byte & (1 << 0)) {
         const auto& sensor = activeSensors.at(SENSOR_ID_BATERIA);
         //optener Data Length Bytes
-        uint8_t len_data = getRegistersPerChannel(sensor->slaveId, sensor->sensorId);
+        uint8_t len_data = sensor->samplesPerChannel;
         // Asumimos formato del ejemplo: No PKD, No 2BIT
-        uint8_t len_byte = (len_data & 0x1F);
+        uint8_t len_byte = (len_data & 0x1F) | sensor->lenFlags;
         payload.push_back(len_byte);
     }
 
@@ -728,9 +1600,9 @@ std::vector<uint8_t> construirPayloadUnificado(
     if (activate_byte & (1 << 1)) {
         const auto& sensor = activeSensors.at(SENSOR_ID_VOLTAJE);
         //optener Data Length Bytes
-        uint8_t len_data = getRegistersPerChannel(sensor->slaveId, sensor->sensorId);
+        uint8_t len_data = sensor->samplesPerChannel;
         // Asumimos formato del ejemplo: No PKD, No 2BIT
-        uint8_t len_byte = (len_data & 0x1F);
+        uint8_t len_byte = (len_data & 0x1F) | sensor->lenFlags;
         payload.push_back(len_byte);
     }
 
@@ -738,9 +1610,9 @@ std::vector<uint8_t> construirPayloadUnificado(
     if (activate_byte & (1 << 2)) {
         const auto& sensor = activeSensors.at(SENSOR_ID_CORRIENTE);
         //optener Data Length Bytes
-        uint8_t len_data = getRegistersPerChannel(sensor->slaveId, sensor->sensorId);
+        uint8_t len_data = sensor->samplesPerChannel;
         // Asumimos formato del ejemplo: PKD (Bit 7), No 2BIT
-        uint8_t len_byte = (len_data & 0x1F);
+        uint8_t len_byte = (len_data & 0x1F) | sensor->lenFlags;
         payload.push_back(len_byte);
     }
 
@@ -750,14 +1622,26 @@ std::vector<uint8_t> construirPayloadUnificado(
             uint8_t current_sensor_id = SENSOR_ID_EXT_START + i;
             const auto& sensor = activeSensors.at(current_sensor_id);
             //optener Data Length Bytes
-            uint8_t len_data = getRegistersPerChannel(sensor->slaveId, sensor->sensorId);
+            uint8_t len_data = sensor->samplesPerChannel;
             // Asumimos formato simple: No PKD, No 2BIT
             // (Debes cambiar esto si tus sensores externos usan packing)
-            uint8_t len_byte = (len_data & 0x1F);
+            uint8_t len_byte = (len_data & 0x1F) | sensor->lenFlags;
             payload.push_back(len_byte);
         }
     }
 
+#if FRAME_FORMAT == 2
+    // ================== 4b. EDADES DE BLOQUE (v2, opcional) ==================
+    // Mismo orden que los LEN bytes (el mapa ya está ordenado por sensorID = bit)
+    if (blockTimes) {
+        for (const auto& kv : activeSensors) {
+            uint8_t id = kv.first;
+            if (id > SENSOR_ID_EXT_START + MAX_SENSORES_EXTERNOS - 1) continue;
+            putVarint(payload, blockAge(ts_s, kv.second->sampledAt));
+        }
+    }
+#endif
+
     // ================== 5. BLOQUES DE DATOS (Resto) ==================
     // Añadimos los datos de cada sensor activo, en el mismo orden.
     // Esta es la mayor simplificación: asumimos que `sensor->data`
@@ -844,6 +1728,12 @@ const lmic_pinmap lmic_pins = {.nss = 18,
  */
 constexpr size_t LORA_PAYLOAD_MAX = 220;
 
+/**
+ * @brief Largest frame the aggregator builds: v2 keeps room to be rewritten as BASE.
+ * @ingroup group_lorawan
+ */
+constexpr size_t FRAME_MAX_LEN = LORA_PAYLOAD_MAX - (FRAME_FORMAT == 2 ? FRAME_V2_BASE_GROWTH : 0);
+
 /**
  * @struct Fragmento
  * @brief Binary fragment ready for LoRaWAN transmission.
@@ -855,6 +1745,46 @@ struct Fragmento {
     size_t len;                     ///< Length of the data.
 };
 
+/**
+ * @def UPLINK_CONFIRMED
+ * @brief Send stored fragments as confirmed uplinks (1) and drop them only once acknowledged.
+ * @details With unconfirmed uplinks (0) a fragment leaves the flash queue as soon as
+ * EV_TXCOMPLETE arrives, so the queue only protects against reboots and airtime bursts;
+ * a gateway outage can only be detected through the ACK.
+ * @ingroup group_lorawan
+ */
+#ifndef UPLINK_CONFIRMED
+#define UPLINK_CONFIRMED 1
+#endif
+
+/**
+ * @def UPLINK_RETRY_MS
+ * @brief Wait before resending the oldest stored fragment after a missing ACK.
+ * @ingroup group_lorawan
+ */
+#define UPLINK_RETRY_MS 30000
+
+/**
+ * @def LIVE_LANE_DEPTH
+ * @brief Fresh fragments held in RAM ahead of the flash backlog.
+ * @details Fresh fragments are sent first on LORA_PORT_LIVE. A fragment that is not
+ * acknowledged, or that overflows this lane, moves to the flash backlog, which is
+ * drained on LORA_PORT_BACKLOG only while the live lane is empty. Backlog fragments
+ * keep their original timestamp inside the payload; the port tells the decoder they
+ * are historical.
+ * @ingroup group_lorawan
+ */
+#define LIVE_LANE_DEPTH 4
+#if FRAME_FORMAT == 2
+#define LORA_PORT_LIVE 3
+#define LORA_PORT_BACKLOG 4
+#else
+#define LORA_PORT_LIVE 1
+#define LORA_PORT_BACKLOG 2
+#endif
+
+volatile bool loraTxAcked = false; ///< ACK flag of the last completed transmission.
+
 
 // ==================== LORA CALLBACKS ====================
 /**
@@ -868,6 +1798,7 @@ struct Fragmento {
 void onEvent(ev_t ev) {
     if (ev == EV_TXCOMPLETE) {
         Serial.println("[LORA] TX completo.");
+        loraTxAcked = (LMIC.txrxFlags & TXRX_ACK) != 0;
         // Libera el semáforo para indicar que el ciclo de transmisión ha terminado.
         xSemaphoreGive(semaforoEnvioCompleto);
         if (LMIC.txrxFlags & TXRX_ACK) {
@@ -900,32 +1831,198 @@ void initLoRa() {
     LMIC_setLinkCheckMode(0);
 }
 
+// ==================== HORA DE RED ====================
+/**
+ * @def GPS_UNIX_OFFSET_S
+ * @brief Seconds between the UNIX epoch and the GPS epoch (1980-01-06).
+ * @details DeviceTimeAns carries GPS seconds; GPS_LEAP_SECONDS is the current
+ * GPS-UTC difference and must be updated if a leap second is announced.
+ * @ingroup group_lorawan
+ */
+#define GPS_UNIX_OFFSET_S 315964800UL
+#define GPS_LEAP_SECONDS 18
+
+#if LMIC_ENABLE_DeviceTimeReq
+// Respuesta a DeviceTimeReq: llega con la ventana RX del uplink que llevó la petición
+static void onNetworkTime(void* pUserData, int flagSuccess) {
+    if (!flagSuccess) {
+        Serial.println("[TIEMPO] La red no respondió a DeviceTimeReq");
+        return;
+    }
+    lmic_time_reference_t ref;
+    if (!LMIC_getNetworkTimeReference(&ref)) {
+        return;
+    }
+    // tNetwork son los segundos GPS en el instante local tLocal (fin del uplink)
+    uint32_t elapsedMs = osticks2ms(os_getTime() - ref.tLocal);
+    uint32_t unixSeconds = ref.tNetwork + GPS_UNIX_OFFSET_S - GPS_LEAP_SECONDS + (elapsedMs + 500) / 1000;
+    net_clock_sync(unixSeconds);
+}
+#endif
+
+// Añade DeviceTimeReq al próximo uplink si nunca hubo hora o toca resincronizar
+static void requestNetworkTimeIfDue() {
+#if LMIC_ENABLE_DeviceTimeReq
+    if (net_clock_due()) {
+        LMIC_requestNetworkTime(onNetworkTime, nullptr);
+    }
+#endif
+}
+
 // ==================== TAREA LORA ====================
+// Pasa un fragmento al histórico en flash (como trama BASE si es v2)
+static void demoteToBacklog(Fragmento& frag) {
+    noteDemotedV2(frag.data, frag.len);
+    frameToBaseV2(frag.data, frag.len, LORA_PAYLOAD_MAX);
+    if (!uplink_store_append(frag.data, frag.len)) {
+        Serial.println("[LORA] ERROR: no se pudo guardar el fragmento en flash");
+    }
+}
+
+// Guarda en flash lo que solo está en RAM (fragmento en vivo en el aire y carril), ya
+// como tramas BASE: tras un reinicio va a la cola y la hora de cada trama se perdió
+static void saveLiveLane(const Fragmento* live, uint8_t head, uint8_t count, const Fragmento* inFlight) {
+    static Fragmento copies[LIVE_LANE_DEPTH + 1];
+    const uint8_t* data[LIVE_LANE_DEPTH + 1];
+    size_t lens[LIVE_LANE_DEPTH + 1];
+    size_t n = 0;
+    if (inFlight != nullptr) copies[n++] = *inFlight;
+    for (uint8_t i = 0; i < count; i++) {
+        copies[n++] = live[(head + i) % LIVE_LANE_DEPTH];
+    }
+    for (size_t i = 0; i < n; i++) {
+        frameToBaseV2(copies[i].data, copies[i].len, LORA_PAYLOAD_MAX);
+        data[i] = copies[i].data;
+        lens[i] = copies[i].len;
+    }
+    if (!uplink_store_save_live(data, lens, n)) {
+        Serial.println("[LORA] ERROR: no se pudo guardar el carril en vivo en flash");
+    }
+}
+
+static void printFragment(const Fragmento& frag) {
+    Serial.printf("[LORA] Enviando fragmento de %u bytes...\n", frag.len);
+    Serial.println("[LORA] Datos:");
+    for (size_t i = 0; i < frag.len; i++) {
+        Serial.print("0x");
+        if (frag.data[i] < 0x10) Serial.print("0");
+        Serial.print(frag.data[i], HEX);
+        Serial.print(",");
+    }
+}
+
 /**
  * @brief Task dedicated to sending data via LoRaWAN.
- * @details
- * - Waits for fragments in `queueFragmentos`.
- * - Takes `semaforoEnvioCompleto` to serialize transmissions.
- * - Calls `LMIC_setTxData2()` with application port 1 and without confirmation (confirmed=0).
+ * @details Two lanes, live first:
+ * - Fragments from `queueFragmentos` enter the live lane (RAM, LIVE_LANE_DEPTH) and are
+ *   sent first, oldest live fragment first, on LORA_PORT_LIVE.
+ * - A live fragment that is not acknowledged (UPLINK_CONFIRMED), or that is pushed out of a
+ *   full lane, is appended to the flash backlog (UplinkStore).
+ * - A v2 BASE frame that leaves the live lane this way takes its run with it: the next
+ *   header is a new BASE and live deltas of the lost base are sent as BASE frames.
+ * - The backlog is sent on LORA_PORT_BACKLOG, in order, only when the live lane is empty,
+ *   and waits UPLINK_RETRY_MS after a missing ACK. It survives reboots.
+ * - The live lane and the live fragment in flight are mirrored to flash whenever they
+ *   change (uplink_store_save_live), so a reboot moves them to the backlog instead of
+ *   losing them. A reboot between a demotion and the next mirror may send one twice.
+ * - Transmissions are serialized with `semaforoEnvioCompleto`.
+ * - If LittleFS cannot be mounted, fragments are sent straight from the RAM queue.
  * @ingroup group_lorawan
  */
 void tareaLoRa(void *pvParameters) {
     Fragmento frag;
+    bool persistent = uplink_store_init();
+
+    Fragmento live[LIVE_LANE_DEPTH];   // Carril en vivo (anillo)
+    uint8_t liveHead = 0, liveCount = 0;
+    Fragmento inFlight;                // Fragmento en vivo en el aire
+    bool txPending = false;
+    bool txFromLive = false;
+    TickType_t retryAt = xTaskGetTickCount();
+
     while (true) {
-        if (xQueueReceive(queueFragmentos, &frag, portMAX_DELAY) == pdTRUE) {
-            // Espera semáforo antes de enviar
-            xSemaphoreTake(semaforoEnvioCompleto, portMAX_DELAY);
-            Serial.printf("[LORA] Enviando fragmento de %u bytes...\n", frag.len);
-            Serial.println("[LORA] Datos:");
-            for (size_t i = 0; i < frag.len; i++) {
-                Serial.print("0x");
-                if (frag.data[i] < 0x10) Serial.print("0");
-                Serial.print(frag.data[i], HEX);
-                Serial.print(",");
+        if (!persistent) {
+            if (xQueueReceive(queueFragmentos, &frag, portMAX_DELAY) == pdTRUE) {
+                // Espera semáforo antes de enviar
+                xSemaphoreTake(semaforoEnvioCompleto, portMAX_DELAY);
+                printFragment(frag);
+                requestNetworkTimeIfDue();
+                LMIC_setTxData2(LORA_PORT_LIVE, frag.data, frag.len, 0);
+            }
+            vTaskDelay(pdMS_TO_TICKS(10)); // sólo lógica propia, no runloop
+            continue;
+        }
+
+        // 1. Fragmentos nuevos al carril en vivo; si está lleno, el más viejo pasa a flash
+        if (xQueueReceive(queueFragmentos, &frag, pdMS_TO_TICKS(50)) == pdTRUE) {
+            do {
+                if (liveCount == LIVE_LANE_DEPTH) {
+                    demoteToBacklog(live[liveHead]);
+                    liveHead = (liveHead + 1) % LIVE_LANE_DEPTH;
+                    liveCount--;
+                }
+                live[(liveHead + liveCount) % LIVE_LANE_DEPTH] = frag;
+                liveCount++;
+            } while (xQueueReceive(queueFragmentos, &frag, 0) == pdTRUE);
+            saveLiveLane(live, liveHead, liveCount, (txPending && txFromLive) ? &inFlight : nullptr);
+        }
+
+        // 2. Fin de la transmisión en curso
+        if (txPending && xSemaphoreTake(semaforoEnvioCompleto, 0) == pdTRUE) {
+            txPending = false;
+            bool delivered = !UPLINK_CONFIRMED || loraTxAcked;
+            if (txFromLive) {
+                if (!delivered) {
+                    // Sin ACK: pasa al histórico y el histórico espera antes de reintentar
+                    demoteToBacklog(inFlight);
+                    retryAt = xTaskGetTickCount() + pdMS_TO_TICKS(UPLINK_RETRY_MS);
+                }
+                saveLiveLane(live, liveHead, liveCount, nullptr);
+            } else if (delivered) {
+                uplink_store_pop();
+            } else {
+                retryAt = xTaskGetTickCount() + pdMS_TO_TICKS(UPLINK_RETRY_MS);
+            }
+            if (!delivered) {
+                Serial.printf("[LORA] Sin ACK: %u fragmentos en histórico, reintento en %u s\n",
+                              uplink_store_count(), UPLINK_RETRY_MS / 1000);
+            }
+            xSemaphoreGive(semaforoEnvioCompleto);
+        }
+
+        // 3. Siguiente envío: primero lo vivo, el histórico solo con el carril vacío
+        if (txPending) continue;
+        uint8_t port;
+        if (liveCount > 0) {
+            inFlight = live[liveHead];
+            liveHead = (liveHead + 1) % LIVE_LANE_DEPTH;
+            liveCount--;
+            fixLostBaseV2(inFlight.data, inFlight.len, LORA_PAYLOAD_MAX);
+            frag = inFlight;
+            txFromLive = true;
+            port = LORA_PORT_LIVE;
+        } else if ((int32_t)(xTaskGetTickCount() - retryAt) >= 0 &&
+                   uplink_store_peek(frag.data, sizeof(frag.data), &frag.len)) {
+            txFromLive = false;
+            port = LORA_PORT_BACKLOG;
+        } else {
+            continue;
+        }
+
+        xSemaphoreTake(semaforoEnvioCompleto, portMAX_DELAY);
+        printFragment(frag);
+        requestNetworkTimeIfDue();
+        if (LMIC_setTxData2(port, frag.data, frag.len, UPLINK_CONFIRMED) == 0) {
+            txPending = true;
+        } else {
+            // LMIC ocupado: lo vivo vuelve al histórico, el histórico se reintenta en 1 s
+            xSemaphoreGive(semaforoEnvioCompleto);
+            if (txFromLive) {
+                demoteToBacklog(inFlight);
+                saveLiveLane(live, liveHead, liveCount, nullptr);
             }
-            LMIC_setTxData2(1, frag.data, frag.len, 0);
+            retryAt = xTaskGetTickCount() + pdMS_TO_TICKS(1000);
         }
-        vTaskDelay(pdMS_TO_TICKS(10)); // sólo lógica propia, no runloop
     }
 }
 
@@ -1038,7 +2135,7 @@ void DataAggregatorTask(void *pvParameters) {
                  std::vector<uint8_t> unifiedPayload = construirPayloadUnificado(ID_MSG++, pendingBuffer);
                  
                  Fragmento loraFragment;
-                 loraFragment.len = std::min(unifiedPayload.size(), LORA_PAYLOAD_MAX);
+                 loraFragment.len = std::min(unifiedPayload.size(), FRAME_MAX_LEN);
                  memcpy(loraFragment.data, unifiedPayload.data(), loraFragment.len);
                  
                  if (xQueueSend(queueFragmentos, &loraFragment, pdMS_TO_TICKS(100)) == pdTRUE) {
@@ -1054,7 +2151,7 @@ void DataAggregatorTask(void *pvParameters) {
                  Serial.println("[Agregador] Timeout Agregador. Enviando.");
                  std::vector<uint8_t> unifiedPayload = construirPayloadUnificado(ID_MSG++, pendingBuffer);
                  Fragmento loraFragment;
-                 loraFragment.len = std::min(unifiedPayload.size(), LORA_PAYLOAD_MAX);
+                 loraFragment.len = std::min(unifiedPayload.size(), FRAME_MAX_LEN);
                  memcpy(loraFragment.data, unifiedPayload.data(), loraFragment.len);
                  xQueueSend(queueFragmentos, &loraFragment, pdMS_TO_TICKS(100));
                  pendingBuffer.clear();
@@ -1101,7 +2198,7 @@ void setup() {
     xTaskCreatePinnedToCore(tareaRunLoop, "RunLoop", 2048, NULL, 2, NULL, 1);
 
     // Creación de tarea LoRa en el núcleo 1
-    xTaskCreatePinnedToCore(tareaLoRa, "LoRaTask", 2048, NULL, 5, NULL, 1); // 4KB y prioridad 5
+    xTaskCreatePinnedToCore(tareaLoRa, "LoRaTask", 6144, NULL, 5, NULL, 1); // LittleFS necesita más pila; prioridad 5
 
     xTaskCreatePinnedToCore(DataAggregatorTask, "DataAggregator", 4096, NULL, 3, NULL, 1);
 }
@@ -1126,11 +2223,7 @@ void _internal_addSlaveToScheduler(const ModbusSlaveParam& slave) {
     }
 
     for (const auto& sensor : slave.sensors) {
-        uint32_t calculatedInterval = sensor.samplingInterval;
-        if (sensor.numberOfChannels > 0 && sensor.maxRegisters > 0) {
-            uint16_t registersPerChannel = sensor.maxRegisters / sensor.numberOfChannels;
-            calculatedInterval = (uint32_t)sensor.samplingInterval * registersPerChannel;
-        }
+        uint32_t calculatedInterval = sensorPollInterval(sensor);
 
         uint32_t now = millis();
         uint32_t nextAligned = alignNextSampleTime(now, schedulerEpochMs, calculatedInterval);
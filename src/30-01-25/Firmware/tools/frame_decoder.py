@@ -0,0 +1,312 @@
+#!/usr/bin/env python3
+"""Reference decoder for the master's unified LoRa frames (v1 and v2).
+
+v1 (FPort 1 live / 2 backlog):
+    [ID_MSG][TIMESTAMP 4B][ACTIVATE][LEN...][DATA...]
+    Bit 31 of TIMESTAMP set = clock not synchronized (seconds since boot).
+
+v2 (FPort 3 live / 4 backlog):
+    [(2 << 4) | flags][counter varint][BASE: epoch 4B | else: delta varint]
+    [ACTIVATE][LEN...][BLOCK_TIME: age varint per block][DATA...]
+    flags: 0x01 BASE, 0x02 BLOCK_TIME, 0x04 UNSYNCED, 0x08 base parity.
+    A delta frame refers to the latest BASE frame with the same parity sent at most
+    FRAME_V2_BASE_EVERY frames earlier (counter modulo 128). Backlog frames are
+    always BASE frames.
+
+ACTIVATE bit i set = sensor ID i present; one LEN byte per set bit, LSB first
+(bits 0-4 values per channel, bit 5 DELTA, bit 6 2BIT, bit 7 packed). The data
+blocks follow in the same order; their size depends on each sensor's channel count
+and value width, which the frame does not carry, so they come from the --sensor table.
+
+DELTA blocks (uint16 histories): [mode][first value per channel 2B][deltas], deltas
+zig-zag coded channel by channel; mode 0 = LEB128 varints, mode w + 1 = fixed fields
+of w bits packed MSB first (w = 0: all deltas are zero).
+
+Quantized blocks (bits 5 and 6 both set, master_ttgo/include/QuantCodec.h):
+[codec][offset zig-zag varint if bit 5][codes], codec bits 7-6 = 1 float16, 2 int8,
+3 int16 (signed, big-endian), bits 4-0 = e + 16; value = (offset + code) * 10^e.
+Values are physical (register / 10^scale).
+
+PKD blocks (bit 7, BITPACK_AUTO_WIDTH): [width header][base 2B if bit 7][fields],
+header bits 0-4 = width w; each value is base + a w-bit field, packed MSB first.
+Firmware built with BITPACK_AUTO_WIDTH=0 sends packed blocks unflagged and without
+header; give their width as the BITS field of --sensor.
+
+Scope: only the 30-01-25 master emits v2. The 03-06-26 master (keyframe/delta
+frames, src/03-06-26/CODE/tools/payload_decoder.py) and the 10-09-25 node keep the
+classic [ID_MSG][TIMESTAMP 4B] header.
+
+Usage:
+    frame_decoder.py --port 3 --sensor 1:3:2 --sensor 2:3:2 20001a... 20012d...
+Frames given on one command line are decoded in order with shared v2 state.
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+FRAME_V2_VERSION = 2
+FLAG_BASE = 0x01
+FLAG_BLOCK_TIME = 0x02
+FLAG_UNSYNCED = 0x04
+FLAG_PARITY = 0x08
+COUNTER_MOD = 128
+BASE_EVERY = 16
+TS_UNSYNCED_FLAG = 0x80000000
+LEN_FLAG_DELTA = 0x20
+LEN_FLAG_QUANT = 0x60
+QUANT_KIND_FLOAT16 = 1
+QUANT_KIND_INT8 = 2
+QUANT_KIND_INT16 = 3
+QUANT_FLAG_OFFSET = 0x20
+QUANT_EXP_BIAS = 16
+LEN_FLAG_PACKED = 0x80
+PACK_FLAG_BASE = 0x80
+
+V1_PORTS = (1, 2)
+V2_PORTS = (3, 4)
+BACKLOG_PORTS = (2, 4)
+
+
+class FrameError(ValueError):
+    pass
+
+
+class Reader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def u8(self):
+        if self.pos >= len(self.data):
+            raise FrameError("frame truncated at byte %d" % self.pos)
+        b = self.data[self.pos]
+        self.pos += 1
+        return b
+
+    def u32(self):
+        return (self.u8() << 24) | (self.u8() << 16) | (self.u8() << 8) | self.u8()
+
+    def varint(self):
+        value = 0
+        shift = 0
+        while True:
+            b = self.u8()
+            value |= (b & 0x7F) << shift
+            if not b & 0x80:
+                return value
+            shift += 7
+            if shift > 28:
+                raise FrameError("varint too long")
+
+    def take(self, n):
+        if self.pos + n > len(self.data):
+            raise FrameError("block of %d bytes truncated" % n)
+        chunk = self.data[self.pos:self.pos + n]
+        self.pos += n
+        return chunk
+
+
+class V2State:
+    """Bases seen on the live lane of one device."""
+
+    def __init__(self):
+        self.base = None  # (counter, parity, epoch, unsynced)
+
+    def resolve(self, counter, parity, delta):
+        if self.base is None:
+            return None
+        b_counter, b_parity, b_epoch, _ = self.base
+        if b_parity != parity or (counter - b_counter) % COUNTER_MOD >= BASE_EVERY:
+            return None  # The base this frame refers to was lost
+        return b_epoch + delta
+
+
+def parse_sensor(spec):
+    parts = [int(p) for p in spec.split(":")]
+    if len(parts) not in (3, 4):
+        raise argparse.ArgumentTypeError("expected ID:CHANNELS:BYTES[:BITS]")
+    sensor = {"channels": parts[1], "bytes": parts[2]}
+    if len(parts) == 4:
+        sensor["bits"] = parts[3]
+    return parts[0], sensor
+
+
+def block_size(sensor, samples):
+    values = sensor["channels"] * samples
+    if "bits" in sensor:
+        return (values * sensor["bits"] + 7) // 8
+    return values * sensor["bytes"]
+
+
+def unzigzag(zz):
+    return (zz >> 1) ^ -(zz & 1)
+
+
+def read_delta_block(r, channels, samples):
+    """Reads one DELTA block and returns the values per channel."""
+    mode = r.u8()
+    firsts = [(r.u8() << 8) | r.u8() for _ in range(channels)]
+    count = channels * (samples - 1)
+    if mode == 0:
+        deltas = [r.varint() for _ in range(count)]
+    else:
+        width = mode - 1
+        deltas = unpack_fields(r.take((count * width + 7) // 8), count, width)
+    out = []
+    for c in range(channels):
+        values = [firsts[c]]
+        for zz in deltas[c * (samples - 1):(c + 1) * (samples - 1)]:
+            values.append((values[-1] + unzigzag(zz)) & 0xFFFF)
+        out.append(values)
+    return out
+
+
+def unpack_fields(raw, count, width):
+    bits = int.from_bytes(raw, "big") if raw else 0
+    spare = len(raw) * 8 - count * width
+    return [(bits >> (spare + (count - 1 - i) * width)) & ((1 << width) - 1) for i in range(count)]
+
+
+def read_packed_block(r, count):
+    """Reads one auto-width PKD block and returns its count values."""
+    header = r.u8()
+    width = header & 0x1F
+    if width > 16:
+        raise FrameError("packed width %d out of range" % width)
+    base = (r.u8() << 8) | r.u8() if header & PACK_FLAG_BASE else 0
+    return [base + f for f in unpack_fields(r.take((count * width + 7) // 8), count, width)]
+
+
+def read_quant_block(r, count):
+    """Reads one quantized block and returns its count values."""
+    codec = r.u8()
+    kind = codec >> 6
+    if kind == QUANT_KIND_FLOAT16:
+        return [struct.unpack(">e", r.take(2))[0] for _ in range(count)]
+    if kind not in (QUANT_KIND_INT8, QUANT_KIND_INT16):
+        raise FrameError("unknown quantization codec 0x%02x" % codec)
+    offset = unzigzag(r.varint()) if codec & QUANT_FLAG_OFFSET else 0
+    exp = (codec & 0x1F) - QUANT_EXP_BIAS
+    width = 1 if kind == QUANT_KIND_INT8 else 2
+    values = []
+    for _ in range(count):
+        code = int.from_bytes(r.take(width), "big", signed=True)
+        values.append(round((offset + code) * 10.0 ** exp, max(0, -exp)))
+    return values
+
+
+def decode(frame, port, sensors, state=None):
+    r = Reader(frame)
+    out = {"port": port, "backlog": port in BACKLOG_PORTS}
+
+    if port in V2_PORTS:
+        head = r.u8()
+        if head >> 4 != FRAME_V2_VERSION:
+            raise FrameError("unknown frame version %d" % (head >> 4))
+        flags = head & 0x0F
+        counter = r.varint()
+        parity = bool(flags & FLAG_PARITY)
+        unsynced = bool(flags & FLAG_UNSYNCED)
+        out.update(version=2, counter=counter, unsynced=unsynced)
+        if flags & FLAG_BASE:
+            ts = r.u32()
+            if state is not None and not out["backlog"]:
+                state.base = (counter, parity, ts, unsynced)
+        else:
+            delta = r.varint()
+            ts = state.resolve(counter, parity, delta) if state is not None else None
+            out["delta"] = delta
+        block_times = bool(flags & FLAG_BLOCK_TIME)
+    elif port in V1_PORTS:
+        out["version"] = 1
+        out["counter"] = r.u8()
+        ts = r.u32()
+        out["unsynced"] = bool(ts & TS_UNSYNCED_FLAG)
+        ts &= ~TS_UNSYNCED_FLAG
+        block_times = False
+    else:
+        raise FrameError("port %d does not carry unified frames" % port)
+    out["timestamp"] = ts
+
+    activate = r.u8()
+    ids = [i for i in range(8) if activate & (1 << i)]
+    lens = [r.u8() for _ in ids]
+    ages = [r.varint() for _ in ids] if block_times else [0] * len(ids)
+
+    blocks = []
+    for n, (sid, len_byte, age) in enumerate(zip(ids, lens, ages)):
+        samples = len_byte & 0x1F
+        packed = bool(len_byte & LEN_FLAG_PACKED)
+        sensor = sensors.get(sid)
+        quant = (len_byte & LEN_FLAG_QUANT) == LEN_FLAG_QUANT
+        delta = bool(len_byte & LEN_FLAG_DELTA) and not quant
+        start = r.pos
+        channels = None
+        if sensor is not None and quant:
+            values = read_quant_block(r, sensor["channels"] * samples)
+            channels = [values[c * samples:(c + 1) * samples] for c in range(sensor["channels"])]
+            raw = frame[start:r.pos]
+        elif sensor is not None and packed:
+            values = read_packed_block(r, sensor["channels"] * samples)
+            channels = [values[c * samples:(c + 1) * samples] for c in range(sensor["channels"])]
+            raw = frame[start:r.pos]
+        elif sensor is not None and delta:
+            channels = read_delta_block(r, sensor["channels"], samples)
+            raw = frame[start:r.pos]
+        elif sensor is None:
+            if n != len(ids) - 1:
+                raise FrameError("sensor %d not in the table and not the last block" % sid)
+            raw = r.take(len(frame) - r.pos)
+        else:
+            raw = r.take(block_size(sensor, samples))
+        block = {
+            "sensor": sid,
+            "samples_per_channel": samples,
+            "packed": packed,
+            "two_bit": bool(len_byte & 0x40) and not quant,
+            "delta": delta,
+            "quantized": quant,
+            "sampled_at": None if ts is None else ts - age,
+            "raw": raw.hex(),
+        }
+        if channels is not None:
+            block["channels"] = channels
+        elif sensor is not None and "bits" in sensor:
+            values = unpack_fields(raw, sensor["channels"] * samples, sensor["bits"])
+            block["channels"] = [values[c * samples:(c + 1) * samples] for c in range(sensor["channels"])]
+        elif sensor is not None:
+            width = sensor["bytes"]
+            values = [int.from_bytes(raw[i:i + width], "big") for i in range(0, len(raw), width)]
+            per = samples
+            block["channels"] = [values[c * per:(c + 1) * per] for c in range(sensor["channels"])]
+        blocks.append(block)
+    out["blocks"] = blocks
+    if r.pos != len(frame):
+        out["trailing"] = frame[r.pos:].hex()
+    return out
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--port", type=int, default=3, help="LoRaWAN FPort of the frames (default 3)")
+    ap.add_argument("--sensor", type=parse_sensor, action="append", default=[],
+                    help="ID:CHANNELS:BYTES[:BITS] per sensor block")
+    ap.add_argument("frames", nargs="+", help="frames in hex")
+    args = ap.parse_args()
+
+    sensors = dict(args.sensor)
+    state = V2State()
+    status = 0
+    for text in args.frames:
+        try:
+            print(json.dumps(decode(bytes.fromhex(text), args.port, sensors, state)))
+        except (FrameError, ValueError) as e:
+            print(json.dumps({"error": str(e), "frame": text}))
+            status = 1
+    return status
+
+
+if __name__ == "__main__":
+    sys.exit(main())